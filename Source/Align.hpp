@@ -0,0 +1,14 @@
+//
+//  Align.hpp
+//
+
+#pragma once
+
+
+// Returns 'value' aligned to the next multiple of 'alignment'.
+// 'alignment' must be a power of two.
+template <typename T>
+inline T align(T value, T alignment)
+{
+    return ((value + (alignment - 1)) & ~(alignment - 1));
+}
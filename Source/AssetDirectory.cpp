@@ -0,0 +1,41 @@
+//
+//  AssetDirectory.cpp
+//
+
+#include "AssetDirectory.hpp"
+
+#include <dirent.h>
+
+
+//---------------------------------------------------------------------------------------
+AssetDirectory buildAssetDirectory (
+    const std::string & directoryPath,
+    const std::string & fileExtension
+) {
+    AssetDirectory assetDirectory;
+    
+    DIR * directory = opendir(directoryPath.c_str());
+    if (!directory) {
+        return assetDirectory;
+    }
+    
+    // Map file name to file path and insert into assetDirectory.
+    std::pair<FileName, PathToFile> pair;
+    while (dirent * entry = readdir(directory)) {
+        FileName fileName(entry->d_name);
+        
+        const bool hasExtension = fileName.size() > fileExtension.size() &&
+            fileName.compare(fileName.size() - fileExtension.size(),
+                             fileExtension.size(), fileExtension) == 0;
+        
+        if (hasExtension) {
+            pair.first = fileName;
+            pair.second = directoryPath + "/" + fileName;
+            
+            assetDirectory.insert(pair);
+        }
+    }
+    closedir(directory);
+    
+    return assetDirectory;
+}
@@ -4,8 +4,17 @@
 
 #pragma once
 
+#include <string>
 #include <unordered_map>
 
 typedef std::string FileName;
 typedef std::string PathToFile;
 typedef std::unordered_map<FileName, PathToFile> AssetDirectory;
+
+
+// Maps the name of each file in directoryPath ending in fileExtension (e.g. ".glsl") to
+// its path. Subdirectories are not searched.
+AssetDirectory buildAssetDirectory (
+    const std::string & directoryPath,
+    const std::string & fileExtension
+);
@@ -0,0 +1,267 @@
+//
+//  AssetPack.cpp
+//
+
+#include "AssetPack.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+const char AssetPackMagic[8] = { 'C', 'N', 'A', 'S', 'S', 'E', 'T', '1' };
+
+
+#if defined(CUBENADO_EMBED_ASSETS)
+// Generated by Tools/PackAssets --cpp.
+extern const unsigned char g_embeddedAssetPack[];
+extern const size_t g_embeddedAssetPackSize;
+#endif
+
+
+namespace {
+    const char * g_pack = nullptr;
+    size_t g_packSize = 0;
+
+    // Set when g_pack is a mapping to unmap on close, rather than embedded data.
+    bool g_packMapped = false;
+
+
+    //-----------------------------------------------------------------------------------
+    const AssetPackEntry * entries()
+    {
+        return reinterpret_cast<const AssetPackEntry *>(g_pack + sizeof(AssetPackHeader));
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    uint32 numEntries()
+    {
+        return reinterpret_cast<const AssetPackHeader *>(g_pack)->numEntries;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Checks the header and that every entry lies within the pack, so lookups need
+    // no bounds checks.
+    bool isValidPack (
+        const char * pack,
+        size_t packSize
+    ) {
+        if (packSize < sizeof(AssetPackHeader)) {
+            return false;
+        }
+
+        const AssetPackHeader & header = *reinterpret_cast<const AssetPackHeader *>(pack);
+        if (memcmp(header.magic, AssetPackMagic, sizeof(AssetPackMagic)) != 0 ||
+            header.numBytes != packSize ||
+            header.numEntries > (packSize - sizeof(header)) / sizeof(AssetPackEntry))
+        {
+            return false;
+        }
+
+        const AssetPackEntry * packEntries =
+            reinterpret_cast<const AssetPackEntry *>(pack + sizeof(header));
+
+        for (uint32 i = 0; i < header.numEntries; ++i) {
+            const AssetPackEntry & entry = packEntries[i];
+            if (entry.name[AssetPackEntry::MaxNameLength] != '\0' ||
+                entry.offset > packSize ||
+                entry.numBytes >= packSize - entry.offset)
+            {
+                return false;
+            }
+
+            if (i > 0 && strcmp(packEntries[i - 1].name, entry.name) >= 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+bool AssetPack::open (
+    const std::string & filePath
+) {
+    close();
+
+    int file = ::open(filePath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0 || fileStatus.st_size <= 0) {
+        ::close(file);
+        return false;
+    }
+
+    const size_t packSize = static_cast<size_t>(fileStatus.st_size);
+    void * mapping = mmap(nullptr, packSize, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping holds its own reference to the file.
+    ::close(file);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    if (!isValidPack(static_cast<const char *>(mapping), packSize)) {
+        fprintf(stderr, "Error -- Invalid asset pack: %s\n", filePath.c_str());
+        munmap(mapping, packSize);
+        return false;
+    }
+
+    g_pack = static_cast<const char *>(mapping);
+    g_packSize = packSize;
+    g_packMapped = true;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool AssetPack::openEmbedded()
+{
+    close();
+
+#if defined(CUBENADO_EMBED_ASSETS)
+    const char * pack = reinterpret_cast<const char *>(g_embeddedAssetPack);
+    if (!isValidPack(pack, g_embeddedAssetPackSize)) {
+        return false;
+    }
+
+    g_pack = pack;
+    g_packSize = g_embeddedAssetPackSize;
+    g_packMapped = false;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+//---------------------------------------------------------------------------------------
+void AssetPack::close()
+{
+    if (g_pack && g_packMapped) {
+        munmap(const_cast<char *>(g_pack), g_packSize);
+    }
+
+    g_pack = nullptr;
+    g_packSize = 0;
+    g_packMapped = false;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool AssetPack::isOpen()
+{
+    return g_pack != nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool AssetPack::find (
+    const std::string & name,
+    AssetData & asset
+) {
+    if (!g_pack) {
+        return false;
+    }
+
+    // Binary search of the sorted index.
+    const AssetPackEntry * packEntries = entries();
+    uint32 begin = 0;
+    uint32 end = numEntries();
+
+    while (begin < end) {
+        const uint32 middle = begin + (end - begin) / 2;
+        const int order = strcmp(packEntries[middle].name, name.c_str());
+
+        if (order == 0) {
+            asset.data = g_pack + packEntries[middle].offset;
+            asset.numBytes = packEntries[middle].numBytes;
+            return true;
+        } else if (order < 0) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool AssetPack::load (
+    const std::string & path,
+    std::string & storage,
+    AssetData & asset
+) {
+    const size_t slash = path.rfind('/');
+    const std::string fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    if (find(fileName, asset)) {
+        return true;
+    }
+
+    FILE * file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // Read the whole file in one call.
+    fseek(file, 0, SEEK_END);
+    const long numBytes = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    storage.resize(numBytes > 0 ? static_cast<size_t>(numBytes) : 0);
+    const bool read = storage.empty() ||
+                      fread(&storage[0], 1, storage.size(), file) == storage.size();
+    fclose(file);
+
+    if (!read) {
+        return false;
+    }
+
+    asset.data = storage.data();
+    asset.numBytes = storage.size();
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+AssetDirectory AssetPack::buildAssetDirectory (
+    const std::string & fileExtension
+) {
+    AssetDirectory assetDirectory;
+    if (!g_pack) {
+        return assetDirectory;
+    }
+
+    const AssetPackEntry * packEntries = entries();
+    for (uint32 i = 0; i < numEntries(); ++i) {
+        const FileName fileName(packEntries[i].name);
+
+        const bool hasExtension = fileName.size() > fileExtension.size() &&
+            fileName.compare(fileName.size() - fileExtension.size(),
+                             fileExtension.size(), fileExtension) == 0;
+
+        if (hasExtension) {
+            assetDirectory.insert(std::make_pair(fileName, fileName));
+        }
+    }
+
+    return assetDirectory;
+}
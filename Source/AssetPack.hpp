@@ -0,0 +1,77 @@
+//
+//  AssetPack.hpp
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "NumericTypes.h"
+#include "AssetDirectory.hpp"
+
+
+// Contents of one asset, valid while the pack or storage it points into is.
+struct AssetData {
+    const char * data;
+    size_t numBytes;
+};
+
+
+// Asset files packed into one file by Tools/PackAssets, with an index sorted by name.
+// The open pack is memory mapped, so assets are found by binary search and read in place
+// with no per file opens or copies. Builds with CUBENADO_EMBED_ASSETS also compile a
+// pack into the binary.
+//
+// Packed assets are looked up by file name, and a pack has no subdirectories.
+class AssetPack {
+public:
+    // Maps the pack at filePath, closing any pack already open. Returns false if the
+    // file cannot be mapped or is not a valid pack.
+    static bool open(const std::string & filePath);
+
+    // Uses the pack compiled into the binary. Returns false when built without one.
+    static bool openEmbedded();
+
+    static void close();
+
+    static bool isOpen();
+
+    // Returns false if no pack is open or it has no asset named name. The data stays
+    // valid until the pack is closed.
+    static bool find(const std::string & name, AssetData & asset);
+
+    // Finds the file name of path in the open pack, and otherwise reads path from
+    // disk into storage. Returns false if neither has it.
+    static bool load (
+        const std::string & path,
+        std::string & storage,
+        AssetData & asset
+    );
+
+    // Maps the name of each packed asset ending in fileExtension to itself, so code
+    // given an AssetDirectory loads it through load().
+    static AssetDirectory buildAssetDirectory(const std::string & fileExtension);
+};
+
+
+// File layout, shared with Tools/PackAssets. All fields are little endian.
+//
+// An AssetPackHeader is followed by numEntries AssetPackEntry records sorted by name
+// with strcmp(), then the asset data. Each asset is followed by a zero byte not counted
+// in numBytes, so packed text can also be read as a C string.
+struct AssetPackHeader {
+    char magic[8];
+    uint32 numEntries;
+    uint32 numBytes;  // Size of the whole pack.
+};
+
+struct AssetPackEntry {
+    static const size_t MaxNameLength = 55;
+
+    char name[MaxNameLength + 1];  // Zero terminated.
+    uint32 offset;                 // From the start of the pack.
+    uint32 numBytes;
+};
+
+extern const char AssetPackMagic[8];
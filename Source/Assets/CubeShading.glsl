@@ -0,0 +1,39 @@
+//
+// CubeShading.glsl
+//
+// Included by fragment shaders that light cubes.
+//
+
+
+layout(std140)
+uniform LightSource {
+    vec3 position_worldSpace;
+    vec3 rgbIntensity;
+} lightSource;
+
+
+layout(std140)
+uniform Material {
+    vec3 Ka;   // Coefficients of ambient reflectivity for each RGB component.
+    vec3 Kd;   // Coefficients of diffuse reflectivity for each RGB component.
+} material;
+
+
+//---------------------------------------------------------------------------------------
+// Color of a cube surface point, given its world space position and unit normal.
+vec3 shade_cube (
+    vec3 position,
+    vec3 normal
+) {
+    // Direction from fragment to light source.
+    vec3 l = normalize(lightSource.position_worldSpace - position);
+    
+    const vec3 ambientIntensity = vec3(0.01f, 0.01f, 0.01f);
+    vec3 ambient = ambientIntensity * material.Ka;
+    
+    float n_dot_l = max(dot(normal, l), 0.0);
+    vec3 diffuse = material.Kd * n_dot_l;
+    
+    
+    return ambient + lightSource.rgbIntensity * diffuse;
+}
@@ -2,18 +2,20 @@
 // CubeVS.glsl
 //
 #version 300 es
-#define ATTRIBUTE_POSITION    0
-#define ATTRIBUTE_NORMAL      1
-#define ATTRIBUTE_INSTANCE_0  3
-#define ATTRIBUTE_INSTANCE_1  4
+#include "VertexAttributeDefines.h"
 
-layout(location = ATTRIBUTE_POSITION) in vec3 position;
-layout(location = ATTRIBUTE_NORMAL) in vec3 normal;
+#ifndef PROCEDURAL_CUBE
+layout(location = ATTRIBUTE_POSITION) in vec3 vertexPosition;
+#ifdef OCTAHEDRAL_NORMALS
+layout(location = ATTRIBUTE_NORMAL) in vec2 vertexNormal;
+#else
+layout(location = ATTRIBUTE_NORMAL) in vec3 vertexNormal;
+#endif
+#endif
 layout(location = ATTRIBUTE_INSTANCE_0) in vec3 instancePos;
-
-// .xyz: Axis of rotation
-// .w  : Max angle
-layout(location = ATTRIBUTE_INSTANCE_1) in vec4 orientation;
+#ifdef IMPOSTORS
+layout(location = ATTRIBUTE_INSTANCE_1) in float projectedSize;  // Pixels across.
+#endif
 
 
 layout(std140)
@@ -24,51 +26,85 @@ uniform Transforms {
     mat4 normalMatrix;
 };
 
-uniform float cubeRandomness;  // [0,1] degree of randomness.
+// Per frame parameters, see CubeUniforms in Renderer.cpp
+layout(std140)
+uniform Cube {
+    float cubeRandomness;     // [0,1] degree of randomness.
+    uint orientationSeed;     // Hashed with gl_InstanceID to orient each cube.
+    float impostorThreshold;  // Cubes fewer pixels across are drawn as impostors.
+    vec2 viewportSize;        // Framebuffer size in pixels.
+};
 
+#ifndef PROCEDURAL_CUBE
+// Maps stored mesh positions back to cube space, see CubeMeshUniforms in Renderer.cpp
+layout(std140)
+uniform CubeMesh {
+    vec3 positionScale;
+    vec3 positionBias;
+};
+#endif
 
-out VsOutFsIn {
-    vec4 position_worldSpace;
-    vec4 normal_worldSpace;
-} vsOut;
 
+out vec4 position_worldSpace;
+out vec4 normal_worldSpace;
 
-//---------------------------------------------------------------------------------------
-vec4 quat_from_axis_angle (
-    vec3 axis,   // Axis of rotation, assumed normalized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q;
-    float half_angle = angle * 0.5;
-    float sin_half_angle = sin(half_angle);
-    q.x = axis.x * sin_half_angle;
-    q.y = axis.y * sin_half_angle;
-    q.z = axis.z * sin_half_angle;
-    q.w = cos(half_angle);
-    
-    return q;
-}
-
-
-//---------------------------------------------------------------------------------------
-vec3 rotate_position (
-    vec3 position,
-    vec3 axis,   // Axis of rotation, assumed noralized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q = quat_from_axis_angle(axis, angle);
-    vec3 v = position.xyz;
-    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
-}
+#include "QuaternionRotation.glsl"
+#include "InstanceOrientation.glsl"
+#include "ProceduralCube.glsl"
+#include "MeshDecoding.glsl"
 
 
 //---------------------------------------------------------------------------------------
 void main() {
+#ifdef IMPOSTORS
+    // Cubes this small are ray cast by ImpostorFS instead. Collapsing every vertex to
+    // one point leaves only degenerate triangles, which are not rasterized.
+    if (projectedSize < impostorThreshold) {
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+#endif
+    
+#ifndef NO_ROTATION
     // Orient cube in Local Model Space based on cubeRandomness.
+    vec4 orientation = instance_orientation(gl_InstanceID, orientationSeed);
     vec3 axis = orientation.xyz;
     float angle = orientation.w * cubeRandomness;
+#endif
+    
+#if defined(VISIBLE_FACES)
+    // Variant drawing only the faces toward the camera, found from the camera in cube
+    // space. The cube is drawn at half scale about instancePos / 2 (see ImpostorVS).
+    vec3 eye_worldSpace = -(viewMatrix[3].xyz * mat3(viewMatrix));
+    vec3 eye = (2.0 * eye_worldSpace - instancePos) * mat3(modelMatrix);
+#ifndef NO_ROTATION
+    eye = rotate_position(eye, axis, -angle);
+#endif
+    vec3 position;
+    vec3 normal;
+    procedural_visible_cube_vertex(gl_VertexID, eye, position, normal);
+#elif defined(PROCEDURAL_CUBE)
+    // Variant drawn without vertex buffers, the only fetch is per instance.
+    vec3 position;
+    vec3 normal;
+    procedural_cube_vertex(gl_VertexID, position, normal);
+#else
+    vec3 position = vertexPosition * positionScale + positionBias;
+#ifdef OCTAHEDRAL_NORMALS
+    vec3 normal = decode_octahedral_normal(vertexNormal);
+#else
+    vec3 normal = vertexNormal;
+#endif
+#endif
+    
+#ifdef NO_ROTATION
+    // Variant for cubeRandomness == 0, leaving every cube unrotated.
+    vec3 orientedPosition = position;
+    vec3 orientedNormal = normal;
+#else
     vec3 orientedPosition = rotate_position(position, axis, angle);
     vec3 orientedNormal = rotate_position(normal, axis, angle);
+#endif
     
     vec4 pos = vec4(orientedPosition, 1.0);
     vec4 n = vec4(orientedNormal, 0.0);
@@ -76,10 +112,10 @@ void main() {
     pos = (modelMatrix * pos) + vec4(instancePos, 1.0);
     
     // World space position.
-    vsOut.position_worldSpace = pos;
+    position_worldSpace = pos;
     
     // Transform normal to world space.
-    vsOut.normal_worldSpace = normalMatrix * n;
+    normal_worldSpace = normalMatrix * n;
     
     gl_Position = projectMatrix * (viewMatrix * pos);
 }
\ No newline at end of file
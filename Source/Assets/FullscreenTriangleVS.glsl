@@ -0,0 +1,18 @@
+//
+// FullscreenTriangleVS.glsl
+//
+// Generates a single triangle covering the viewport from gl_VertexID.
+// Draw with 3 vertices and no vertex attributes enabled.
+#version 300 es
+
+out vec2 texCoord;
+
+
+void main()
+{
+    // (0,0), (2,0), (0,2)
+    vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    texCoord = p;
+    
+    gl_Position = vec4((p * 2.0) - 1.0, 0.0, 1.0);
+}
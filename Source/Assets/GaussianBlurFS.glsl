@@ -0,0 +1,33 @@
+//
+// GaussianBlurFS.glsl
+//
+// One direction of a separable 9-tap Gaussian blur, using bilinear filtering to
+// fetch two texels per sample.
+#version 300 es
+
+precision highp float;
+
+uniform sampler2D sourceTexture;
+uniform vec2 texelStep;  // (1/width, 0) for horizontal or (0, 1/height) for vertical.
+
+in vec2 texCoord;
+
+layout(location = 0) out vec2 fragColor;
+
+
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+
+void main()
+{
+    vec2 sum = texture(sourceTexture, texCoord).rg * weights[0];
+    
+    for (int i = 1; i < 3; ++i) {
+        vec2 offset = texelStep * offsets[i];
+        sum += texture(sourceTexture, texCoord + offset).rg * weights[i];
+        sum += texture(sourceTexture, texCoord - offset).rg * weights[i];
+    }
+    
+    fragColor = sum;
+}
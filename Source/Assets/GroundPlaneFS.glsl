@@ -5,19 +5,70 @@
 
 precision highp float;
 
+// Values of ShadowTechnique
+#define SHADOW_TECHNIQUE_DEPTH_COMPARE  0
+#define SHADOW_TECHNIQUE_VARIANCE       1
+#define SHADOW_TECHNIQUE_SPLAT          2
+
 uniform mediump sampler2DShadow shadowMap;
+uniform mediump sampler2D shadowSplatMap;
+uniform highp sampler2D varianceShadowMap;
+
+// Per frame parameters, see GroundPlaneUniforms in Renderer.cpp
+layout(std140)
+uniform GroundPlane {
+    highp mat4 modelMatrix;
+    highp mat4 viewProjectMatrix;
+    highp mat4 shadowMatrix;
+    highp int shadowTechnique;
+    highp float depthScale;  // 1 / light far plane, maps linear depth to [0,1].
+};
 
-in VsOutFsIn {
-    vec4 shadowCoord;
-} fsIn;
+in vec4 shadowCoord;
 
 
 out vec4 fragColor;
 
 
+//---------------------------------------------------------------------------------------
+// Upper bound on fraction of light reaching depth, given blurred depth moments.
+float chebyshevUpperBound (
+    vec2 moments,
+    float depth
+) {
+    const float minVariance = 0.000002;
+    const float lightBleedReduction = 0.3;
+    
+    if (depth <= moments.x) {
+        return 1.0;
+    }
+    
+    float variance = max(moments.y - (moments.x * moments.x), minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + (d * d));
+    
+    // Cut off the low tail of pMax to reduce light bleeding.
+    return clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+}
+
+
+//---------------------------------------------------------------------------------------
 void main()
 {
-    float shadowFactor = textureProj(shadowMap, fsIn.shadowCoord);
+    float shadowFactor;
+    if (shadowTechnique == SHADOW_TECHNIQUE_SPLAT) {
+        vec2 texCoord = shadowCoord.xy / shadowCoord.w;
+        shadowFactor = 1.0 - texture(shadowSplatMap, texCoord).r;
+    } else if (shadowTechnique == SHADOW_TECHNIQUE_VARIANCE) {
+        vec2 texCoord = shadowCoord.xy / shadowCoord.w;
+        vec2 moments = texture(varianceShadowMap, texCoord).rg;
+        
+        // Clip space w is the linear depth from the light.
+        float depth = shadowCoord.w * depthScale;
+        shadowFactor = chebyshevUpperBound(moments, depth);
+    } else {
+        shadowFactor = textureProj(shadowMap, shadowCoord);
+    }
     
     vec3 ambient = vec3(0.68);
     
@@ -25,4 +76,4 @@ void main()
     vec3 color = ambient + (shadowFactor * groundPlaneColor);
     
     fragColor = vec4(color, 1.0);
-}
\ No newline at end of file
+}
@@ -2,21 +2,24 @@
 // GroundPlaneVS.glsl
 //
 #version 300 es
-#define ATTRIBUTE_POSITION    0
-#define ATTRIBUTE_NORMAL      1
+#include "VertexAttributeDefines.h"
 
 layout(location = ATTRIBUTE_POSITION) in vec3 position;
 layout(location = ATTRIBUTE_NORMAL) in vec3 normal;
 
 
-uniform mat4 modelMatrix;
-uniform mat4 viewProjectMatrix;
-uniform mat4 shadowMatrix;
+// Per frame parameters, see GroundPlaneUniforms in Renderer.cpp
+layout(std140)
+uniform GroundPlane {
+    highp mat4 modelMatrix;
+    highp mat4 viewProjectMatrix;
+    highp mat4 shadowMatrix;
+    highp int shadowTechnique;
+    highp float depthScale;  // 1 / light far plane, maps linear depth to [0,1].
+};
 
 
-out VsOutFsIn {
-    highp vec4 shadowCoord;
-} vsOut;
+out highp vec4 shadowCoord;
 
 
 void main()
@@ -24,7 +27,7 @@ void main()
     vec4 pos = modelMatrix * vec4(position, 1.0);
     
     // Transform pos to shadow map coordinates
-    vsOut.shadowCoord = shadowMatrix * pos;
+    shadowCoord = shadowMatrix * pos;
     
     gl_Position = viewProjectMatrix * pos;
 }
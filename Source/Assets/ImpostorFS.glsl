@@ -0,0 +1,80 @@
+//
+// ImpostorFS.glsl
+//
+// Intersects the ray through each fragment of an impostor sprite with its oriented
+// cube, shading the hit and writing its depth so impostors and cube geometry
+// occlude each other correctly.
+//
+#version 300 es
+
+precision highp float;
+precision highp int;
+
+flat in vec3 cubeCenter_worldSpace;
+flat in mat3 cubeRotation;  // Cube local space to world space.
+
+out vec4 fragColor;
+
+
+layout(std140)
+uniform Transforms {
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projectMatrix;
+    mat4 normalMatrix;
+};
+
+// Per frame parameters, see CubeUniforms in Renderer.cpp
+layout(std140)
+uniform Cube {
+    float cubeRandomness;     // [0,1] degree of randomness.
+    uint orientationSeed;     // Hashed with gl_InstanceID to orient each cube.
+    float impostorThreshold;  // Cubes fewer pixels across are drawn as impostors.
+    vec2 viewportSize;        // Framebuffer size in pixels.
+};
+
+#include "CubeShading.glsl"
+
+
+void main() {
+    // Ray from the eye through this fragment, in world space. The view matrix is
+    // rigid, so its inverse rotation is its transpose.
+    vec2 ndc = (gl_FragCoord.xy / viewportSize) * 2.0 - 1.0;
+    vec3 direction_viewSpace =
+        vec3(ndc.x / projectMatrix[0][0], ndc.y / projectMatrix[1][1], -1.0);
+    
+    mat3 viewToWorld = transpose(mat3(viewMatrix));
+    vec3 rayOrigin = -(viewToWorld * viewMatrix[3].xyz);
+    vec3 rayDirection = viewToWorld * direction_viewSpace;
+    
+    // Slab test in cube local space, where the cube spans [-0.5, 0.5] on each axis.
+    // Cubes are drawn at half scale (see ImpostorVS), and scaling both origin and
+    // direction preserves ray parameters, so t applies in world space too.
+    mat3 worldToCube = 2.0 * transpose(cubeRotation);
+    vec3 origin = worldToCube * (rayOrigin - cubeCenter_worldSpace);
+    vec3 direction = worldToCube * rayDirection;
+    
+    // Nudge zero components, whose slabs are otherwise a division by zero.
+    direction += vec3(equal(direction, vec3(0.0))) * 1.0e-8;
+    vec3 t0 = (vec3(-0.5) - origin) / direction;
+    vec3 t1 = (vec3(0.5) - origin) / direction;
+    vec3 tMin = min(t0, t1);
+    vec3 tMax = max(t0, t1);
+    
+    float tEnter = max(max(tMin.x, tMin.y), tMin.z);
+    float tExit = min(min(tMax.x, tMax.y), tMax.z);
+    if (tEnter > tExit || tEnter < 0.0) {
+        discard;
+    }
+    
+    // The ray enters through the face whose slab it crossed last.
+    vec3 normal_cubeSpace = -sign(direction) * step(vec3(tEnter), tMin);
+    vec3 normal = normalize(cubeRotation * normal_cubeSpace);
+    vec3 position = rayOrigin + tEnter * rayDirection;
+    
+    vec4 position_clipSpace = projectMatrix * (viewMatrix * vec4(position, 1.0));
+    gl_FragDepth = (position_clipSpace.z / position_clipSpace.w) * 0.5 + 0.5;
+    
+    // CubeFS shades the position before CubeVS's implicit halving.
+    fragColor = vec4(shade_cube(2.0 * position, normal), 1.0);
+}
@@ -0,0 +1,69 @@
+//
+// ImpostorVS.glsl
+//
+// Draws each cube below the impostor threshold as one point sprite covering its
+// bounding sphere, for ImpostorFS to ray cast.
+//
+#version 300 es
+#include "VertexAttributeDefines.h"
+
+layout(location = ATTRIBUTE_INSTANCE_0) in vec3 instancePos;
+layout(location = ATTRIBUTE_INSTANCE_1) in float projectedSize;  // Pixels across.
+
+
+layout(std140)
+uniform Transforms {
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projectMatrix;
+    mat4 normalMatrix;
+};
+
+// Per frame parameters, see CubeUniforms in Renderer.cpp
+layout(std140)
+uniform Cube {
+    float cubeRandomness;     // [0,1] degree of randomness.
+    uint orientationSeed;     // Hashed with gl_InstanceID to orient each cube.
+    float impostorThreshold;  // Cubes fewer pixels across are drawn as impostors.
+    vec2 viewportSize;        // Framebuffer size in pixels.
+};
+
+
+flat out vec3 cubeCenter_worldSpace;
+flat out mat3 cubeRotation;  // Cube local space to world space.
+
+#include "QuaternionRotation.glsl"
+#include "InstanceOrientation.glsl"
+
+
+//---------------------------------------------------------------------------------------
+void main() {
+    // Cubes at or above the threshold are drawn as geometry by CubeVS. Points outside
+    // the clip volume are not rasterized.
+    if (projectedSize >= impostorThreshold) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.0;
+        return;
+    }
+    
+    mat3 rotation = mat3(modelMatrix);
+#ifndef NO_ROTATION
+    // Same orientation CubeVS gives the cube, as columns of a matrix.
+    vec4 orientation = instance_orientation(gl_InstanceID, orientationSeed);
+    vec3 axis = orientation.xyz;
+    float angle = orientation.w * cubeRandomness;
+    rotation = rotation * mat3(rotate_position(vec3(1.0, 0.0, 0.0), axis, angle),
+                               rotate_position(vec3(0.0, 1.0, 0.0), axis, angle),
+                               rotate_position(vec3(0.0, 0.0, 1.0), axis, angle));
+#endif
+    
+    // CubeVS adds instancePos as a point, leaving w = 2, so cubes are drawn at half
+    // scale about instancePos / 2. The impostor matches.
+    cubeCenter_worldSpace = 0.5 * instancePos;
+    cubeRotation = rotation;
+    
+    gl_Position = projectMatrix * (viewMatrix * vec4(instancePos, 2.0));
+    
+    // Pad by a pixel on each side so rounding never clips the cube's silhouette.
+    gl_PointSize = projectedSize + 2.0;
+}
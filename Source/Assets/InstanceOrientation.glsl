@@ -0,0 +1,55 @@
+//
+// InstanceOrientation.glsl
+//
+// Included by cube shaders that rotate each instance about a random axis, generated
+// from gl_InstanceID rather than fetched from a buffer.
+//
+
+
+// Rotation about the instance axis at cubeRandomness 1.
+const float MAX_ROTATION_ANGLE = 1.5707963;  // pi / 2
+
+
+//---------------------------------------------------------------------------------------
+// Integer hash (lowbias32, Chris Wellons) that mixes consecutive inputs well.
+uint hash_uint (
+    uint x
+) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    
+    return x;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Maps the top 24 bits of hash into (0,1), never zero so axes stay normalizable.
+float hash_to_unit_float (
+    uint hash
+) {
+    return (float(hash >> 8) + 0.5) * (1.0 / 16777216.0);
+}
+
+
+//---------------------------------------------------------------------------------------
+// .xyz: Axis of rotation, normalized and in the positive octant.
+// .w  : Max angle
+vec4 instance_orientation (
+    int instanceID,
+    uint seed
+) {
+    uint hash = hash_uint(uint(instanceID) ^ seed);
+    vec3 axis;
+    axis.x = hash_to_unit_float(hash);
+    
+    hash = hash_uint(hash);
+    axis.y = hash_to_unit_float(hash);
+    
+    hash = hash_uint(hash);
+    axis.z = hash_to_unit_float(hash);
+    
+    return vec4(normalize(axis), MAX_ROTATION_ANGLE);
+}
@@ -0,0 +1,21 @@
+//
+// MeshDecoding.glsl
+//
+// Included by shaders reading Mesh vertices stored in a quantized VertexEncoding.
+//
+
+
+//---------------------------------------------------------------------------------------
+// Unit normal from its octahedral encoding, as written by Mesh for
+// VertexEncoding_Snorm16Octahedral.
+vec3 decode_octahedral_normal (
+    vec2 encoded
+) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    
+    // Unfold the lower hemisphere, which encoding folded over the upper.
+    float fold = max(-normal.z, 0.0);
+    normal.xy -= fold * (step(0.0, normal.xy) * 2.0 - 1.0);
+    
+    return normalize(normal);
+}
@@ -0,0 +1,59 @@
+//
+// ProceduralCube.glsl
+//
+// Included by cube shaders that build the unit cube from gl_VertexID, for draws
+// with no vertex or index buffers.
+//
+
+
+//---------------------------------------------------------------------------------------
+// Position and normal of vertex vertexID in [0, 36) of a unit cube centered on the
+// origin, with counter clockwise triangles seen from outside.
+void procedural_cube_vertex (
+    int vertexID,
+    out vec3 position,
+    out vec3 normal
+) {
+    int face = vertexID / 6;
+    int corner = vertexID - face * 6;
+
+    // Quad corner of each triangle vertex, 2 bits apiece: 0,1,2, 2,1,3.
+    int quadCorner = (0xDA4 >> (corner * 2)) & 3;
+    vec2 uv = vec2(float(quadCorner & 1), float(quadCorner >> 1));
+
+    // Faces come in -/+ pairs along x, y then z.
+    int axis = face >> 1;
+    float side = float(face & 1) * 2.0 - 1.0;
+
+    // Mirroring the quad on the negative side keeps its winding outward.
+    uv = (side < 0.0) ? uv.yx : uv;
+
+    // Unit vector along axis, and the two after it in cyclic order.
+    vec3 axisU = vec3(equal(ivec3(axis), ivec3(0, 1, 2)));
+    vec3 axisV = axisU.zxy;
+    vec3 axisW = axisU.yzx;
+
+    normal = side * axisU;
+    position = 0.5 * normal + (uv.x - 0.5) * axisV + (uv.y - 0.5) * axisW;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Position and normal of vertex vertexID in [0, 18) of the three faces of a unit cube
+// centered on the origin that face a viewer at eye, in cube space. A convex cube never
+// shows more than these, and any of them seen edge on is still back face culled.
+void procedural_visible_cube_vertex (
+    int vertexID,
+    vec3 eye,
+    out vec3 position,
+    out vec3 normal
+) {
+    // One face per axis, on the side of the eye.
+    int axis = vertexID / 6;
+    int corner = vertexID - axis * 6;
+    
+    vec3 axisU = vec3(equal(ivec3(axis), ivec3(0, 1, 2)));
+    int side = int(dot(eye, axisU) >= 0.0);
+    
+    procedural_cube_vertex((axis * 2 + side) * 6 + corner, position, normal);
+}
@@ -0,0 +1,34 @@
+//
+// QuaternionRotation.glsl
+//
+// Included by shaders that orient positions about an axis.
+//
+
+
+//---------------------------------------------------------------------------------------
+vec4 quat_from_axis_angle (
+    vec3 axis,   // Axis of rotation, assumed normalized.
+    float angle  // Angle of rotation in radians.
+) {
+    vec4 q;
+    float half_angle = angle * 0.5;
+    float sin_half_angle = sin(half_angle);
+    q.x = axis.x * sin_half_angle;
+    q.y = axis.y * sin_half_angle;
+    q.z = axis.z * sin_half_angle;
+    q.w = cos(half_angle);
+    
+    return q;
+}
+
+
+//---------------------------------------------------------------------------------------
+vec3 rotate_position (
+    vec3 position,
+    vec3 axis,   // Axis of rotation, assumed noralized.
+    float angle  // Angle of rotation in radians.
+) {
+    vec4 q = quat_from_axis_angle(axis, angle);
+    vec3 v = position.xyz;
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
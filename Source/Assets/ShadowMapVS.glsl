@@ -2,59 +2,74 @@
 // ShadowMapVS.glsl
 //
 #version 300 es
-#define ATTRIBUTE_POSITION    0
-#define ATTRIBUTE_INSTANCE_0  3
-#define ATTRIBUTE_INSTANCE_1  4
+#include "VertexAttributeDefines.h"
 
-layout(location = ATTRIBUTE_POSITION) in vec3 position;
+#ifndef PROCEDURAL_CUBE
+layout(location = ATTRIBUTE_POSITION) in vec3 vertexPosition;
+#endif
 layout(location = ATTRIBUTE_INSTANCE_0) in vec3 instancePos;
 
-// .xyz: Axis of rotation
-// .w  : Max angle
-layout(location = ATTRIBUTE_INSTANCE_1) in vec4 orientation;
 
+// Per frame parameters, see ShadowPassUniforms in Renderer.cpp
+layout(std140)
+uniform ShadowPass {
+    highp mat4 modelMatrix;
+    highp mat4 lightViewMatrix;
+    highp mat4 lightProjectMatrix;
+    highp float cubeRandomness;  // [0,1] degree of randomness.
+    highp float pointScale;      // Splat diameter in pixels at clip space w = 1.
+    highp float depthScale;      // 1 / light far plane, maps linear depth to [0,1].
+    highp float splatOpacity;    // Peak opacity at center of splat.
+    highp uint orientationSeed;  // Hashed with gl_InstanceID to orient each cube.
+};
 
-uniform mat4 modelMatrix;
-uniform mat4 lightViewMatrix;
-uniform mat4 lightProjectMatrix;
-
-uniform float cubeRandomness;  // [0,1] degree of randomness.
-
-//---------------------------------------------------------------------------------------
-vec4 quat_from_axis_angle (
-    vec3 axis,   // Axis of rotation, assumed normalized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q;
-    float half_angle = angle * 0.5;
-    float sin_half_angle = sin(half_angle);
-    q.x = axis.x * sin_half_angle;
-    q.y = axis.y * sin_half_angle;
-    q.z = axis.z * sin_half_angle;
-    q.w = cos(half_angle);
-    
-    return q;
-}
-
-
-//---------------------------------------------------------------------------------------
-vec3 rotate_position (
-    vec3 position,
-    vec3 axis,   // Axis of rotation, assumed noralized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q = quat_from_axis_angle(axis, angle);
-    vec3 v = position.xyz;
-    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
-}
+#ifndef PROCEDURAL_CUBE
+// Maps stored mesh positions back to cube space, see CubeMeshUniforms in Renderer.cpp
+layout(std140)
+uniform CubeMesh {
+    vec3 positionScale;
+    vec3 positionBias;
+};
+#endif
 
+#include "QuaternionRotation.glsl"
+#include "InstanceOrientation.glsl"
+#include "ProceduralCube.glsl"
 
 //---------------------------------------------------------------------------------------
 void main() {
+#ifndef NO_ROTATION
     // Orient cube in Local Model Space based on cubeRandomness.
+    vec4 orientation = instance_orientation(gl_InstanceID, orientationSeed);
     vec3 axis = orientation.xyz;
     float angle = orientation.w * cubeRandomness;
+#endif
+    
+#if defined(VISIBLE_FACES)
+    // Variant drawing only the faces toward the light, as CubeVS does for the camera.
+    vec3 light_worldSpace = -(lightViewMatrix[3].xyz * mat3(lightViewMatrix));
+    vec3 eye = (2.0 * light_worldSpace - instancePos) * mat3(modelMatrix);
+#ifndef NO_ROTATION
+    eye = rotate_position(eye, axis, -angle);
+#endif
+    vec3 position;
+    vec3 normal;
+    procedural_visible_cube_vertex(gl_VertexID, eye, position, normal);
+#elif defined(PROCEDURAL_CUBE)
+    // Variant drawn without vertex buffers, the only fetch is per instance.
+    vec3 position;
+    vec3 normal;
+    procedural_cube_vertex(gl_VertexID, position, normal);
+#else
+    vec3 position = vertexPosition * positionScale + positionBias;
+#endif
+    
+#ifdef NO_ROTATION
+    // Variant for cubeRandomness == 0, leaving every cube unrotated.
+    vec3 orientedPosition = position;
+#else
     vec3 orientedPosition = rotate_position(position, axis, angle);
+#endif
     
     vec4 pos = vec4(orientedPosition, 1.0);
     
@@ -0,0 +1,35 @@
+//
+// ShadowSplatFS.glsl
+//
+#version 300 es
+
+precision mediump float;
+
+// Per frame parameters, see ShadowPassUniforms in Renderer.cpp
+layout(std140)
+uniform ShadowPass {
+    highp mat4 modelMatrix;
+    highp mat4 lightViewMatrix;
+    highp mat4 lightProjectMatrix;
+    highp float cubeRandomness;  // [0,1] degree of randomness.
+    highp float pointScale;      // Splat diameter in pixels at clip space w = 1.
+    highp float depthScale;      // 1 / light far plane, maps linear depth to [0,1].
+    highp float splatOpacity;    // Peak opacity at center of splat.
+    highp uint orientationSeed;  // Hashed with gl_InstanceID to orient each cube.
+};
+
+out vec4 fragColor;
+
+
+void main()
+{
+    // Radial falloff from center of point sprite.
+    vec2 d = (gl_PointCoord * 2.0) - 1.0;
+    float r2 = dot(d, d);
+    if (r2 > 1.0) {
+        discard;
+    }
+    
+    // Opacity is accumulated with blend func (ONE, ONE_MINUS_SRC_COLOR).
+    fragColor = vec4(splatOpacity * (1.0 - r2));
+}
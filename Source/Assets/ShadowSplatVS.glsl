@@ -0,0 +1,34 @@
+//
+// ShadowSplatVS.glsl
+//
+#version 300 es
+#include "VertexAttributeDefines.h"
+
+layout(location = ATTRIBUTE_INSTANCE_0) in vec3 instancePos;
+
+
+// Per frame parameters, see ShadowPassUniforms in Renderer.cpp
+layout(std140)
+uniform ShadowPass {
+    highp mat4 modelMatrix;
+    highp mat4 lightViewMatrix;
+    highp mat4 lightProjectMatrix;
+    highp float cubeRandomness;  // [0,1] degree of randomness.
+    highp float pointScale;      // Splat diameter in pixels at clip space w = 1.
+    highp float depthScale;      // 1 / light far plane, maps linear depth to [0,1].
+    highp float splatOpacity;    // Peak opacity at center of splat.
+    highp uint orientationSeed;  // Hashed with gl_InstanceID to orient each cube.
+};
+
+
+//---------------------------------------------------------------------------------------
+void main() {
+    // Each particle is splatted as a single point, centered at the cube's position.
+    // w = 2 matches the cube passes, which draw each cube at half scale about
+    // instancePos / 2.
+    gl_Position = lightProjectMatrix * (lightViewMatrix * vec4(instancePos, 2.0));
+    
+    // Shrink splat with distance from light. gl_Position.w is twice the light space
+    // depth, which also halves the splat to the half scale cube.
+    gl_PointSize = max(1.0, pointScale / gl_Position.w);
+}
@@ -2,62 +2,44 @@
 // TornadoParticleSimVS.glsl
 //
 #version 300 es
-#define ATTRIBUTE_SLOT_0      0
-#define ATTRIBUTE_SLOT_1      1
+#include "VertexAttributeDefines.h"
 
 #define TWO_PI 6.283185
 
+// Diameter of the bounding sphere of a unit cube, sqrt(3).
+#define CUBE_BOUNDING_DIAMETER 1.732051
+
 layout(location = ATTRIBUTE_SLOT_0) in float parametricDist;  // [0,1] Distance along Bezier Curve.
 layout(location = ATTRIBUTE_SLOT_1) in float rotationAngle;   // Current rotation angle about orbit.
 
 
-// Particle motion will inolve rotation about Bezier curve tangents
-// Bezier Curve
-uniform mat4 basisMatrix;      // B(t)
-uniform mat4 derivMatrix;      // B'(t), derivative matrix padded with extra zeros.
+// Per frame parameters, see ParticleSimUniforms in ParticleSystem.hpp
+layout(std140)
+uniform ParticleSim {
+    // Particle motion will inolve rotation about Bezier curve tangents
+    // Bezier Curve
+    mat4 basisMatrix;      // B(t)
+    mat4 derivMatrix;      // B'(t), derivative matrix padded with extra zeros.
+    
+    float deltaTime;           // dt, time delta.
+    float particleRandomness;  // [0,1], particle motion randomness factor.
+    float numActiveParticles;  // Number of active partices.
+    float pixelScale;          // Pixels across one world unit at clip space w = 1.
+    mat4 viewProjectMatrix;    // Camera for measuring projected particle size.
+};
 
-uniform float deltaTime;           // dt, time delta.
 uniform float rotationRadius;      // Radius of rotation about Bezier curve.
 uniform float rotationalVelocity;  // Radians per second.
 uniform float parametricVelocity;  // Parametric distance along Bezier curve per second.
-uniform float particleRandomness;  // [0,1], particle motion randomness factor.
-uniform float numActiveParticles;  // Number of active partices.
-
-
-out VsOut {
-    vec3 position;
-    float parametricDist;
-    float rotationAngle;
-} vsOut;
 
 
-//---------------------------------------------------------------------------------------
-vec4 quat_from_axis_angle (
-    vec3 axis,   // Axis of rotation, assumed normalized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q;
-    float half_angle = angle * 0.5;
-    float sin_half_angle = sin(half_angle);
-    q.x = axis.x * sin_half_angle;
-    q.y = axis.y * sin_half_angle;
-    q.z = axis.z * sin_half_angle;
-    q.w = cos(half_angle);
-    
-    return q;
-}
-
+// Captured by transform feedback.
+out vec3 vsOut_position;
+out float vsOut_parametricDist;
+out float vsOut_rotationAngle;
+out float vsOut_projectedSize;  // Pixels across the particle's cube on screen.
 
-//---------------------------------------------------------------------------------------
-vec3 rotate_position (
-    vec3 position,
-    vec3 axis,   // Axis of rotation, assumed noralized.
-    float angle  // Angle of rotation in radians.
-) {
-    vec4 q = quat_from_axis_angle(axis, angle);
-    vec3 v = position.xyz;
-    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
-}
+#include "QuaternionRotation.glsl"
 
 
 //---------------------------------------------------------------------------------------
@@ -121,10 +103,15 @@ void main() {
     vec3 axisOfRotation = B_tangent(t);
     float angle = rotationAngle + (deltaTime * rotationalVelocity * (1.0 + particleRandomness));
     
+#ifdef NO_DEBRIS
+    // Variant for particleRandomness below 5%, which has no debris particles.
+    float debrisDistance = 0.0;
+#else
     // Extra distance from curve for debris particles
     float vertexID = float(gl_VertexID);
     float debrisDistance = step(vertexID, numActiveParticles * 0.1 * particleRandomness);
     debrisDistance *= step(0.05, particleRandomness); // No debris particles below 5% particlRandomness
+#endif
     
     // Increase conicSpread slightly with increase in numActiveParticles.
     float crowdingfactor = 1.0 + numActiveParticles * 0.0005;
@@ -136,7 +123,14 @@ void main() {
         rotate_position_about_point(updatedPosition, axisOfRotation, angle, pointOnCurve);
     
     // Outputs
-    vsOut.position = updatedPosition;
-    vsOut.parametricDist = newParametricDist;
-    vsOut.rotationAngle = angle;
+    vsOut_position = updatedPosition;
+    vsOut_parametricDist = newParametricDist;
+    vsOut_rotationAngle = angle;
+    
+    // Measured here once per particle, so the renderer can pick impostors per instance.
+    // CubeVS draws each cube as a point with w = 2, at half scale about half the
+    // particle position, which cancels out in the ratio below.
+    vec4 position_clipSpace = viewProjectMatrix * vec4(updatedPosition, 2.0);
+    vsOut_projectedSize =
+        CUBE_BOUNDING_DIAMETER * pixelScale / max(position_clipSpace.w, 1.0e-4);
 }
\ No newline at end of file
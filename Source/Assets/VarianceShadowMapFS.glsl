@@ -0,0 +1,35 @@
+//
+// VarianceShadowMapFS.glsl
+//
+#version 300 es
+
+precision highp float;
+
+// Per frame parameters, see ShadowPassUniforms in Renderer.cpp
+layout(std140)
+uniform ShadowPass {
+    highp mat4 modelMatrix;
+    highp mat4 lightViewMatrix;
+    highp mat4 lightProjectMatrix;
+    highp float cubeRandomness;  // [0,1] degree of randomness.
+    highp float pointScale;      // Splat diameter in pixels at clip space w = 1.
+    highp float depthScale;      // 1 / light far plane, maps linear depth to [0,1].
+    highp float splatOpacity;    // Peak opacity at center of splat.
+    highp uint orientationSeed;  // Hashed with gl_InstanceID to orient each cube.
+};
+
+layout(location = 0) out vec2 moments;
+
+
+void main()
+{
+    // Linear light space depth, since perspective depth is too compressed for the
+    // precision of a half float moments texture. ShadowMapVS ends with w = 2, so
+    // 1 / gl_FragCoord.w is twice the light space depth.
+    float depth = 0.5 * depthScale / gl_FragCoord.w;
+    
+    // Bias second moment by the depth slope across the pixel to reduce acne.
+    float dx = dFdx(depth);
+    float dy = dFdy(depth);
+    moments = vec2(depth, (depth * depth) + 0.25 * ((dx * dx) + (dy * dy)));
+}
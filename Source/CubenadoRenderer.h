@@ -4,18 +4,15 @@
 
 #import <Foundation/NSObject.h>
 #import <Foundation/NSDate.h>
+#import <Foundation/NSString.h>
+
+#import "RendererTypes.h"
 
 // Forward declaration
 @class GLKView;
 
 
-struct FramebufferSize {
-    GLint width;
-    GLint height;
-};
-typedef struct FramebufferSize FramebufferSize;
-
-
+// Drives a Renderer from a GLKView.
 @interface CubenadoRenderer : NSObject
 
 - (instancetype)initWithFramebufferSize: (FramebufferSize)framebufferSize
@@ -31,4 +28,26 @@ typedef struct FramebufferSize FramebufferSize;
 
 - (void) setCubeRandomness: (float)cubeRandomness;
 
+// ShadowTechnique_Automatic, the default, splats shadows at 100K cubes or more.
+// Falls back to ShadowTechnique_DepthCompare if the technique is unsupported.
+- (void) setShadowTechnique: (ShadowTechnique)shadowTechnique;
+
+- (void) setCubeGeometry: (CubeGeometry)cubeGeometry;
+
+// Draws a mesh written by ImportMesh in place of the cube. Returns NO if path is not a
+// valid mesh file.
+- (BOOL) loadCubeMesh: (NSString *)path;
+
+// Cubes fewer than pixels across are drawn as ray cast impostors, 0 turns them off.
+- (void) setImpostorThreshold: (float)pixels;
+
+// Frames slower than milliseconds are recorded as hitches, 50 ms by default.
+- (void) setHitchThreshold: (double)milliseconds;
+
+// Frame time percentiles, histogram and recent hitches since creation or the last
+// reset. A frame is measured from one update: to the next.
+- (NSString *) frameStatisticsReport;
+
+- (void) resetFrameStatistics;
+
 @end
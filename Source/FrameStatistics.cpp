@@ -0,0 +1,348 @@
+//
+//  FrameStatistics.cpp
+//
+
+#include "FrameStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+namespace {
+    // Bucket layout, see FrameStatistics. Values are in microseconds.
+    const uint SubBucketBits = 7;
+    const uint SubBucketCount = 1u << SubBucketBits;
+    const uint HalfSubBucketCount = SubBucketCount / 2;
+    const uint64 MaxTrackedValue = (1ull << 32) - 1;
+    const uint NumBuckets = SubBucketCount + (32 - SubBucketBits) * HalfSubBucketCount;
+
+    // Upper edges in milliseconds of the coarse histogram in reports, around common
+    // display refresh intervals.
+    const double ReportBinEdges[] = {
+        4.0, 8.3, 11.1, 16.7, 20.0, 25.0, 33.3, 50.0, 66.7, 100.0, 250.0, 1000.0
+    };
+    const uint NumReportBins = sizeof(ReportBinEdges) / sizeof(ReportBinEdges[0]) + 1;
+
+    const double ReportPercentiles[] = { 50.0, 90.0, 95.0, 99.0, 99.9 };
+
+
+    //-----------------------------------------------------------------------------------
+    uint bucketIndex(uint64 value)
+    {
+        value = std::min(value, MaxTrackedValue);
+        if (value < SubBucketCount) {
+            return static_cast<uint>(value);
+        }
+
+        const uint msb = 63 - __builtin_clzll(value);
+        const uint shift = msb - (SubBucketBits - 1);
+        const uint subBucket = static_cast<uint>(value >> shift);
+
+        return SubBucketCount + (shift - 1) * HalfSubBucketCount +
+               (subBucket - HalfSubBucketCount);
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Smallest value and width of the values recorded in bucket index.
+    void bucketRange(uint index, uint64 & lowest, uint64 & width)
+    {
+        if (index < SubBucketCount) {
+            lowest = index;
+            width = 1;
+            return;
+        }
+
+        const uint offset = index - SubBucketCount;
+        const uint shift = offset / HalfSubBucketCount + 1;
+        const uint64 subBucket = offset % HalfSubBucketCount + HalfSubBucketCount;
+
+        lowest = subBucket << shift;
+        width = 1ull << shift;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    uint64 toMicroseconds(double milliseconds)
+    {
+        return static_cast<uint64>(std::max(0.0, std::round(milliseconds * 1000.0)));
+    }
+}
+
+
+class FrameStatisticsImpl {
+private:
+    friend class FrameStatistics;
+
+    uint64 m_counts[NumBuckets];
+    uint64 m_numFrames;
+    uint64 m_maxMicroseconds;
+    double m_totalMilliseconds;
+
+    double m_hitchThresholdMilliseconds;
+
+    // Ring of the most recent hitches.
+    FrameHitch m_hitches[FrameStatistics::MaxHitches];
+    uint64 m_numHitches;
+
+
+    FrameStatisticsImpl(double hitchThresholdMilliseconds);
+
+    void reset();
+};
+
+
+//---------------------------------------------------------------------------------------
+FrameStatisticsImpl::FrameStatisticsImpl (
+    double hitchThresholdMilliseconds
+)
+    : m_hitchThresholdMilliseconds(hitchThresholdMilliseconds)
+{
+    reset();
+}
+
+
+//---------------------------------------------------------------------------------------
+void FrameStatisticsImpl::reset()
+{
+    std::fill(m_counts, m_counts + NumBuckets, 0);
+    m_numFrames = 0;
+    m_maxMicroseconds = 0;
+    m_totalMilliseconds = 0.0;
+    m_numHitches = 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+FrameStatistics::FrameStatistics (
+    double hitchThresholdMilliseconds
+) {
+    impl = new FrameStatisticsImpl(hitchThresholdMilliseconds);
+}
+
+
+//---------------------------------------------------------------------------------------
+FrameStatistics::~FrameStatistics()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+void FrameStatistics::setHitchThreshold (
+    double hitchThresholdMilliseconds
+) {
+    impl->m_hitchThresholdMilliseconds = hitchThresholdMilliseconds;
+}
+
+
+//---------------------------------------------------------------------------------------
+double FrameStatistics::hitchThreshold() const
+{
+    return impl->m_hitchThresholdMilliseconds;
+}
+
+
+//---------------------------------------------------------------------------------------
+void FrameStatistics::recordFrame (
+    double frameMilliseconds,
+    double updateMilliseconds,
+    double renderMilliseconds,
+    const GpuStageTimes * gpuStageTimes
+) {
+    const uint64 microseconds = toMicroseconds(frameMilliseconds);
+
+    ++impl->m_counts[bucketIndex(microseconds)];
+    impl->m_maxMicroseconds = std::max(impl->m_maxMicroseconds,
+                                       std::min(microseconds, MaxTrackedValue));
+    impl->m_totalMilliseconds += frameMilliseconds;
+    const uint64 frameNumber = impl->m_numFrames++;
+
+    if (frameMilliseconds <= impl->m_hitchThresholdMilliseconds) {
+        return;
+    }
+
+    FrameHitch & hitch = impl->m_hitches[impl->m_numHitches % MaxHitches];
+    ++impl->m_numHitches;
+
+    hitch.frameNumber = frameNumber;
+    hitch.frameMilliseconds = frameMilliseconds;
+    hitch.updateMilliseconds = updateMilliseconds;
+    hitch.renderMilliseconds = renderMilliseconds;
+    hitch.hasGpuStageTimes = (gpuStageTimes != nullptr);
+    if (gpuStageTimes) {
+        hitch.gpuStageTimes = *gpuStageTimes;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 FrameStatistics::numFrames() const
+{
+    return impl->m_numFrames;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 FrameStatistics::numHitches() const
+{
+    return impl->m_numHitches;
+}
+
+
+//---------------------------------------------------------------------------------------
+double FrameStatistics::meanMilliseconds() const
+{
+    if (impl->m_numFrames == 0) {
+        return 0.0;
+    }
+
+    return impl->m_totalMilliseconds / impl->m_numFrames;
+}
+
+
+//---------------------------------------------------------------------------------------
+double FrameStatistics::maxMilliseconds() const
+{
+    return impl->m_maxMicroseconds * 1e-3;
+}
+
+
+//---------------------------------------------------------------------------------------
+double FrameStatistics::percentileMilliseconds (
+    double percentile
+) const {
+    if (impl->m_numFrames == 0) {
+        return 0.0;
+    }
+
+    // Nearest rank.
+    const double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+    const uint64 rank = std::max<uint64>(1, static_cast<uint64>(
+        std::ceil(fraction * impl->m_numFrames)));
+
+    uint64 numBelow = 0;
+    for (uint i = 0; i < NumBuckets; ++i) {
+        numBelow += impl->m_counts[i];
+        if (numBelow >= rank) {
+            uint64 lowest, width;
+            bucketRange(i, lowest, width);
+
+            // Middle of the bucket, but never beyond the slowest frame seen.
+            const uint64 value = std::min(lowest + (width - 1) / 2, impl->m_maxMicroseconds);
+            return value * 1e-3;
+        }
+    }
+
+    return maxMilliseconds();
+}
+
+
+//---------------------------------------------------------------------------------------
+std::string FrameStatistics::report() const
+{
+    std::string text;
+    char line[256];
+
+    snprintf(line, sizeof(line), "frames: %llu, mean %.3f ms, max %.3f ms\n",
+             static_cast<unsigned long long>(impl->m_numFrames), meanMilliseconds(),
+             maxMilliseconds());
+    text += line;
+
+    text += "percentiles (ms):";
+    for (double percentile : ReportPercentiles) {
+        snprintf(line, sizeof(line), " p%g %.3f", percentile,
+                 percentileMilliseconds(percentile));
+        text += line;
+    }
+    text += "\n";
+
+    // Coarse histogram, from each bucket's smallest value.
+    uint64 binCounts[NumReportBins] = {};
+    for (uint i = 0; i < NumBuckets; ++i) {
+        if (impl->m_counts[i] == 0) {
+            continue;
+        }
+
+        uint64 lowest, width;
+        bucketRange(i, lowest, width);
+        const double * edge = std::upper_bound(ReportBinEdges,
+                                                ReportBinEdges + NumReportBins - 1,
+                                                lowest * 1e-3);
+        binCounts[edge - ReportBinEdges] += impl->m_counts[i];
+    }
+
+    text += "histogram (ms):\n";
+    for (uint bin = 0; bin < NumReportBins; ++bin) {
+        if (binCounts[bin] == 0) {
+            continue;
+        }
+
+        const double lower = (bin == 0) ? 0.0 : ReportBinEdges[bin - 1];
+        if (bin + 1 < NumReportBins) {
+            snprintf(line, sizeof(line), "  [%7.1f, %7.1f)  %llu\n", lower,
+                     ReportBinEdges[bin], static_cast<unsigned long long>(binCounts[bin]));
+        } else {
+            snprintf(line, sizeof(line), "  [%7.1f,     inf)  %llu\n", lower,
+                     static_cast<unsigned long long>(binCounts[bin]));
+        }
+        text += line;
+    }
+
+    snprintf(line, sizeof(line), "hitches over %.1f ms: %llu\n",
+             impl->m_hitchThresholdMilliseconds,
+             static_cast<unsigned long long>(impl->m_numHitches));
+    text += line;
+
+    // Oldest retained hitch first.
+    const uint64 numRetained = std::min<uint64>(impl->m_numHitches, MaxHitches);
+    for (uint64 i = impl->m_numHitches - numRetained; i < impl->m_numHitches; ++i) {
+        const FrameHitch & hitch = impl->m_hitches[i % MaxHitches];
+
+        snprintf(line, sizeof(line),
+                 "  frame %llu: %.3f ms (cpu update %.3f, render %.3f)",
+                 static_cast<unsigned long long>(hitch.frameNumber),
+                 hitch.frameMilliseconds, hitch.updateMilliseconds,
+                 hitch.renderMilliseconds);
+        text += line;
+
+        if (hitch.hasGpuStageTimes) {
+            text += " gpu";
+            for (int stage = 0; stage < RenderStage_Count; ++stage) {
+                snprintf(line, sizeof(line), " %s %.3f",
+                         renderStageName(static_cast<RenderStage>(stage)),
+                         hitch.gpuStageTimes.milliseconds[stage]);
+                text += line;
+            }
+        }
+        text += "\n";
+    }
+
+    return text;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool FrameStatistics::writeReport (
+    const std::string & filePath
+) const {
+    FILE * file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    const std::string text = report();
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void FrameStatistics::reset()
+{
+    impl->reset();
+}
@@ -0,0 +1,82 @@
+//
+//  FrameStatistics.hpp
+//
+
+#pragma once
+
+#include <string>
+
+#include "NumericTypes.h"
+#include "GpuTimerQueries.hpp"
+
+
+// Forward declaration
+class FrameStatisticsImpl;
+
+
+// A frame that took longer than the hitch threshold, with what it was spending time on.
+struct FrameHitch {
+    uint64 frameNumber;
+
+    double frameMilliseconds;
+
+    // CPU time spent in update and render.
+    double updateMilliseconds;
+    double renderMilliseconds;
+
+    // GPU stage times latest available when the hitch was recorded, which usually
+    // belong to a frame a few frames earlier.
+    bool hasGpuStageTimes;
+    GpuStageTimes gpuStageTimes;
+};
+
+
+// Tracks the distribution of frame times and captures hitches, in fixed memory.
+//
+// Frame times are kept in an HDR style log-linear histogram: linear buckets of 1 us up
+// to 128 us, then 64 buckets per power of two, so any recorded value is reported to
+// within 1.6%. Values up to about 70 minutes are tracked, and longer ones are clamped.
+// The most recent MaxHitches hitches are kept, along with a count of all of them.
+class FrameStatistics {
+public:
+    static const uint MaxHitches = 32;
+
+    explicit FrameStatistics(double hitchThresholdMilliseconds = 50.0);
+
+    ~FrameStatistics();
+
+    void setHitchThreshold(double hitchThresholdMilliseconds);
+
+    double hitchThreshold() const;
+
+    // gpuStageTimes may be null when GPU timing is unavailable.
+    void recordFrame (
+        double frameMilliseconds,
+        double updateMilliseconds,
+        double renderMilliseconds,
+        const GpuStageTimes * gpuStageTimes
+    );
+
+    uint64 numFrames() const;
+
+    uint64 numHitches() const;
+
+    double meanMilliseconds() const;
+
+    double maxMilliseconds() const;
+
+    // Frame time that percentile percent of frames are no slower than, e.g. 99.0.
+    // Returns zero when no frames have been recorded.
+    double percentileMilliseconds(double percentile) const;
+
+    // Human readable summary: percentiles, a coarse histogram and recent hitches.
+    std::string report() const;
+
+    // Returns false if the file cannot be written.
+    bool writeReport(const std::string & filePath) const;
+
+    void reset();
+
+private:
+    FrameStatisticsImpl * impl;
+};
@@ -1,7 +1,7 @@
 //
 //  GLCheckErrors.cpp
 //
-#import "GlCheckErrors.h"
+#import "GLCheckErrors.h"
 
 #include <string>
 using std::string;
@@ -40,6 +40,10 @@ const char * getErrorString (
             result = "GL_OUT_OF_MEMORY";
             break;
             
+        case GL_INVALID_FRAMEBUFFER_OPERATION:
+            result = "GL_INVALID_FRAMEBUFFER_OPERATION";
+            break;
+            
         case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
             result = "GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT";
             break;
@@ -65,16 +69,30 @@ const char * getErrorString (
 }
 
 
+namespace {
+#if defined(DEBUG)
+    GLErrorCheckMode g_checkMode = GLErrorCheckMode_EveryCall;
+#else
+    GLErrorCheckMode g_checkMode = GLErrorCheckMode_Sampled;
+#endif
+
+    // Sampled mode counts checks within a frame, and checks the one whose index
+    // matches g_sampledCheck.
+    uint g_numChecksThisFrame = 0;
+    uint g_sampledCheck = 0;
+}
+
+
 //---------------------------------------------------------------------------------------
-void checkGLErrors (
+// Appends all pending errors to errorMessage. Returns true if there were any.
+static bool collectGLErrors (
     const char * currentFileName,
-    int currentLine
+    int currentLine,
+    std::stringstream & errorMessage
 ) {
     GLenum errorCode;
     bool errorFound = false;
     
-    std::stringstream errorMessage;
-    
     // Write all errors to errorMessage stringstream until error list is exhausted.
     do {
         errorCode = glGetError();
@@ -92,9 +110,61 @@ void checkGLErrors (
         }
     } while (errorCode != GL_NO_ERROR);
     
-    if (errorFound) {
-        cout << errorMessage.str() << endl;
-        throw;
+    return errorFound;
+}
+
+
+//---------------------------------------------------------------------------------------
+void setGLErrorCheckMode (
+    GLErrorCheckMode mode
+) {
+    g_checkMode = mode;
+}
+
+
+//---------------------------------------------------------------------------------------
+GLErrorCheckMode glErrorCheckMode()
+{
+    return g_checkMode;
+}
+
+
+//---------------------------------------------------------------------------------------
+void beginGLErrorCheckFrame()
+{
+    // Visit every site over successive frames, even if the number of checks per frame
+    // changes.
+    g_sampledCheck = (g_numChecksThisFrame > 0) ?
+            (g_sampledCheck + 1) % g_numChecksThisFrame : 0;
+    g_numChecksThisFrame = 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+void checkGLErrors (
+    const char * currentFileName,
+    int currentLine
+) {
+    std::stringstream errorMessage;
+    
+    switch (g_checkMode) {
+        case GLErrorCheckMode_EveryCall:
+            if (collectGLErrors(currentFileName, currentLine, errorMessage)) {
+                cout << errorMessage.str() << endl;
+                throw;
+            }
+            break;
+            
+        case GLErrorCheckMode_Sampled:
+            if (g_numChecksThisFrame++ == g_sampledCheck &&
+                collectGLErrors(currentFileName, currentLine, errorMessage)) {
+                cout << "Sampled check, raised at or before this site:" << endl
+                     << errorMessage.str() << endl;
+            }
+            break;
+            
+        case GLErrorCheckMode_Off:
+            break;
     }
 }
 
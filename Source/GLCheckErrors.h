@@ -5,7 +5,9 @@
 #pragma once
 
 
-#if defined(DEBUG)
+// CHECK_GL_ERRORS is compiled in for DEBUG builds, and for other builds that define
+// GL_ERROR_SAMPLING so that errors can still be caught in performance builds.
+#if defined(DEBUG) || defined(GL_ERROR_SAMPLING)
 #define CHECK_GL_ERRORS checkGLErrors(__FILE__, __LINE__)
 #else
 #define CHECK_GL_ERRORS
@@ -17,7 +19,28 @@
 #define CHECK_FRAMEBUFFER_COMPLETENESS
 #endif
 
+
+enum GLErrorCheckMode {
+    // glGetError at every CHECK_GL_ERRORS, stopping at the first error. Each check
+    // waits for the driver, so timings are meaningless. The default in DEBUG builds.
+    GLErrorCheckMode_EveryCall,
+
+    // glGetError at one CHECK_GL_ERRORS per frame, moving on to the next site each
+    // frame, and logging rather than stopping. An error is reported at the first
+    // sampled site after it was raised. The default with GL_ERROR_SAMPLING.
+    GLErrorCheckMode_Sampled,
+
+    // No glGetError calls, e.g. when GLDebugOutput reports errors instead.
+    GLErrorCheckMode_Off
+};
+
+void setGLErrorCheckMode(GLErrorCheckMode mode);
+
+GLErrorCheckMode glErrorCheckMode();
+
+// Call once at the start of each frame, to advance the sampled check site.
+void beginGLErrorCheckFrame();
+
 void checkGLErrors(const char * currentFileName, int currentLineNumber);
 
 void checkFramebufferCompleteness();
-
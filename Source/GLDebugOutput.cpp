@@ -0,0 +1,187 @@
+//
+//  GLDebugOutput.cpp
+//
+
+#include "GLDebugOutput.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+#include "GLPlatform.h"
+#include "GLExtensions.hpp"
+
+
+namespace {
+    std::atomic<uint64> g_numMessages(0);
+    std::atomic<uint64> g_numSuppressedMessages(0);
+}
+
+
+#if defined(__APPLE__)
+
+//---------------------------------------------------------------------------------------
+bool GLDebugOutput::enable (
+    GLDebugSeverity,
+    uint
+) {
+    return false;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLDebugOutput::disable()
+{
+
+}
+
+#else
+
+// Mesa's libGLESv2 exports the OpenGL ES 3.2 names for the KHR_debug entry points,
+// but not the KHR suffixed ones.
+extern "C" {
+    GL_APICALL void GL_APIENTRY glDebugMessageCallback (
+        GLDEBUGPROCKHR callback,
+        const void *
+    );
+
+    GL_APICALL void GL_APIENTRY glDebugMessageControl (
+        GLenum source,
+        GLenum type,
+        GLenum severity,
+        GLsizei count,
+        const GLuint * ids,
+        GLboolean enabled
+    );
+}
+
+
+namespace {
+    // Report counts, indexed by a hash of each message's source, type and id. Messages
+    // sharing a slot share a limit, which only makes suppression start early.
+    const uint NumReportCountSlots = 256;
+    std::atomic<uint> g_reportCounts[NumReportCountSlots];
+
+    std::atomic<uint> g_maxReportsPerMessage(0);
+
+    const GLenum SeverityEnums[] = {
+        GL_DEBUG_SEVERITY_NOTIFICATION_KHR,
+        GL_DEBUG_SEVERITY_LOW_KHR,
+        GL_DEBUG_SEVERITY_MEDIUM_KHR,
+        GL_DEBUG_SEVERITY_HIGH_KHR
+    };
+
+
+    //-----------------------------------------------------------------------------------
+    const char * severityName(GLenum severity)
+    {
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH_KHR: return "high";
+            case GL_DEBUG_SEVERITY_MEDIUM_KHR: return "medium";
+            case GL_DEBUG_SEVERITY_LOW_KHR: return "low";
+            default: return "notification";
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    const char * typeName(GLenum type)
+    {
+        switch (type) {
+            case GL_DEBUG_TYPE_ERROR_KHR: return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR_KHR: return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR_KHR: return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY_KHR: return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE_KHR: return "performance";
+            case GL_DEBUG_TYPE_MARKER_KHR: return "marker";
+            default: return "other";
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    void GL_APIENTRY debugMessageCallback (
+        GLenum source,
+        GLenum type,
+        GLuint id,
+        GLenum severity,
+        GLsizei,
+        const GLchar * message,
+        const void *
+    ) {
+        g_numMessages.fetch_add(1, std::memory_order_relaxed);
+
+        const uint slot = (source * 31u + type * 17u + id) % NumReportCountSlots;
+        const uint numReports = g_reportCounts[slot].fetch_add(1, std::memory_order_relaxed);
+        const uint maxReports = g_maxReportsPerMessage.load(std::memory_order_relaxed);
+
+        if (numReports >= maxReports) {
+            g_numSuppressedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        fprintf(stderr, "GL debug (%s, %s, id %u): %s%s\n", typeName(type),
+                severityName(severity), id, message,
+                (numReports + 1 == maxReports) ? " [further repeats suppressed]" : "");
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+bool GLDebugOutput::enable (
+    GLDebugSeverity minimumSeverity,
+    uint maxReportsPerMessage
+) {
+    if (!isGLExtensionSupported("GL_KHR_debug")) {
+        return false;
+    }
+
+    for (std::atomic<uint> & count : g_reportCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    g_maxReportsPerMessage.store(maxReportsPerMessage, std::memory_order_relaxed);
+    g_numMessages.store(0, std::memory_order_relaxed);
+    g_numSuppressedMessages.store(0, std::memory_order_relaxed);
+
+    // Let the driver drop messages below minimumSeverity, so they cost nothing here.
+    for (int severity = GLDebugSeverity_Notification; severity <= GLDebugSeverity_High;
+         ++severity) {
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, SeverityEnums[severity], 0,
+                              nullptr, severity >= minimumSeverity ? GL_TRUE : GL_FALSE);
+    }
+
+    glDebugMessageCallback(debugMessageCallback, nullptr);
+
+    // GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR is left disabled, so the driver need not
+    // serialize to report messages.
+    glEnable(GL_DEBUG_OUTPUT_KHR);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLDebugOutput::disable()
+{
+    if (!isGLExtensionSupported("GL_KHR_debug")) {
+        return;
+    }
+
+    glDisable(GL_DEBUG_OUTPUT_KHR);
+    glDebugMessageCallback(nullptr, nullptr);
+}
+
+#endif
+
+
+//---------------------------------------------------------------------------------------
+uint64 GLDebugOutput::numMessages()
+{
+    return g_numMessages.load(std::memory_order_relaxed);
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 GLDebugOutput::numSuppressedMessages()
+{
+    return g_numSuppressedMessages.load(std::memory_order_relaxed);
+}
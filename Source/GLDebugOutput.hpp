@@ -0,0 +1,41 @@
+//
+//  GLDebugOutput.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+
+
+enum GLDebugSeverity {
+    GLDebugSeverity_Notification = 0,
+    GLDebugSeverity_Low,
+    GLDebugSeverity_Medium,
+    GLDebugSeverity_High
+};
+
+
+// Reports driver messages, including GL errors, through a KHR_debug callback. Unlike
+// CHECK_GL_ERRORS, nothing waits on the driver: messages are logged when the driver
+// detects them, possibly from another thread and some time after the call that caused
+// them.
+//
+// Messages below the minimum severity are filtered out by the driver. Each distinct
+// message is logged at most maxReportsPerMessage times, then counted but not logged.
+//
+// Unavailable when the context lacks KHR_debug, which includes iOS.
+class GLDebugOutput {
+public:
+    // Returns false if KHR_debug is unsupported.
+    static bool enable (
+        GLDebugSeverity minimumSeverity = GLDebugSeverity_Medium,
+        uint maxReportsPerMessage = 10
+    );
+
+    static void disable();
+
+    // Messages received since enable(), including those not logged.
+    static uint64 numMessages();
+
+    static uint64 numSuppressedMessages();
+};
@@ -0,0 +1,26 @@
+//
+//  GLExtensions.cpp
+//
+
+#include "GLExtensions.hpp"
+
+#include <cstring>
+
+
+//---------------------------------------------------------------------------------------
+bool isGLExtensionSupported (
+    const char * extensionName
+) {
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    
+    for (GLint i(0); i < numExtensions; ++i) {
+        const char * extension =
+            reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, extensionName) == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
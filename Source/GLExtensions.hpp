@@ -0,0 +1,9 @@
+//
+//  GLExtensions.hpp
+//
+
+#pragma once
+
+
+// True if the current context lists extensionName, e.g. "GL_EXT_disjoint_timer_query".
+bool isGLExtensionSupported(const char * extensionName);
@@ -0,0 +1,19 @@
+//
+//  GLPlatform.h
+//
+// OpenGL ES 3.0 headers for the current platform.
+
+#pragma once
+
+#if defined(__APPLE__)
+    #include <OpenGLES/ES3/gl.h>
+    #include <OpenGLES/ES3/glext.h>
+#else
+    #include <GLES3/gl3.h>
+    #include <GLES2/gl2ext.h>
+
+    // EXT_debug_marker is not exported by Mesa's libGLESv2, so group markers used to
+    // label passes in GPU captures compile to nothing.
+    inline void glPushGroupMarkerEXT(GLsizei, const GLchar *) { }
+    inline void glPopGroupMarkerEXT() { }
+#endif
@@ -0,0 +1,451 @@
+//
+//  GLStateCache.cpp
+//
+
+#include "GLStateCache.hpp"
+
+
+namespace {
+    // Value of a tracked binding that is not known, never matched by a real call.
+    const GLuint Unknown = ~0u;
+
+    // Minimums guaranteed by OpenGL ES 3.0.
+    const uint MaxUniformBufferBindings = 24;
+    const uint MaxTransformFeedbackBufferBindings = 4;
+    const uint MaxTextureUnits = 16;
+
+    enum BufferTarget {
+        BufferTarget_Array,
+        BufferTarget_ElementArray,
+        BufferTarget_Uniform,
+        BufferTarget_TransformFeedback,
+        BufferTarget_CopyRead,
+        BufferTarget_CopyWrite,
+        BufferTarget_PixelPack,
+        BufferTarget_PixelUnpack,
+        NumBufferTargets
+    };
+
+    enum Capability {
+        Capability_Blend,
+        Capability_CullFace,
+        Capability_DepthTest,
+        Capability_PolygonOffsetFill,
+        Capability_RasterizerDiscard,
+        Capability_ScissorTest,
+        NumCapabilities
+    };
+
+    enum CapabilityState {
+        CapabilityState_Unknown,
+        CapabilityState_Enabled,
+        CapabilityState_Disabled
+    };
+
+    struct IndexedBufferBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;  // 0 for glBindBufferBase.
+    };
+
+    struct TrackedState {
+        GLuint program;
+        GLuint vao;
+        GLuint buffers[NumBufferTargets];
+        IndexedBufferBinding uniformBuffers[MaxUniformBufferBindings];
+        IndexedBufferBinding transformFeedbackBuffers[MaxTransformFeedbackBufferBindings];
+        GLuint framebuffer;
+        GLenum activeTexture;
+        GLuint textures2D[MaxTextureUnits];
+        CapabilityState capabilities[NumCapabilities];
+        GLenum cullFace;
+        GLenum blendSFactor;
+        GLenum blendDFactor;
+        GLenum depthMask;  // GLboolean widened so Unknown can be represented.
+        GLint viewport[4];
+        bool viewportKnown;
+
+        uint64 numIssuedCalls;
+        uint64 numElidedCalls;
+    };
+
+    TrackedState state = {};
+    bool stateInitialized = false;
+
+
+    //-----------------------------------------------------------------------------------
+    TrackedState & trackedState()
+    {
+        if (!stateInitialized) {
+            GLStateCache::invalidate();
+        }
+        return state;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Returns true if the caller should issue the GL call, updating call counts.
+    bool changed(bool isRedundant)
+    {
+        if (isRedundant) {
+            ++state.numElidedCalls;
+            return false;
+        }
+        ++state.numIssuedCalls;
+        return true;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    int bufferTargetIndex(GLenum target)
+    {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return BufferTarget_Array;
+            case GL_ELEMENT_ARRAY_BUFFER: return BufferTarget_ElementArray;
+            case GL_UNIFORM_BUFFER: return BufferTarget_Uniform;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: return BufferTarget_TransformFeedback;
+            case GL_COPY_READ_BUFFER: return BufferTarget_CopyRead;
+            case GL_COPY_WRITE_BUFFER: return BufferTarget_CopyWrite;
+            case GL_PIXEL_PACK_BUFFER: return BufferTarget_PixelPack;
+            case GL_PIXEL_UNPACK_BUFFER: return BufferTarget_PixelUnpack;
+            default: return -1;
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    int capabilityIndex(GLenum capability)
+    {
+        switch (capability) {
+            case GL_BLEND: return Capability_Blend;
+            case GL_CULL_FACE: return Capability_CullFace;
+            case GL_DEPTH_TEST: return Capability_DepthTest;
+            case GL_POLYGON_OFFSET_FILL: return Capability_PolygonOffsetFill;
+            case GL_RASTERIZER_DISCARD: return Capability_RasterizerDiscard;
+            case GL_SCISSOR_TEST: return Capability_ScissorTest;
+            default: return -1;
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Returns the indexed binding slot for target and index, or nullptr if untracked.
+    IndexedBufferBinding * indexedBinding(GLenum target, GLuint index)
+    {
+        if (target == GL_UNIFORM_BUFFER && index < MaxUniformBufferBindings) {
+            return &state.uniformBuffers[index];
+        }
+        if (target == GL_TRANSFORM_FEEDBACK_BUFFER &&
+            index < MaxTransformFeedbackBufferBindings) {
+            return &state.transformFeedbackBuffers[index];
+        }
+        return nullptr;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    void setCapability(GLenum capability, CapabilityState newState)
+    {
+        TrackedState & s = trackedState();
+        int index = capabilityIndex(capability);
+        if (index >= 0 && !changed(s.capabilities[index] == newState)) {
+            return;
+        }
+
+        if (index < 0) {
+            ++s.numIssuedCalls;
+        } else {
+            s.capabilities[index] = newState;
+        }
+
+        if (newState == CapabilityState_Enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+    }
+
+} // end namespace
+
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::useProgram(GLuint program)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.program == program)) {
+        s.program = program;
+        glUseProgram(program);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.vao == vao)) {
+        s.vao = vao;
+        s.buffers[BufferTarget_ElementArray] = Unknown;
+        glBindVertexArray(vao);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    TrackedState & s = trackedState();
+    int index = bufferTargetIndex(target);
+    if (index < 0) {
+        ++s.numIssuedCalls;
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (changed(s.buffers[index] == buffer)) {
+        s.buffers[index] = buffer;
+        glBindBuffer(target, buffer);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    TrackedState & s = trackedState();
+    IndexedBufferBinding * binding = indexedBinding(target, index);
+    int targetIndex = bufferTargetIndex(target);
+
+    if (binding) {
+        const bool isRedundant = binding->buffer == buffer && binding->size == 0 &&
+                                 s.buffers[targetIndex] == buffer;
+        if (!changed(isRedundant)) {
+            return;
+        }
+        binding->buffer = buffer;
+        binding->offset = 0;
+        binding->size = 0;
+    } else {
+        ++s.numIssuedCalls;
+    }
+
+    if (targetIndex >= 0) {
+        s.buffers[targetIndex] = buffer;
+    }
+    glBindBufferBase(target, index, buffer);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindBufferRange (
+    GLenum target,
+    GLuint index,
+    GLuint buffer,
+    GLintptr offset,
+    GLsizeiptr size
+) {
+    TrackedState & s = trackedState();
+    IndexedBufferBinding * binding = indexedBinding(target, index);
+    int targetIndex = bufferTargetIndex(target);
+
+    if (binding) {
+        const bool isRedundant = binding->buffer == buffer && binding->offset == offset &&
+                                 binding->size == size && s.buffers[targetIndex] == buffer;
+        if (!changed(isRedundant)) {
+            return;
+        }
+        binding->buffer = buffer;
+        binding->offset = offset;
+        binding->size = size;
+    } else {
+        ++s.numIssuedCalls;
+    }
+
+    if (targetIndex >= 0) {
+        s.buffers[targetIndex] = buffer;
+    }
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.framebuffer == framebuffer)) {
+        s.framebuffer = framebuffer;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::activeTexture(GLenum textureUnit)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.activeTexture == textureUnit)) {
+        s.activeTexture = textureUnit;
+        glActiveTexture(textureUnit);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindTexture2D(GLuint texture)
+{
+    TrackedState & s = trackedState();
+    GLuint unit = s.activeTexture - GL_TEXTURE0;
+    if (s.activeTexture == Unknown || unit >= MaxTextureUnits) {
+        ++s.numIssuedCalls;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        return;
+    }
+
+    if (changed(s.textures2D[unit] == texture)) {
+        s.textures2D[unit] = texture;
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::bindTexture2D(GLuint textureUnit, GLuint texture)
+{
+    TrackedState & s = trackedState();
+    if (textureUnit < MaxTextureUnits && s.textures2D[textureUnit] == texture) {
+        // Skipping the glActiveTexture call as well.
+        s.numElidedCalls += 2;
+        return;
+    }
+
+    activeTexture(GL_TEXTURE0 + textureUnit);
+    bindTexture2D(texture);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, CapabilityState_Enabled);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, CapabilityState_Disabled);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::cullFace(GLenum mode)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.cullFace == mode)) {
+        s.cullFace = mode;
+        glCullFace(mode);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.blendSFactor == sfactor && s.blendDFactor == dfactor)) {
+        s.blendSFactor = sfactor;
+        s.blendDFactor = dfactor;
+        glBlendFunc(sfactor, dfactor);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::depthMask(GLboolean flag)
+{
+    TrackedState & s = trackedState();
+    if (changed(s.depthMask == flag)) {
+        s.depthMask = flag;
+        glDepthMask(flag);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    TrackedState & s = trackedState();
+    const bool isRedundant = s.viewportKnown &&
+                             s.viewport[0] == x && s.viewport[1] == y &&
+                             s.viewport[2] == width && s.viewport[3] == height;
+    if (changed(isRedundant)) {
+        s.viewport[0] = x;
+        s.viewport[1] = y;
+        s.viewport[2] = width;
+        s.viewport[3] = height;
+        s.viewportKnown = true;
+        glViewport(x, y, width, height);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::invalidate()
+{
+    state.program = Unknown;
+    state.vao = Unknown;
+    for (GLuint & buffer : state.buffers) {
+        buffer = Unknown;
+    }
+    for (IndexedBufferBinding & binding : state.uniformBuffers) {
+        binding.buffer = Unknown;
+    }
+    for (IndexedBufferBinding & binding : state.transformFeedbackBuffers) {
+        binding.buffer = Unknown;
+    }
+    state.activeTexture = Unknown;
+    for (GLuint & texture : state.textures2D) {
+        texture = Unknown;
+    }
+    for (CapabilityState & capability : state.capabilities) {
+        capability = CapabilityState_Unknown;
+    }
+    state.cullFace = Unknown;
+    state.blendSFactor = Unknown;
+    state.blendDFactor = Unknown;
+    state.depthMask = Unknown;
+
+    stateInitialized = true;
+    invalidateFramebuffer();
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::invalidateFramebuffer()
+{
+    state.framebuffer = Unknown;
+    state.viewportKnown = false;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 GLStateCache::numIssuedCalls()
+{
+    return state.numIssuedCalls;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 GLStateCache::numElidedCalls()
+{
+    return state.numElidedCalls;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GLStateCache::resetCallCounts()
+{
+    state.numIssuedCalls = 0;
+    state.numElidedCalls = 0;
+}
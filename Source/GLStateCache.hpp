@@ -0,0 +1,78 @@
+//
+//  GLStateCache.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+#import "GLPlatform.h"
+
+
+// Shadows the GL context state that the renderer changes most often, and drops calls
+// that would set state to the value it already holds.
+//
+// All code that changes tracked state must do so through GLStateCache. After state is
+// changed behind its back (e.g. GLKView's bindDrawable, or deleting a bound object)
+// call one of the invalidate methods so the next call is issued unconditionally.
+class GLStateCache {
+public:
+    static void useProgram(GLuint program);
+
+    // Element array buffer binding is part of VAO state, so it is forgotten whenever
+    // the bound VAO changes.
+    static void bindVertexArray(GLuint vao);
+
+    static void bindBuffer(GLenum target, GLuint buffer);
+
+    // Also sets the generic binding for target, as glBindBufferBase does.
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+    // Also sets the generic binding for target, as glBindBufferRange does.
+    static void bindBufferRange (
+        GLenum target,
+        GLuint index,
+        GLuint buffer,
+        GLintptr offset,
+        GLsizeiptr size
+    );
+
+    // GL_FRAMEBUFFER only, which sets both draw and read bindings.
+    static void bindFramebuffer(GLuint framebuffer);
+
+    static void activeTexture(GLenum textureUnit);
+
+    // Binds to the GL_TEXTURE_2D target of the active texture unit.
+    static void bindTexture2D(GLuint texture);
+
+    // Binds texture to GL_TEXTURE_2D of textureUnit, changing the active texture unit
+    // only when the binding changes.
+    static void bindTexture2D(GLuint textureUnit, GLuint texture);
+
+    // Capabilities tracked: GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST,
+    // GL_POLYGON_OFFSET_FILL, GL_RASTERIZER_DISCARD, GL_SCISSOR_TEST.
+    static void enable(GLenum capability);
+
+    static void disable(GLenum capability);
+
+    static void cullFace(GLenum mode);
+
+    static void blendFunc(GLenum sfactor, GLenum dfactor);
+
+    static void depthMask(GLboolean flag);
+
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Forget all tracked state.
+    static void invalidate();
+
+    // Forget framebuffer binding and viewport.
+    static void invalidateFramebuffer();
+
+    // Number of GL calls forwarded to the driver since the last resetCallCounts().
+    static uint64 numIssuedCalls();
+
+    // Number of GL calls dropped as redundant since the last resetCallCounts().
+    static uint64 numElidedCalls();
+
+    static void resetCallCounts();
+};
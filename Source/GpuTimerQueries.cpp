@@ -0,0 +1,264 @@
+//
+//  GpuTimerQueries.cpp
+//
+
+#include "GpuTimerQueries.hpp"
+
+#include "GLExtensions.hpp"
+
+
+// EXT_disjoint_timer_query tokens, missing from the iOS headers.
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+
+class GpuTimerQueriesImpl {
+private:
+    friend class GpuTimerQueries;
+
+    struct FrameQueries {
+        GLuint queries[RenderStage_Count];
+
+        // Bit per RenderStage with a query issued this frame.
+        uint issuedStages;
+
+        bool pending;
+        uint64 frameNumber;
+    };
+
+    bool m_supported;
+
+    FrameQueries m_frames[GpuTimerQueries::NumFramesInRing];
+
+    // Slot of the frame being issued.
+    uint m_currentFrame;
+    uint64 m_frameNumber;
+    bool m_frameStarted;
+
+    GpuStageTimes m_latestStageTimes;
+    bool m_hasLatestStageTimes;
+
+
+    GpuTimerQueriesImpl();
+
+    ~GpuTimerQueriesImpl();
+
+    void collectFinishedFrames();
+
+    // Returns false if any query of frame is not yet available.
+    bool readFrame(const FrameQueries & frame, GpuStageTimes & stageTimes) const;
+};
+
+
+//---------------------------------------------------------------------------------------
+GpuTimerQueriesImpl::GpuTimerQueriesImpl()
+    : m_supported(false),
+      m_currentFrame(0),
+      m_frameNumber(0),
+      m_frameStarted(false),
+      m_hasLatestStageTimes(false)
+{
+    for (FrameQueries & frame : m_frames) {
+        for (GLuint & query : frame.queries) {
+            query = 0;
+        }
+        frame.issuedStages = 0;
+        frame.pending = false;
+        frame.frameNumber = 0;
+    }
+
+    m_supported = isGLExtensionSupported("GL_EXT_disjoint_timer_query");
+    if (!m_supported) {
+        return;
+    }
+
+    for (FrameQueries & frame : m_frames) {
+        glGenQueries(RenderStage_Count, frame.queries);
+    }
+
+    // Reading GL_GPU_DISJOINT_EXT clears it, so start from a clean state.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+GpuTimerQueriesImpl::~GpuTimerQueriesImpl()
+{
+    if (!m_supported) {
+        return;
+    }
+
+    for (FrameQueries & frame : m_frames) {
+        glDeleteQueries(RenderStage_Count, frame.queries);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+GpuTimerQueries::GpuTimerQueries()
+{
+    impl = new GpuTimerQueriesImpl();
+}
+
+
+//---------------------------------------------------------------------------------------
+GpuTimerQueries::~GpuTimerQueries()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool GpuTimerQueries::isSupported() const
+{
+    return impl->m_supported;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GpuTimerQueries::beginFrame()
+{
+    if (!impl->m_supported) {
+        return;
+    }
+
+    // Close off the previous frame, then collect it along with any older frames.
+    if (impl->m_frameStarted) {
+        GpuTimerQueriesImpl::FrameQueries & previous = impl->m_frames[impl->m_currentFrame];
+        previous.pending = (previous.issuedStages != 0);
+    }
+
+    impl->collectFinishedFrames();
+
+    if (impl->m_frameStarted) {
+        impl->m_currentFrame = (impl->m_currentFrame + 1) % NumFramesInRing;
+        ++impl->m_frameNumber;
+    }
+    impl->m_frameStarted = true;
+
+    // If the GPU is still working through this slot's last frame, drop its results
+    // rather than wait for them.
+    GpuTimerQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    frame.pending = false;
+    frame.issuedStages = 0;
+    frame.frameNumber = impl->m_frameNumber;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GpuTimerQueriesImpl::collectFinishedFrames()
+{
+    // Timings across a disjoint event are meaningless.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+    // Walk from oldest to newest, ending with the current slot, and stop at the first
+    // frame still in flight, since later frames finish after it.
+    for (uint i = 1; i <= GpuTimerQueries::NumFramesInRing; ++i) {
+        FrameQueries & frame = m_frames[(m_currentFrame + i) % GpuTimerQueries::NumFramesInRing];
+        if (!frame.pending) {
+            continue;
+        }
+
+        if (disjoint) {
+            frame.pending = false;
+            continue;
+        }
+
+        GpuStageTimes stageTimes;
+        if (!readFrame(frame, stageTimes)) {
+            break;
+        }
+
+        frame.pending = false;
+        m_latestStageTimes = stageTimes;
+        m_hasLatestStageTimes = true;
+    }
+
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool GpuTimerQueriesImpl::readFrame (
+    const FrameQueries & frame,
+    GpuStageTimes & stageTimes
+) const {
+    stageTimes.frameNumber = frame.frameNumber;
+    stageTimes.totalMilliseconds = 0.0;
+
+    // Query each stage's availability first, so results are only read when all are.
+    for (int stage = 0; stage < RenderStage_Count; ++stage) {
+        if (frame.issuedStages & (1u << stage)) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(frame.queries[stage], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                return false;
+            }
+        }
+    }
+
+    for (int stage = 0; stage < RenderStage_Count; ++stage) {
+        stageTimes.milliseconds[stage] = 0.0;
+
+        if (frame.issuedStages & (1u << stage)) {
+            // 32 bits of nanoseconds covers passes of up to 4 seconds, and avoids
+            // needing glGetQueryObjectui64vEXT.
+            GLuint nanoseconds = 0;
+            glGetQueryObjectuiv(frame.queries[stage], GL_QUERY_RESULT, &nanoseconds);
+            stageTimes.milliseconds[stage] = nanoseconds * 1e-6;
+            stageTimes.totalMilliseconds += stageTimes.milliseconds[stage];
+        }
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void GpuTimerQueries::beginStage (
+    RenderStage stage
+) {
+    if (!impl->m_supported || !impl->m_frameStarted) {
+        return;
+    }
+
+    GpuTimerQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    glBeginQuery(GL_TIME_ELAPSED_EXT, frame.queries[stage]);
+}
+
+
+//---------------------------------------------------------------------------------------
+void GpuTimerQueries::endStage (
+    RenderStage stage
+) {
+    if (!impl->m_supported || !impl->m_frameStarted) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+
+    GpuTimerQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    frame.issuedStages |= (1u << stage);
+}
+
+
+//---------------------------------------------------------------------------------------
+bool GpuTimerQueries::latestStageTimes (
+    GpuStageTimes & stageTimes
+) const {
+    if (!impl->m_hasLatestStageTimes) {
+        return false;
+    }
+
+    stageTimes = impl->m_latestStageTimes;
+    return true;
+}
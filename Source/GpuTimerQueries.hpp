@@ -0,0 +1,61 @@
+//
+//  GpuTimerQueries.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+#include "GLPlatform.h"
+#include "RendererTypes.h"
+
+
+// Forward declaration
+class GpuTimerQueriesImpl;
+
+
+// GPU execution time of each RenderStage in one frame.
+struct GpuStageTimes {
+    // Counts frames since the GpuTimerQueries was created, starting at zero.
+    uint64 frameNumber;
+
+    double milliseconds[RenderStage_Count];
+
+    // Sum of milliseconds over all stages.
+    double totalMilliseconds;
+};
+
+
+// Times each RenderStage on the GPU with EXT_disjoint_timer_query.
+//
+// Queries are kept in a ring several frames deep, and results are only read once the
+// GPU reports them available, so collecting them never stalls. Results are typically
+// a few frames behind the frame being issued. Frames whose queries are still pending
+// when their slot in the ring comes round again are dropped, as are all pending frames
+// when the GPU reports a disjoint event (e.g. a clock change).
+//
+// Does nothing when the extension is unsupported, which includes iOS.
+class GpuTimerQueries {
+public:
+    static const uint NumFramesInRing = 5;
+
+    GpuTimerQueries();
+
+    ~GpuTimerQueries();
+
+    bool isSupported() const;
+
+    // Call at the start of each frame, before any stage. Collects results of finished
+    // frames.
+    void beginFrame();
+
+    // Stages must not nest, and each may be timed at most once per frame.
+    void beginStage(RenderStage stage);
+
+    void endStage(RenderStage stage);
+
+    // Returns false if no frame has completed yet.
+    bool latestStageTimes(GpuStageTimes & stageTimes) const;
+
+private:
+    GpuTimerQueriesImpl * impl;
+};
@@ -0,0 +1,226 @@
+//
+//  HeadlessContext.cpp
+//
+
+#include "HeadlessContext.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <stdexcept>
+
+
+class HeadlessContextImpl {
+private:
+    friend class HeadlessContext;
+
+    EGLDisplay m_display;
+    EGLContext m_context;
+    EGLSurface m_surface;
+
+
+    HeadlessContextImpl();
+
+    ~HeadlessContextImpl();
+
+    bool initSurfaceless();
+
+    bool initPbuffer();
+
+    void destroy();
+};
+
+
+//---------------------------------------------------------------------------------------
+static bool hasExtension (
+    const char * extensions,
+    const char * extensionName
+) {
+    if (!extensions) {
+        return false;
+    }
+
+    // Match whole space separated names only.
+    const size_t length = strlen(extensionName);
+    for (const char * p = extensions; (p = strstr(p, extensionName)); p += length) {
+        const bool atStart = (p == extensions) || (p[-1] == ' ');
+        const bool atEnd = (p[length] == ' ') || (p[length] == '\0');
+        if (atStart && atEnd) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------------------
+HeadlessContextImpl::HeadlessContextImpl()
+    : m_display(EGL_NO_DISPLAY),
+      m_context(EGL_NO_CONTEXT),
+      m_surface(EGL_NO_SURFACE)
+{
+    if (!initSurfaceless() && !initPbuffer()) {
+        throw std::runtime_error("Unable to create a headless OpenGL ES 3.0 context.");
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+HeadlessContextImpl::~HeadlessContextImpl()
+{
+    destroy();
+}
+
+
+//---------------------------------------------------------------------------------------
+bool HeadlessContextImpl::initSurfaceless()
+{
+    const char * clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (!hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        return false;
+    }
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (!eglGetPlatformDisplayEXT) {
+        return false;
+    }
+
+    m_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+                                         EGL_DEFAULT_DISPLAY, nullptr);
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr)) {
+        destroy();
+        return false;
+    }
+
+    const char * displayExtensions = eglQueryString(m_display, EGL_EXTENSIONS);
+    if (!hasExtension(displayExtensions, "EGL_KHR_surfaceless_context") ||
+        !hasExtension(displayExtensions, "EGL_KHR_no_config_context")) {
+        destroy();
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(m_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+                                 contextAttribs);
+
+    if (m_context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool HeadlessContextImpl::initPbuffer()
+{
+    m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr)) {
+        destroy();
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs) ||
+        numConfigs == 0) {
+        destroy();
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = {
+        EGL_WIDTH, 1,
+        EGL_HEIGHT, 1,
+        EGL_NONE
+    };
+    m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttribs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+
+    if (m_surface == EGL_NO_SURFACE || m_context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void HeadlessContextImpl::destroy()
+{
+    if (m_display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (m_context != EGL_NO_CONTEXT) {
+        eglDestroyContext(m_display, m_context);
+        m_context = EGL_NO_CONTEXT;
+    }
+
+    if (m_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(m_display, m_surface);
+        m_surface = EGL_NO_SURFACE;
+    }
+
+    eglTerminate(m_display);
+    m_display = EGL_NO_DISPLAY;
+}
+
+
+//---------------------------------------------------------------------------------------
+HeadlessContext::HeadlessContext()
+{
+    impl = new HeadlessContextImpl();
+}
+
+
+//---------------------------------------------------------------------------------------
+HeadlessContext::~HeadlessContext()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+std::string HeadlessContext::rendererName() const
+{
+    const GLubyte * name = glGetString(GL_RENDERER);
+    return name ? std::string(reinterpret_cast<const char *>(name)) : std::string();
+}
+
+
+//---------------------------------------------------------------------------------------
+bool HeadlessContext::isSurfaceless() const
+{
+    return impl->m_surface == EGL_NO_SURFACE;
+}
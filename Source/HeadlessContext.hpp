@@ -0,0 +1,36 @@
+//
+//  HeadlessContext.hpp
+//
+
+#pragma once
+
+#include <string>
+
+
+// Forward declaration
+class HeadlessContextImpl;
+
+
+// Creates an OpenGL ES 3.0 context through EGL with no window or display server, and
+// makes it current on the calling thread.
+//
+// Uses a surfaceless context on EGL_MESA_platform_surfaceless when available, and
+// otherwise falls back to a 1x1 pbuffer on the default display. Either way there is no
+// usable default framebuffer, so render into an OffscreenFramebuffer.
+//
+// Throws std::runtime_error if no context can be created.
+class HeadlessContext {
+public:
+    HeadlessContext();
+
+    ~HeadlessContext();
+
+    // GL_RENDERER string, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)".
+    std::string rendererName() const;
+
+    // True if the context was created without a pbuffer surface.
+    bool isSurfaceless() const;
+
+private:
+    HeadlessContextImpl * impl;
+};
@@ -4,7 +4,12 @@
 
 #include "Mesh.hpp"
 
-#include "VertexAttributeDefines.h"
+#include <algorithm>
+#include <cstddef>
+
+#include "MeshFile.hpp"
+#include "GLStateCache.hpp"
+#include "PipelineStatistics.hpp"
 
 
 class MeshImpl {
@@ -15,9 +20,29 @@ private:
     GLuint m_vbo;
     GLuint m_indexBuffer;
     GLsizei m_numIndices;
+    GLenum m_indexType;
+    
+    VertexEncoding m_vertexEncoding;
+    VertexFormat m_vertexFormat;
+    glm::vec3 m_positionScale;
+    glm::vec3 m_positionBias;
     
     
     MeshImpl();
+    
+    void setupVertexArray(GLuint vao) const;
+    
+    void uploadVertexBytes (
+        const void * vertexData,
+        size_t numBytes,
+        VertexEncoding encoding
+    );
+    
+    void uploadIndexBytes (
+        const void * indexData,
+        GLsizei numIndices,
+        GLenum indexType
+    );
 };
 
 
@@ -37,49 +62,35 @@ Mesh::~Mesh()
 
 //---------------------------------------------------------------------------------------
 MeshImpl::MeshImpl()
+    : m_numIndices(0),
+      m_indexType(GL_UNSIGNED_SHORT),
+      m_vertexEncoding(VertexEncoding_Float),
+      m_vertexFormat(VertexFormat::forEncoding(VertexEncoding_Float)),
+      m_positionScale(1.0f),
+      m_positionBias(0.0f)
 {
     glGenVertexArrays(1, &m_vao);
     glGenBuffers(1, &m_vbo);
     glGenBuffers(1, &m_indexBuffer);
     
-    
-    glBindVertexArray(m_vao);
-    
-    // Record the index buffer to be used
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-
-    // Enable vertex attribute slots
-    {
-        glEnableVertexAttribArray(ATTRIBUTE_POSITION);
-        glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
-
-        CHECK_GL_ERRORS;
-    }
-
-    // Map position data from vertex buffer to vertex attribute slot.
-    {
-        GLint stride = sizeof(Mesh::Vertex);
-        GLint startOffset(0);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, stride,
-                reinterpret_cast<const GLvoid *>(startOffset));
+    setupVertexArray(m_vao);
+}
 
-        CHECK_GL_ERRORS;
-    }
 
-    // Map normal data from vertex buffer to vertex attribute slot.
-    {
-        GLint stride = sizeof(Mesh::Vertex);
-        GLint startOffset = sizeof(Mesh::Vertex::position);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, stride,
-                reinterpret_cast<const GLvoid *>(startOffset));
+//---------------------------------------------------------------------------------------
+void MeshImpl::setupVertexArray(GLuint vao) const
+{
+    GLStateCache::bindVertexArray(vao);
+    
+    // Record the index buffer to be used
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 
-        CHECK_GL_ERRORS;
-    }
+    // Map vertex data from vertex buffer to vertex attribute slots.
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    m_vertexFormat.setAttribPointers();
     
     // Unbind vao
-    glBindVertexArray(0);
+    GLStateCache::bindVertexArray(0);
 }
 
 
@@ -90,6 +101,17 @@ GLuint Mesh::vao() const
 }
 
 
+//---------------------------------------------------------------------------------------
+GLuint Mesh::createVertexArray() const
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    impl->setupVertexArray(vao);
+    
+    return vao;
+}
+
+
 //---------------------------------------------------------------------------------------
 GLuint Mesh::vbo() const
 {
@@ -104,34 +126,152 @@ GLsizei Mesh::numIndices() const
 }
 
 
+//---------------------------------------------------------------------------------------
+GLenum Mesh::indexType() const
+{
+    return impl->m_indexType;
+}
+
+
 //---------------------------------------------------------------------------------------
 void Mesh::uploadVertexData (
-    const std::vector<Mesh::Vertex> & vertices
+    const std::vector<Mesh::Vertex> & vertices,
+    VertexEncoding encoding
+) {
+    const EncodedVertices encoded = VertexFormat::encode(vertices, encoding);
+    impl->m_positionScale = encoded.positionScale;
+    impl->m_positionBias = encoded.positionBias;
+    
+    impl->uploadVertexBytes(encoded.data.data(), encoded.data.size(), encoding);
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshImpl::uploadVertexBytes (
+    const void * vertexData,
+    size_t numBytes,
+    VertexEncoding encoding
 ) {
-    size_t numVertices = vertices.size();
-    if (numVertices > 0) {
-        glBindBuffer(GL_ARRAY_BUFFER, impl->m_vbo);
-        const GLsizeiptr numBytes = sizeof(Mesh::Vertex) * numVertices;
-        glBufferData(GL_ARRAY_BUFFER, numBytes, vertices.data(), GL_STATIC_DRAW);
+    if (numBytes > 0) {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, numBytes, vertexData, GL_STATIC_DRAW);
+        PipelineCounters::countBytesUploaded(numBytes);
         
         CHECK_GL_ERRORS;
     }
     
+    if (encoding != m_vertexEncoding) {
+        m_vertexEncoding = encoding;
+        m_vertexFormat = VertexFormat::forEncoding(encoding);
+        setupVertexArray(m_vao);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+bool Mesh::load (
+    const std::string & filePath
+) {
+    // Opening validates the whole file, including every index, so nothing below can
+    // fail and leave the mesh half replaced.
+    MeshFile file;
+    if (!file.open(filePath)) {
+        return false;
+    }
+    
+    const MeshFileHeader & header = file.header();
+    const VertexEncoding encoding = static_cast<VertexEncoding>(header.vertexEncoding);
+    const size_t numVertexBytes =
+        size_t(header.numVertices) * VertexFormat::forEncoding(encoding).stride;
+    const GLenum indexType = (header.indexSize == 4) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    
+    impl->uploadVertexBytes(file.vertexData(), numVertexBytes, encoding);
+    impl->uploadIndexBytes(file.indexData(), static_cast<GLsizei>(header.numIndices),
+                           indexType);
+    
+    impl->m_positionScale = glm::vec3(header.positionScale[0], header.positionScale[1],
+                                      header.positionScale[2]);
+    impl->m_positionBias = glm::vec3(header.positionBias[0], header.positionBias[1],
+                                     header.positionBias[2]);
+    
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+VertexEncoding Mesh::vertexEncoding() const
+{
+    return impl->m_vertexEncoding;
+}
+
+
+//---------------------------------------------------------------------------------------
+const VertexFormat & Mesh::vertexFormat() const
+{
+    return impl->m_vertexFormat;
+}
+
+
+//---------------------------------------------------------------------------------------
+glm::vec3 Mesh::positionScale() const
+{
+    return impl->m_positionScale;
+}
+
+
+//---------------------------------------------------------------------------------------
+glm::vec3 Mesh::positionBias() const
+{
+    return impl->m_positionBias;
 }
 
 //---------------------------------------------------------------------------------------
 void Mesh::uploadIndexData (
     const std::vector<Mesh::Index> & indices
 ){
-    size_t numIndices = indices.size();
+    impl->uploadIndexBytes(indices.data(), static_cast<GLsizei>(indices.size()),
+                           GL_UNSIGNED_SHORT);
+}
+
+
+//---------------------------------------------------------------------------------------
+void Mesh::uploadIndexData (
+    const std::vector<GLuint> & indices
+) {
+    const bool fitsIn16Bits = indices.empty() ||
+        *std::max_element(indices.begin(), indices.end()) <= 0xffff;
     
+    if (fitsIn16Bits) {
+        const std::vector<Mesh::Index> shortIndices(indices.begin(), indices.end());
+        uploadIndexData(shortIndices);
+    } else {
+        impl->uploadIndexBytes(indices.data(), static_cast<GLsizei>(indices.size()),
+                               GL_UNSIGNED_INT);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshImpl::uploadIndexBytes (
+    const void * indexData,
+    GLsizei numIndices,
+    GLenum indexType
+) {
     if (numIndices > 0) {
-        impl->m_numIndices = static_cast<GLsizei>(numIndices);
+        m_numIndices = numIndices;
+        m_indexType = indexType;
         
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, impl->m_indexBuffer);
-        const GLsizeiptr numBytes = sizeof(Mesh::Index) * numIndices;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numBytes, indices.data(), GL_STATIC_DRAW);
+        // The element array binding is VAO state, so upload through this mesh's VAO
+        // rather than replace the index buffer of whichever VAO was last bound.
+        GLStateCache::bindVertexArray(m_vao);
+        GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        const size_t indexSize = (indexType == GL_UNSIGNED_INT) ? sizeof(GLuint)
+                                                                : sizeof(GLushort);
+        const GLsizeiptr numBytes = indexSize * numIndices;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numBytes, indexData, GL_STATIC_DRAW);
+        PipelineCounters::countBytesUploaded(numBytes);
+        GLStateCache::bindVertexArray(0);
         
         CHECK_GL_ERRORS;
     }
-}
\ No newline at end of file
+}
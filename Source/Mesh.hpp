@@ -4,7 +4,10 @@
 
 #pragma once
 
-#import <OpenGLES/ES3/gl.h>
+#import "GLPlatform.h"
+#import "VertexFormat.hpp"
+#import <glm/glm.hpp>
+#import <string>
 #import <vector>
 
 
@@ -14,10 +17,7 @@ class MeshImpl;
 
 class Mesh {
 public:
-    struct Vertex {
-        GLfloat position[3];
-        GLfloat normal[3];
-    };
+    typedef FloatVertex Vertex;
     
     typedef GLushort Index;
     
@@ -29,18 +29,51 @@ public:
     
     GLuint vao() const;
     
+    // Creates an additional VAO with the same vertex and index buffer mappings as
+    // vao(), for pairing this mesh with different instance data. Caller owns the VAO,
+    // whose attribute pointers follow the encoding of the last uploadVertexData.
+    GLuint createVertexArray() const;
+    
     GLuint vbo() const;
     
     GLsizei numIndices() const;
     
+    // GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT for meshes of more than 65536 vertices.
+    GLenum indexType() const;
+    
+    // Loads a mesh written by Tools/ImportMesh, whose vertices are already optimized
+    // and encoded, uploading them straight from the mapped file. Returns false if the
+    // file cannot be mapped or is not a valid mesh file, including one with an index
+    // past its vertices, leaving the mesh unchanged.
+    bool load (
+        const std::string & filePath
+    );
+    
+    // Stores vertices in encoding, and sets the attribute pointers of vao() to match.
     void uploadVertexData (
-        const std::vector<Mesh::Vertex> & vertices
+        const std::vector<Mesh::Vertex> & vertices,
+        VertexEncoding encoding = VertexEncoding_Float
     );
     
+    VertexEncoding vertexEncoding() const;
+    
+    const VertexFormat & vertexFormat() const;
+    
+    // Quantized encodings store positions relative to the mesh bounds, which shaders
+    // map back with position * positionScale() + positionBias().
+    glm::vec3 positionScale() const;
+    
+    glm::vec3 positionBias() const;
+    
     void uploadIndexData (
         const std::vector<Mesh::Index> & indices
     );
     
+    // Stores indices in 16 bits when every index fits.
+    void uploadIndexData (
+        const std::vector<GLuint> & indices
+    );
+    
 private:
     MeshImpl * impl;
 };
\ No newline at end of file
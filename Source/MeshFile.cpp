@@ -0,0 +1,169 @@
+//
+//  MeshFile.cpp
+//
+
+#include "MeshFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "VertexFormat.hpp"
+
+
+const char MeshFileMagic[8] = { 'C', 'N', 'M', 'E', 'S', 'H', '0', '1' };
+
+
+namespace {
+    //-----------------------------------------------------------------------------------
+    template <typename Index>
+    bool areIndicesInRange (
+        const char * indexData,
+        uint32 numIndices,
+        uint32 numVertices
+    ) {
+        const Index * indices = reinterpret_cast<const Index *>(indexData);
+        for (uint32 i = 0; i < numIndices; ++i) {
+            if (indices[i] >= numVertices) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Checks the header, that the vertex and index data lie within the file, and that
+    // every index names a vertex, so readers need no bounds checks.
+    bool isValidMeshFile (
+        const char * file,
+        size_t fileSize
+    ) {
+        if (fileSize < sizeof(MeshFileHeader)) {
+            return false;
+        }
+
+        const MeshFileHeader & header = *reinterpret_cast<const MeshFileHeader *>(file);
+        if (memcmp(header.magic, MeshFileMagic, sizeof(MeshFileMagic)) != 0 ||
+            header.numBytes != fileSize ||
+            header.numVertices == 0 || header.numIndices == 0 ||
+            header.vertexEncoding > VertexEncoding_Snorm16Packed ||
+            (header.indexSize != 2 && header.indexSize != 4) ||
+            header.vertexDataOffset % 4 != 0 || header.indexDataOffset % 4 != 0)
+        {
+            return false;
+        }
+
+        const VertexFormat format =
+            VertexFormat::forEncoding(static_cast<VertexEncoding>(header.vertexEncoding));
+        const uint64 vertexBytes = uint64(header.numVertices) * format.stride;
+        const uint64 indexBytes = uint64(header.numIndices) * header.indexSize;
+
+        if (header.vertexDataOffset < sizeof(MeshFileHeader) ||
+            header.vertexDataOffset + vertexBytes > header.indexDataOffset ||
+            header.indexDataOffset + indexBytes > fileSize ||
+            header.numIndices % 3 != 0)
+        {
+            return false;
+        }
+
+        const char * indexData = file + header.indexDataOffset;
+        return (header.indexSize == 2)
+            ? areIndicesInRange<uint16>(indexData, header.numIndices, header.numVertices)
+            : areIndicesInRange<uint32>(indexData, header.numIndices, header.numVertices);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+MeshFile::MeshFile()
+    : m_file(nullptr),
+      m_fileSize(0)
+{
+
+}
+
+
+//---------------------------------------------------------------------------------------
+MeshFile::~MeshFile()
+{
+    close();
+}
+
+
+//---------------------------------------------------------------------------------------
+bool MeshFile::open (
+    const std::string & filePath
+) {
+    close();
+
+    int file = ::open(filePath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0 || fileStatus.st_size <= 0) {
+        ::close(file);
+        return false;
+    }
+
+    const size_t fileSize = static_cast<size_t>(fileStatus.st_size);
+    void * mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping holds its own reference to the file.
+    ::close(file);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    if (!isValidMeshFile(static_cast<const char *>(mapping), fileSize)) {
+        fprintf(stderr, "Error -- Invalid mesh file: %s\n", filePath.c_str());
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    m_file = static_cast<const char *>(mapping);
+    m_fileSize = fileSize;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshFile::close()
+{
+    if (m_file) {
+        munmap(const_cast<char *>(m_file), m_fileSize);
+    }
+
+    m_file = nullptr;
+    m_fileSize = 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+const MeshFileHeader & MeshFile::header() const
+{
+    return *reinterpret_cast<const MeshFileHeader *>(m_file);
+}
+
+
+//---------------------------------------------------------------------------------------
+const void * MeshFile::vertexData() const
+{
+    return m_file + header().vertexDataOffset;
+}
+
+
+//---------------------------------------------------------------------------------------
+const void * MeshFile::indexData() const
+{
+    return m_file + header().indexDataOffset;
+}
@@ -0,0 +1,61 @@
+//
+//  MeshFile.hpp
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "NumericTypes.h"
+
+
+// File layout, shared with Tools/ImportMesh. All fields are little endian.
+//
+// A MeshFileHeader is followed by the vertex data, numVertices vertices in
+// vertexEncoding, then numIndices indices of indexSize bytes each. Both start 4 byte
+// aligned.
+struct MeshFileHeader {
+    char magic[8];
+    uint32 vertexEncoding;    // VertexEncoding
+    uint32 numVertices;
+    uint32 numIndices;
+    uint32 indexSize;         // 2, or 4 for meshes of more than 65536 vertices.
+    float positionScale[3];   // Decoded position = stored * positionScale + positionBias.
+    float positionBias[3];
+    uint32 vertexDataOffset;  // From the start of the file.
+    uint32 indexDataOffset;
+    uint32 numBytes;          // Size of the whole file.
+};
+
+extern const char MeshFileMagic[8];
+
+
+// A mesh file memory mapped for reading its vertex and index data in place, until
+// closed or destroyed.
+class MeshFile {
+public:
+    MeshFile();
+
+    ~MeshFile();
+
+    // Maps the mesh at filePath, closing any mesh already open. Returns false if the
+    // file cannot be mapped or is not a valid mesh file.
+    bool open(const std::string & filePath);
+
+    void close();
+
+    // Valid while the file is open.
+    const MeshFileHeader & header() const;
+
+    const void * vertexData() const;
+
+    const void * indexData() const;
+
+private:
+    MeshFile(const MeshFile &) = delete;
+    MeshFile & operator = (const MeshFile &) = delete;
+
+    const char * m_file;
+    size_t m_fileSize;
+};
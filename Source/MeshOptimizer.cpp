@@ -0,0 +1,381 @@
+//
+//  MeshOptimizer.cpp
+//
+
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+
+namespace {
+    // Score weights from Forsyth's article.
+    const float CacheDecayPower = 1.5f;
+    const float LastTriangleScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+
+    const uint32 NotCached = ~0u;
+
+
+    //-----------------------------------------------------------------------------------
+    // Favors vertices used recently, and vertices with few triangles left so they are
+    // finished rather than left as isolated triangles.
+    float vertexScore (
+        uint32 cachePosition,
+        uint32 numRemainingTriangles
+    ) {
+        if (numRemainingTriangles == 0) {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition < 3) {
+            // Vertices of the last triangle score a fixed amount, so the next triangle
+            // does not just reuse its newest edge.
+            score = LastTriangleScore;
+        } else if (cachePosition != NotCached) {
+            const float scale = 1.0f / (MeshOptimizer::VertexCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+        }
+
+        score += ValenceBoostScale *
+                 std::pow(static_cast<float>(numRemainingTriangles), -ValenceBoostPower);
+
+        return score;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    // Simulates a FIFO cache of cacheSize entries, returning the misses of triangle.
+    // A vertex is cached if fewer than cacheSize misses happened since its own.
+    uint simulateFifoCache (
+        const uint32 * triangle,
+        std::vector<uint64> & missTimes,
+        uint64 & time,
+        uint cacheSize
+    ) {
+        uint numMisses = 0;
+        for (int k = 0; k < 3; ++k) {
+            const uint32 vertex = triangle[k];
+            if (time - missTimes[vertex] >= cacheSize) {
+                missTimes[vertex] = ++time;
+                ++numMisses;
+            }
+        }
+
+        return numMisses;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    glm::vec3 position (
+        const std::vector<FloatVertex> & vertices,
+        uint32 index
+    ) {
+        return glm::make_vec3(vertices[index].position);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshOptimizer::optimizeVertexCache (
+    std::vector<uint32> & indices,
+    size_t numVertices
+) {
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // Triangles of each vertex, as ranges of one array. Emitted triangles are swapped
+    // past the end of their vertices' ranges, whose lengths count those remaining.
+    std::vector<uint32> numRemainingTriangles(numVertices, 0);
+    for (uint32 index : indices) {
+        ++numRemainingTriangles[index];
+    }
+
+    std::vector<uint32> firstTriangle(numVertices + 1, 0);
+    for (size_t vertex = 0; vertex < numVertices; ++vertex) {
+        firstTriangle[vertex + 1] = firstTriangle[vertex] + numRemainingTriangles[vertex];
+    }
+
+    std::vector<uint32> vertexTriangles(indices.size());
+    {
+        std::vector<uint32> end(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t triangle = 0; triangle < numTriangles; ++triangle) {
+            for (int k = 0; k < 3; ++k) {
+                vertexTriangles[end[indices[3 * triangle + k]]++] =
+                    static_cast<uint32>(triangle);
+            }
+        }
+    }
+
+    std::vector<uint32> cachePositions(numVertices, NotCached);
+    std::vector<float> vertexScores(numVertices);
+    for (size_t vertex = 0; vertex < numVertices; ++vertex) {
+        vertexScores[vertex] = vertexScore(NotCached, numRemainingTriangles[vertex]);
+    }
+
+    std::vector<float> triangleScores(numTriangles);
+    for (size_t triangle = 0; triangle < numTriangles; ++triangle) {
+        const uint32 * corners = &indices[3 * triangle];
+        triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] +
+                                   vertexScores[corners[2]];
+    }
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32> optimized;
+    optimized.reserve(indices.size());
+
+    // Holds VertexCacheSize vertices, plus the up to 3 a triangle pushes out.
+    std::vector<uint32> cache;
+    std::vector<uint32> nextCache;
+    cache.reserve(VertexCacheSize + 3);
+    nextCache.reserve(VertexCacheSize + 3);
+
+    size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) -
+                          triangleScores.begin();
+    size_t deadEndCursor = 0;
+
+    for (size_t numEmitted = 0; numEmitted < numTriangles; ++numEmitted) {
+        // With no triangle sharing a cached vertex left, restart from the first
+        // remaining triangle in input order, which keeps the search linear.
+        if (bestTriangle == numTriangles) {
+            while (emitted[deadEndCursor]) {
+                ++deadEndCursor;
+            }
+            bestTriangle = deadEndCursor;
+        }
+
+        const uint32 * corners = &indices[3 * bestTriangle];
+        optimized.insert(optimized.end(), corners, corners + 3);
+        emitted[bestTriangle] = true;
+
+        // Drop the triangle from its vertices' ranges.
+        for (int k = 0; k < 3; ++k) {
+            const uint32 vertex = corners[k];
+            uint32 * begin = &vertexTriangles[firstTriangle[vertex]];
+            uint32 * end = begin + numRemainingTriangles[vertex];
+            std::iter_swap(std::find(begin, end, static_cast<uint32>(bestTriangle)), end - 1);
+            --numRemainingTriangles[vertex];
+        }
+
+        // The triangle's vertices move to the front of the LRU cache.
+        nextCache.assign(corners, corners + 3);
+        for (uint32 vertex : cache) {
+            if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); ++i) {
+            const uint32 vertex = cache[i];
+            cachePositions[vertex] = (i < VertexCacheSize) ? static_cast<uint32>(i)
+                                                           : NotCached;
+            vertexScores[vertex] = vertexScore(cachePositions[vertex],
+                                               numRemainingTriangles[vertex]);
+        }
+
+        // Rescore the remaining triangles of every vertex whose score changed, and pick
+        // the best of them next.
+        bestTriangle = numTriangles;
+        float bestScore = -1.0f;
+        for (uint32 vertex : cache) {
+            const uint32 * begin = &vertexTriangles[firstTriangle[vertex]];
+            const uint32 * end = begin + numRemainingTriangles[vertex];
+            for (const uint32 * triangle = begin; triangle != end; ++triangle) {
+                const uint32 * triangleCorners = &indices[3 * *triangle];
+                const float score = vertexScores[triangleCorners[0]] +
+                                    vertexScores[triangleCorners[1]] +
+                                    vertexScores[triangleCorners[2]];
+                triangleScores[*triangle] = score;
+
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = *triangle;
+                }
+            }
+        }
+
+        if (cache.size() > VertexCacheSize) {
+            cache.resize(VertexCacheSize);
+        }
+    }
+
+    indices.swap(optimized);
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshOptimizer::optimizeOverdraw (
+    std::vector<uint32> & indices,
+    const std::vector<FloatVertex> & vertices,
+    float threshold
+) {
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // Hard boundaries where all of a triangle's vertices miss the cache, since the
+    // order restarts there anyway. The first cluster starts at the first triangle even
+    // if it misses fewer, e.g. when degenerate, so every triangle is in a cluster.
+    std::vector<size_t> hardStarts(1, 0);
+    {
+        std::vector<uint64> missTimes(vertices.size(), 0);
+        uint64 time = FifoCacheSize;
+        for (size_t triangle = 0; triangle < numTriangles; ++triangle) {
+            const uint numMisses = simulateFifoCache(&indices[3 * triangle], missTimes,
+                                                     time, FifoCacheSize);
+            if (numMisses == 3 && triangle > 0) {
+                hardStarts.push_back(triangle);
+            }
+        }
+    }
+    hardStarts.push_back(numTriangles);
+
+    // Soft boundaries within each hard cluster, once the triangles so far have missed
+    // the cache no more than threshold times the rate of the whole cluster.
+    std::vector<size_t> clusterStarts;
+    std::vector<uint64> missTimes(vertices.size(), 0);
+    uint64 time = 0;
+
+    for (size_t cluster = 0; cluster + 1 < hardStarts.size(); ++cluster) {
+        const size_t begin = hardStarts[cluster];
+        const size_t end = hardStarts[cluster + 1];
+
+        // Each cluster starts with a cold cache.
+        time += FifoCacheSize;
+        uint numClusterMisses = 0;
+        for (size_t triangle = begin; triangle < end; ++triangle) {
+            numClusterMisses += simulateFifoCache(&indices[3 * triangle], missTimes, time,
+                                                  FifoCacheSize);
+        }
+        const float clusterMissRatio = float(numClusterMisses) / (end - begin);
+
+        clusterStarts.push_back(begin);
+        time += FifoCacheSize;
+        uint numMisses = 0;
+        size_t start = begin;
+        for (size_t triangle = begin; triangle + 1 < end; ++triangle) {
+            numMisses += simulateFifoCache(&indices[3 * triangle], missTimes, time,
+                                           FifoCacheSize);
+
+            if (float(numMisses) / (triangle + 1 - start) <= threshold * clusterMissRatio) {
+                start = triangle + 1;
+                clusterStarts.push_back(start);
+                time += FifoCacheSize;
+                numMisses = 0;
+            }
+        }
+    }
+    clusterStarts.push_back(numTriangles);
+
+    // Area weighted centroid and normal of each cluster, and of the mesh.
+    const size_t numClusters = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t cluster = 0; cluster < numClusters; ++cluster) {
+        float clusterArea = 0.0f;
+        for (size_t triangle = clusterStarts[cluster];
+             triangle < clusterStarts[cluster + 1]; ++triangle)
+        {
+            const glm::vec3 p0 = position(vertices, indices[3 * triangle]);
+            const glm::vec3 p1 = position(vertices, indices[3 * triangle + 1]);
+            const glm::vec3 p2 = position(vertices, indices[3 * triangle + 2]);
+
+            // Twice the area, along the normal.
+            const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(areaNormal);
+
+            clusterCentroids[cluster] += area * (p0 + p1 + p2) / 3.0f;
+            clusterNormals[cluster] += areaNormal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) {
+            clusterCentroids[cluster] /= clusterArea;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters further out along their normal first.
+    std::vector<float> clusterSortKeys(numClusters);
+    for (size_t cluster = 0; cluster < numClusters; ++cluster) {
+        const float length = glm::length(clusterNormals[cluster]);
+        const glm::vec3 normal = (length > 0.0f) ? clusterNormals[cluster] / length
+                                                 : glm::vec3(0.0f);
+        clusterSortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, normal);
+    }
+
+    std::vector<size_t> clusterOrder(numClusters);
+    for (size_t cluster = 0; cluster < numClusters; ++cluster) {
+        clusterOrder[cluster] = cluster;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b) {
+        return clusterSortKeys[a] > clusterSortKeys[b];
+    });
+
+    std::vector<uint32> sorted;
+    sorted.reserve(indices.size());
+    for (size_t cluster : clusterOrder) {
+        sorted.insert(sorted.end(), indices.begin() + 3 * clusterStarts[cluster],
+                      indices.begin() + 3 * clusterStarts[cluster + 1]);
+    }
+
+    indices.swap(sorted);
+}
+
+
+//---------------------------------------------------------------------------------------
+void MeshOptimizer::optimizeVertexFetch (
+    std::vector<FloatVertex> & vertices,
+    std::vector<uint32> & indices
+) {
+    std::vector<uint32> remap(vertices.size(), NotCached);
+    std::vector<FloatVertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (uint32 & index : indices) {
+        if (remap[index] == NotCached) {
+            remap[index] = static_cast<uint32>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(ordered);
+}
+
+
+//---------------------------------------------------------------------------------------
+float MeshOptimizer::averageCacheMissRatio (
+    const std::vector<uint32> & indices,
+    size_t numVertices,
+    uint cacheSize
+) {
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return 0.0f;
+    }
+
+    std::vector<uint64> missTimes(numVertices, 0);
+    uint64 time = cacheSize;
+    uint64 numMisses = 0;
+    for (size_t triangle = 0; triangle < numTriangles; ++triangle) {
+        numMisses += simulateFifoCache(&indices[3 * triangle], missTimes, time, cacheSize);
+    }
+
+    return float(numMisses) / numTriangles;
+}
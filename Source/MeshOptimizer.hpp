@@ -0,0 +1,58 @@
+//
+//  MeshOptimizer.hpp
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "NumericTypes.h"
+#include "VertexFormat.hpp"
+
+
+// Reorders indexed triangle lists to draw faster, as Tools/ImportMesh does before
+// writing a MeshFile. Passes run in the order declared: vertex cache, then overdraw,
+// then vertex fetch.
+class MeshOptimizer {
+public:
+    // Entries of the LRU post transform vertex cache optimizeVertexCache targets.
+    static const uint VertexCacheSize = 32;
+
+    // Entries of the FIFO cache simulated to measure and cluster triangle orders, the
+    // smaller and simpler cache of older GPUs.
+    static const uint FifoCacheSize = 16;
+
+    // Orders triangles to reuse recently transformed vertices, with Tom Forsyth's
+    // "Linear-Speed Vertex Cache Optimisation", in time linear in the triangles.
+    static void optimizeVertexCache (
+        std::vector<uint32> & indices,
+        size_t numVertices
+    );
+
+    // Cuts triangles in vertex cache order into clusters, where restarting the cache
+    // costs at most threshold times the misses, then orders the clusters facing out
+    // from the mesh center first. Those are the likeliest to occlude the others from
+    // any view (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+    // Locality and Reduced Overdraw").
+    static void optimizeOverdraw (
+        std::vector<uint32> & indices,
+        const std::vector<FloatVertex> & vertices,
+        float threshold = 1.05f
+    );
+
+    // Orders vertices by first use and remaps the indices to match, so vertex fetch
+    // walks the buffer forward. Unused vertices are dropped.
+    static void optimizeVertexFetch (
+        std::vector<FloatVertex> & vertices,
+        std::vector<uint32> & indices
+    );
+
+    // Vertices transformed per triangle with a FIFO cache of cacheSize entries, from
+    // 3 with no reuse down to about 0.5 for large regular meshes.
+    static float averageCacheMissRatio (
+        const std::vector<uint32> & indices,
+        size_t numVertices,
+        uint cacheSize = FifoCacheSize
+    );
+};
@@ -0,0 +1,125 @@
+//
+//  OffscreenFramebuffer.cpp
+//
+
+#include "OffscreenFramebuffer.hpp"
+
+#include "GLStateCache.hpp"
+
+
+class OffscreenFramebufferImpl {
+private:
+    friend class OffscreenFramebuffer;
+
+    GLuint m_framebuffer;
+    GLuint m_colorRenderbuffer;
+    GLuint m_depthRenderbuffer;
+    FramebufferSize m_size;
+
+
+    OffscreenFramebufferImpl(FramebufferSize size);
+
+    ~OffscreenFramebufferImpl();
+};
+
+
+//---------------------------------------------------------------------------------------
+OffscreenFramebufferImpl::OffscreenFramebufferImpl (
+    FramebufferSize size
+)
+    : m_framebuffer(0),
+      m_colorRenderbuffer(0),
+      m_depthRenderbuffer(0),
+      m_size(size)
+{
+    glGenRenderbuffers(1, &m_colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.width, size.height);
+
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.width, size.height);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    GLStateCache::bindFramebuffer(m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              m_colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                              m_depthRenderbuffer);
+
+    CHECK_GL_ERRORS;
+    CHECK_FRAMEBUFFER_COMPLETENESS;
+}
+
+
+//---------------------------------------------------------------------------------------
+OffscreenFramebufferImpl::~OffscreenFramebufferImpl()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+    glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+
+    // Deleting a bound framebuffer reverts the binding to zero behind the cache.
+    GLStateCache::invalidateFramebuffer();
+}
+
+
+//---------------------------------------------------------------------------------------
+OffscreenFramebuffer::OffscreenFramebuffer (
+    FramebufferSize size
+) {
+    impl = new OffscreenFramebufferImpl(size);
+}
+
+
+//---------------------------------------------------------------------------------------
+OffscreenFramebuffer::~OffscreenFramebuffer()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+GLuint OffscreenFramebuffer::framebuffer() const
+{
+    return impl->m_framebuffer;
+}
+
+
+//---------------------------------------------------------------------------------------
+FramebufferSize OffscreenFramebuffer::size() const
+{
+    return impl->m_size;
+}
+
+
+//---------------------------------------------------------------------------------------
+void OffscreenFramebuffer::readPixelsRGB (
+    std::vector<uint8> & pixels
+) const {
+    const GLint width = impl->m_size.width;
+    const GLint height = impl->m_size.height;
+
+    // RGBA/UNSIGNED_BYTE is the one format/type pair glReadPixels always supports.
+    std::vector<uint8> rgba(width * height * 4);
+
+    GLStateCache::bindFramebuffer(impl->m_framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    CHECK_GL_ERRORS;
+
+    // Drop alpha and flip rows, since GL reads bottom row first.
+    pixels.resize(width * height * 3);
+    for (GLint row = 0; row < height; ++row) {
+        const uint8 * src = &rgba[(height - 1 - row) * width * 4];
+        uint8 * dst = &pixels[row * width * 3];
+        for (GLint col = 0; col < width; ++col) {
+            dst[col * 3 + 0] = src[col * 4 + 0];
+            dst[col * 3 + 1] = src[col * 4 + 1];
+            dst[col * 3 + 2] = src[col * 4 + 2];
+        }
+    }
+}
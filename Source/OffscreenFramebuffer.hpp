@@ -0,0 +1,40 @@
+//
+//  OffscreenFramebuffer.hpp
+//
+
+#pragma once
+
+#include <vector>
+
+#include "NumericTypes.h"
+#include "GLPlatform.h"
+#include "RendererTypes.h"
+
+
+// Forward declaration
+class OffscreenFramebufferImpl;
+
+
+// Framebuffer object with RGBA8 color and 24 bit depth renderbuffers, standing in for
+// the GLKView drawable when rendering headless.
+class OffscreenFramebuffer {
+public:
+    OffscreenFramebuffer (
+        FramebufferSize size
+    );
+
+    ~OffscreenFramebuffer();
+
+    GLuint framebuffer() const;
+
+    FramebufferSize size() const;
+
+    // Reads back the color buffer as tightly packed RGB rows, top row first.
+    // Blocks until all rendering to the framebuffer has completed.
+    void readPixelsRGB (
+        std::vector<uint8> & pixels
+    ) const;
+
+private:
+    OffscreenFramebufferImpl * impl;
+};
@@ -14,14 +14,24 @@ using std::sin;
 #import <algorithm>
 using std::min;
 
+#import <cstddef>
+
 #import <glm/gtx/rotate_vector.hpp>
 using glm::rotateY;
 
 
-#import "ShaderProgram.hpp"
+#import "ShaderPermutations.hpp"
 #import "AssetDirectory.hpp"
 #import "VertexAttributeDefines.h"
 #import "NormRand.hpp"
+#import "GLStateCache.hpp"
+#import "TornadoMath.hpp"
+#import "Profiler.hpp"
+#import "PipelineStatistics.hpp"
+
+
+// Matches TornadoParticleSimVS.glsl, which has no debris particles below this.
+static const float MinDebrisParticleRandomness = 0.05f;
 
 
 class ParticleSystemImpl {
@@ -33,26 +43,20 @@ private:
     uint m_maxParticles;
     float m_particleRandomness;
     
+    glm::mat4 m_viewProjectMatrix;
+    float m_pixelScale;
+    
     const AssetDirectory & m_assetDirectory;
     
-    ShaderProgram m_shaderProgram_TFUpdate;
-    struct UniformLocations {
-        GLint basisMatrix;
-        GLint derivMatrix;
-        GLint rotationRadius;
-        GLint rotationalVelocity;
-        GLint parametricVelocity;
-        GLint deltaTime;
-        GLint particleRandomness;
-        GLint numActiveParticles;
-    };
-    UniformLocations m_uniformLocations;
+    ShaderPermutations m_shaderPermutations_TFUpdate;
+    ShaderProgram * m_shaderProgram_TFUpdate;  // Variant for m_particleRandomness
     
     
     struct ParticleData {
         glm::vec3 position;
         float parametricDist;
         float rotationAngle;
+        float projectedSize;
     };
     
     struct ControlPointMotion {
@@ -81,16 +85,20 @@ private:
     BezierCurve m_tornadoCurve;
     
     
-    // Transform Feedback source/destination buffers.
-    // For holding interleaved vertex attributes
-    struct TransformFeedbackBuffers {
-        GLuint sourceVbo;
-        GLuint destVbo;
-    };
-    TransformFeedbackBuffers m_TFBuffers;
+    // Ring of particle buffers holding interleaved vertex attributes.
+    // Each frame the simulation reads m_sourceBuffer and writes m_destBuffer, while
+    // rendering instances from m_sourceBuffer.
+    GLuint m_particleVbos[ParticleSystem::NumParticleBuffers];
+    
+    // Per buffer VAO mapping particle attributes as simulation input.
+    GLuint m_particleVaos[ParticleSystem::NumParticleBuffers];
+    
+    // Per buffer fence signaled once all reads issued in the frame it was the source
+    // are complete, null if not pending.
+    GLsync m_readFences[ParticleSystem::NumParticleBuffers];
     
-    GLuint m_vao_TFSource;
-    GLuint m_vao_TFDest;
+    uint m_sourceBuffer;
+    uint m_destBuffer;
     
     
     
@@ -102,8 +110,13 @@ private:
         float particleRandomness
     );
     
+    ~ParticleSystemImpl();
+    
     void loadShaders();
     
+    // Picks the particle update program variant for m_particleRandomness.
+    void selectShaderVariant();
+    
     void initTransformFeedbackBuffers();
     
     void setupVertexAttribMappings();
@@ -114,12 +127,11 @@ private:
         uint numActiveParticles
     );
     
-    void update (
-        double secondsSinceLastUpdate
-    );
+    void update();
     
-    void updateUniforms (
-        double secondsSinceLastUpdate
+    void updateUniformData (
+        double secondsSinceLastUpdate,
+        ParticleSimUniforms & uniforms
     );
     
     void initTornadoCurve();
@@ -128,6 +140,8 @@ private:
     
     VertexAttributeDescriptor getVertexDescriptorForParticlePositions() const;
     
+    VertexAttributeDescriptor getVertexDescriptorForProjectedSizes() const;
+    
     void updateTornadoCurveMotion (
         double secondsSinceLastUpdate
     );
@@ -151,8 +165,15 @@ ParticleSystemImpl::ParticleSystemImpl (
     : m_assetDirectory(assetDirectory),
       m_numActiveParticles(numActiveParticles),
       m_maxParticles(maxParticles),
-      m_particleRandomness(particleRandomness)
+      m_particleRandomness(particleRandomness),
+      m_pixelScale(0.0f),
+      m_sourceBuffer(0),
+      m_destBuffer(0)
 {
+    for (GLsync & fence : m_readFences) {
+        fence = nullptr;
+    }
+    
     loadShaders();
     
     initTransformFeedbackBuffers();
@@ -164,6 +185,19 @@ ParticleSystemImpl::ParticleSystemImpl (
     initTornadoCurve();
 }
 
+//---------------------------------------------------------------------------------------
+ParticleSystemImpl::~ParticleSystemImpl()
+{
+    for (GLsync & fence : m_readFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteVertexArrays(ParticleSystem::NumParticleBuffers, m_particleVaos);
+    glDeleteBuffers(ParticleSystem::NumParticleBuffers, m_particleVbos);
+    GLStateCache::invalidate();
+}
+
 //---------------------------------------------------------------------------------------
 ParticleSystem::ParticleSystem (
     const AssetDirectory & assetDirectory,
@@ -185,58 +219,49 @@ ParticleSystem::~ParticleSystem()
 
 //---------------------------------------------------------------------------------------
 void ParticleSystemImpl::loadShaders() {
-    m_shaderProgram_TFUpdate.generateProgramObject();
-    m_shaderProgram_TFUpdate.attachVertexShader(m_assetDirectory.at("TornadoParticleSimVS.glsl"));
-    m_shaderProgram_TFUpdate.attachFragmentShader(m_assetDirectory.at("TornadoParticleSimFS.glsl"));
+    PROFILE_SCOPE("ParticleSystem::loadShaders");
     
-    const GLchar* feedbackVaryings[] = { "VsOut.position",
-                                         "VsOut.parametricDist",
-                                         "VsOut.rotationAngle" };
-    glTransformFeedbackVaryings(m_shaderProgram_TFUpdate, 3, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+    m_shaderPermutations_TFUpdate.setShaders(
+            m_assetDirectory.at("TornadoParticleSimVS.glsl"),
+            m_assetDirectory.at("TornadoParticleSimFS.glsl"));
     
-    m_shaderProgram_TFUpdate.link();
+    const std::vector<std::string> feedbackVaryings = { "vsOut_position",
+                                                        "vsOut_parametricDist",
+                                                        "vsOut_rotationAngle",
+                                                        "vsOut_projectedSize" };
+    m_shaderPermutations_TFUpdate.setTransformFeedbackVaryings(feedbackVaryings,
+                                                               GL_INTERLEAVED_ATTRIBS);
     
+    // The NO_DEBRIS variant skips debris math below the randomness that has debris.
+    m_shaderPermutations_TFUpdate.variant();
+    m_shaderPermutations_TFUpdate.variant({ {"NO_DEBRIS", "1"} });
     
-    //-- Query uniform locations:
-    {
-        m_uniformLocations.basisMatrix =
-            m_shaderProgram_TFUpdate.getUniformLocation("basisMatrix");
+    selectShaderVariant();
+}
 
-        m_uniformLocations.derivMatrix =
-            m_shaderProgram_TFUpdate.getUniformLocation("derivMatrix");
-        
-        m_uniformLocations.rotationRadius =
-            m_shaderProgram_TFUpdate.getUniformLocation("rotationRadius");
-        
-        m_uniformLocations.rotationalVelocity =
-            m_shaderProgram_TFUpdate.getUniformLocation("rotationalVelocity");
-        
-        m_uniformLocations.parametricVelocity =
-            m_shaderProgram_TFUpdate.getUniformLocation("parametricVelocity");
-        
-        m_uniformLocations.deltaTime =
-            m_shaderProgram_TFUpdate.getUniformLocation("deltaTime");
-        
-        m_uniformLocations.particleRandomness =
-            m_shaderProgram_TFUpdate.getUniformLocation("particleRandomness");
-        
-        m_uniformLocations.numActiveParticles =
-            m_shaderProgram_TFUpdate.getUniformLocation("numActiveParticles");
-        
+
+//---------------------------------------------------------------------------------------
+void ParticleSystemImpl::selectShaderVariant()
+{
+    ShaderDefines defines;
+    if (m_particleRandomness < MinDebrisParticleRandomness) {
+        defines["NO_DEBRIS"] = "1";
     }
     
-    CHECK_GL_ERRORS;
+    m_shaderProgram_TFUpdate = &m_shaderPermutations_TFUpdate.variant(defines);
 }
 
 
 //---------------------------------------------------------------------------------------
 void ParticleSystemImpl::initTransformFeedbackBuffers()
 {
+    PROFILE_SCOPE("ParticleSystem::initTransformFeedbackBuffers");
+    
     // Allocate enough space for maxParticles.
     std::vector<ParticleData> particleData(m_maxParticles);
     
     // Randomnly seed particles throughout tornado.
-    ParticleData initialData = { glm::vec3(0.0f), 0.0f, 0.0f };
+    ParticleData initialData = { glm::vec3(0.0f), 0.0f, 0.0f, 0.0f };
     const float TWO_PI = 2.0f * M_PI;
     for(int i(0); i < m_maxParticles; ++i) {
         initialData.rotationAngle = rand0to1() * TWO_PI;
@@ -246,16 +271,14 @@ void ParticleSystemImpl::initTransformFeedbackBuffers()
     
     GLsizeiptr numBytes = particleData.size() * sizeof(ParticleData);
     
-    glGenBuffers(1, &m_TFBuffers.sourceVbo);
-    glGenBuffers(1, &m_TFBuffers.destVbo);
-    
-    // Place particle data into source VBO.
-    glBindBuffer(GL_ARRAY_BUFFER, m_TFBuffers.sourceVbo);
-    glBufferData(GL_ARRAY_BUFFER, numBytes, particleData.data(), GL_STREAM_COPY);
+    glGenBuffers(ParticleSystem::NumParticleBuffers, m_particleVbos);
     
-    // Allocate space for destination VBO
-    glBindBuffer(GL_ARRAY_BUFFER, m_TFBuffers.destVbo);
-    glBufferData(GL_ARRAY_BUFFER, numBytes, nullptr, GL_STREAM_COPY);
+    // Seed every buffer, so whichever one is rendered first holds valid particles.
+    for (GLuint vbo : m_particleVbos) {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, numBytes, particleData.data(), GL_STREAM_COPY);
+        PipelineCounters::countBytesUploaded(numBytes);
+    }
     
     CHECK_GL_ERRORS;
 }
@@ -265,14 +288,10 @@ void ParticleSystemImpl::initTransformFeedbackBuffers()
 //---------------------------------------------------------------------------------------
 void ParticleSystemImpl::setupVertexAttribMappings()
 {
-    glGenVertexArrays(1, &m_vao_TFSource);
-    glGenVertexArrays(1, &m_vao_TFDest);
-    
-    GLuint vao[] = {m_vao_TFSource, m_vao_TFDest};
-    GLuint vertexBuffer[] = {m_TFBuffers.sourceVbo, m_TFBuffers.destVbo};
+    glGenVertexArrays(ParticleSystem::NumParticleBuffers, m_particleVaos);
     
-    for (int i(0); i < 2; ++i) {
-        glBindVertexArray(vao[i]);
+    for (int i(0); i < ParticleSystem::NumParticleBuffers; ++i) {
+        GLStateCache::bindVertexArray(m_particleVaos[i]);
         
         // Enable vertex attribute slots
         glEnableVertexAttribArray(ATTRIBUTE_SLOT_0);
@@ -282,7 +301,7 @@ void ParticleSystemImpl::setupVertexAttribMappings()
         // Set mapping of data from transform feedback buffer into
         // vertex attribute slots
         
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[i]);
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_particleVbos[i]);
         
         // Parametric Distance
         {
@@ -373,103 +392,111 @@ void ParticleSystemImpl::updateTornadoCurveMotion (
 //---------------------------------------------------------------------------------------
 void ParticleSystemImpl::updateBezierMatricesFromControlPoint()
 {
-    glm::mat4 pMatrix = {
-        glm::vec4(m_tornadoCurve.p0, 0.0f),
-        glm::vec4(m_tornadoCurve.p1, 0.0f),
-        glm::vec4(m_tornadoCurve.p2, 0.0f),
-        glm::vec4(m_tornadoCurve.p3, 0.0f)
-    };
-    
-    glm::mat4 coefficientMatrix = {
-        { 1.0f,  0.0f,  0.0f,  0.0f},
-        {-3.0f,  3.0f,  0.0f,  0.0f},
-        { 3.0f, -6.0f,  3.0f,  0.0f},
-        {-1.0f,  3.0f, -3.0f,  1.0f}
-    };
-    
-    m_tornadoCurve.basisMatrix = pMatrix * coefficientMatrix;
-    
-    
-    glm::mat4 derivCoefficientMatrix = {
-        {-3.0f,  3.0f,  0.0f,  0.0f},
-        { 6.0f, -12.0f, 6.0f,  0.0f},
-        {-3.0f,  9.0f, -9.0f,  3.0f},
-        { 0.0f,  0.0f,  0.0f,  0.0f},
-    };
-    
-    m_tornadoCurve.derivMatrix = pMatrix * derivCoefficientMatrix;
+    BezierMatrices matrices = bezierMatricesFromControlPoints(m_tornadoCurve.p0,
+                                                              m_tornadoCurve.p1,
+                                                              m_tornadoCurve.p2,
+                                                              m_tornadoCurve.p3);
     
+    m_tornadoCurve.basisMatrix = matrices.basisMatrix;
+    m_tornadoCurve.derivMatrix = matrices.derivMatrix;
 }
 
+
 //---------------------------------------------------------------------------------------
 void ParticleSystemImpl::setStaticUniformData()
 {
-    m_shaderProgram_TFUpdate.enable();
-    
-    glUniform1f(m_uniformLocations.rotationRadius, 2.0f);
-    
-    glUniform1f(m_uniformLocations.rotationalVelocity, 10.0f);
-    
-    glUniform1f(m_uniformLocations.parametricVelocity, 0.2f);
-    
-    
-    CHECK_GL_ERRORS;
+    for (ShaderProgram * program : m_shaderPermutations_TFUpdate.variants()) {
+        program->enable();
+        
+        program->setUniform(program->uniformIndex("rotationRadius"), 2.0f);
+        
+        program->setUniform(program->uniformIndex("rotationalVelocity"), 10.0f);
+        
+        program->setUniform(program->uniformIndex("parametricVelocity"), 0.2f);
+    }
 }
 
 
 //---------------------------------------------------------------------------------------
-void ParticleSystem::update (
-    double secondsSinceLastUpdate
+void ParticleSystem::setUniformBlockBinding (
+    GLuint bindingIndex
 ) {
-    impl->update(secondsSinceLastUpdate);
+    for (ShaderProgram * program : impl->m_shaderPermutations_TFUpdate.variants()) {
+        program->setUniformBlockBinding("ParticleSim", bindingIndex);
+    }
 }
 
 
 //---------------------------------------------------------------------------------------
-void ParticleSystemImpl::updateUniforms (
-    double secondsSinceLastUpdate
+void ParticleSystem::updateUniformData (
+    double secondsSinceLastUpdate,
+    ParticleSimUniforms & uniforms
 ) {
-    glUniform1f(m_uniformLocations.deltaTime, secondsSinceLastUpdate);
-    
-    glUniform1f(m_uniformLocations.particleRandomness, m_particleRandomness);
-    
-    glUniform1f(m_uniformLocations.numActiveParticles, m_numActiveParticles);
-    
-    glUniformMatrix4fv(m_uniformLocations.basisMatrix, 1, GL_FALSE, &m_tornadoCurve.basisMatrix[0][0]);
-    
-    glUniformMatrix4fv(m_uniformLocations.derivMatrix, 1, GL_FALSE, &m_tornadoCurve.derivMatrix[0][0]);
-    
-    CHECK_GL_ERRORS;
+    impl->updateUniformData(secondsSinceLastUpdate, uniforms);
 }
 
+
 //---------------------------------------------------------------------------------------
-void ParticleSystemImpl::update (
-    double secondsSinceLastUpdate
+void ParticleSystemImpl::updateUniformData (
+    double secondsSinceLastUpdate,
+    ParticleSimUniforms & uniforms
 ) {
     updateTornadoCurveMotion(secondsSinceLastUpdate);
     
-    m_shaderProgram_TFUpdate.enable();
-    updateUniforms(secondsSinceLastUpdate);
+    uniforms.basisMatrix = m_tornadoCurve.basisMatrix;
+    uniforms.derivMatrix = m_tornadoCurve.derivMatrix;
+    uniforms.deltaTime = static_cast<float>(secondsSinceLastUpdate);
+    uniforms.particleRandomness = m_particleRandomness;
+    uniforms.numActiveParticles = static_cast<float>(m_numActiveParticles);
+    uniforms.pixelScale = m_pixelScale;
+    uniforms.viewProjectMatrix = m_viewProjectMatrix;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ParticleSystem::update()
+{
+    impl->update();
+}
+
+
+//---------------------------------------------------------------------------------------
+void ParticleSystemImpl::update()
+{
+    PROFILE_SCOPE("ParticleSystem::update");
+    
+    // Last frame's output becomes this frame's source, and the simulation writes to
+    // the buffer rendered two frames ago.
+    m_sourceBuffer = m_destBuffer;
+    m_destBuffer = (m_destBuffer + 1) % ParticleSystem::NumParticleBuffers;
+    
+    // Order transform feedback writes after the GPU is done reading the destination,
+    // without blocking the CPU.
+    GLsync & readFence = m_readFences[m_destBuffer];
+    if (readFence) {
+        glWaitSync(readFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(readFence);
+        readFence = nullptr;
+    }
+    
+    m_shaderProgram_TFUpdate->enable();
     
-    glBindVertexArray(m_vao_TFSource);
+    GLStateCache::bindVertexArray(m_particleVaos[m_sourceBuffer]);
     
     // Prevent rasterization
-    glEnable(GL_RASTERIZER_DISCARD);
+    GLStateCache::enable(GL_RASTERIZER_DISCARD);
     
     // Write transform feedback output to destination vbo.
     GLuint bindingIndex(0);
-    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, bindingIndex, m_TFBuffers.destVbo);
+    GLStateCache::bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, bindingIndex,
+                                 m_particleVbos[m_destBuffer]);
     
     glBeginTransformFeedback(GL_POINTS);
         glDrawArrays(GL_POINTS, 0, m_numActiveParticles);
+        PipelineCounters::countDrawCall();
     glEndTransformFeedback();
     
-    
-    // Swap source/destination transform feedback buffers
-    std::swap(m_vao_TFSource, m_vao_TFDest);
-    std::swap(m_TFBuffers.sourceVbo, m_TFBuffers.destVbo);
-    
-    glDisable(GL_RASTERIZER_DISCARD);
+    GLStateCache::disable(GL_RASTERIZER_DISCARD);
     CHECK_GL_ERRORS;
 }
 
@@ -497,12 +524,38 @@ uint ParticleSystem::numActiveParticles() const {
 }
 
 
+//---------------------------------------------------------------------------------------
+void ParticleSystem::fenceParticlePositionReads()
+{
+    GLsync & readFence = impl->m_readFences[impl->m_sourceBuffer];
+    if (readFence) {
+        glDeleteSync(readFence);
+    }
+    readFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint ParticleSystem::particlePositionsBufferIndex () const
+{
+    return impl->m_sourceBuffer;
+}
+
+
 //---------------------------------------------------------------------------------------
 GLuint ParticleSystem::particlePositionsVbo () const
 {
-    // After calling ParticleSystem::update(), the transform feedback destination buffer
-    // is swapped with the transform feedback source buffer.
-    return impl->m_TFBuffers.sourceVbo;
+    return impl->m_particleVbos[impl->m_sourceBuffer];
+}
+
+
+//---------------------------------------------------------------------------------------
+GLuint ParticleSystem::particlePositionsVbo (
+    uint bufferIndex
+) const {
+    return impl->m_particleVbos[bufferIndex];
 }
 
 
@@ -527,11 +580,44 @@ VertexAttributeDescriptor ParticleSystemImpl::getVertexDescriptorForParticlePosi
 }
 
 
+//---------------------------------------------------------------------------------------
+VertexAttributeDescriptor ParticleSystem::getVertexDescriptorForProjectedSizes() const
+{
+    return impl->getVertexDescriptorForProjectedSizes();
+}
+
+
+//---------------------------------------------------------------------------------------
+VertexAttributeDescriptor ParticleSystemImpl::getVertexDescriptorForProjectedSizes() const
+{
+    VertexAttributeDescriptor descriptor;
+    
+    descriptor.numComponents = 1;
+    descriptor.type = GL_FLOAT;
+    descriptor.offset =
+        reinterpret_cast<const GLvoid *>(offsetof(ParticleData, projectedSize));
+    descriptor.stride = sizeof(ParticleData);
+    
+    return descriptor;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ParticleSystem::setCamera (
+    const glm::mat4 & viewProjectMatrix,
+    float pixelScale
+) {
+    impl->m_viewProjectMatrix = viewProjectMatrix;
+    impl->m_pixelScale = pixelScale;
+}
+
+
 //---------------------------------------------------------------------------------------
 void ParticleSystem::setParticleRandomness (
     float x
 ) {
     impl->m_particleRandomness = x;
+    impl->selectShaderVariant();
 }
 
 
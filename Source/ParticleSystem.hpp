@@ -4,7 +4,7 @@
 
 #include "NumericTypes.h"
 #include "AssetDirectory.hpp"
-#import <OpenGLES/ES3/gl.h>
+#import "GLPlatform.h"
 
 #import <glm/glm.hpp>
 
@@ -12,6 +12,20 @@
 class ParticleSystemImpl;
 
 
+// Per frame simulation parameters, matching the std140 layout of uniform block
+// ParticleSim in TornadoParticleSimVS.glsl.
+struct ParticleSimUniforms
+{
+    glm::mat4 basisMatrix;    // B(t)
+    glm::mat4 derivMatrix;    // B'(t)
+    float deltaTime;
+    float particleRandomness;
+    float numActiveParticles;
+    float pixelScale;               // Pixels across one world unit at clip space w = 1.
+    glm::mat4 viewProjectMatrix;    // Camera for measuring projected particle size.
+};
+
+
 struct VertexAttributeDescriptor
 {
     GLint numComponents;
@@ -23,6 +37,11 @@ struct VertexAttributeDescriptor
 
 class ParticleSystem {
 public:
+    // Depth of the particle buffer ring. Frame N simulates into one buffer while
+    // frame N-1's output is read by both the simulation and rendering.
+    static const uint NumParticleBuffers = 3;
+    
+    
     ParticleSystem (
         const AssetDirectory & assetDirectory,
         uint numActiveParticles,
@@ -44,17 +63,54 @@ public:
     // Return vertex attribute layout for interleaved particle position data.
     VertexAttributeDescriptor getVertexDescriptorForParticlePositions() const;
     
-    // Returns Vertex Buffer object referencing particle position data.
+    // Return vertex attribute layout for the interleaved diameter in pixels of each
+    // particle's cube, as seen by the camera given to setCamera().
+    VertexAttributeDescriptor getVertexDescriptorForProjectedSizes() const;
+    
+    // Index in [0, NumParticleBuffers) of the buffer to render this frame, holding the
+    // previous frame's simulation output.
+    uint particlePositionsBufferIndex () const;
+    
+    // Returns Vertex Buffer object referencing particle position data to render this
+    // frame.
     GLuint particlePositionsVbo () const;
     
+    // Returns Vertex Buffer object of the given particle buffer, for building one VAO
+    // per buffer up front.
+    GLuint particlePositionsVbo (
+        uint bufferIndex
+    ) const;
+    
     // Clamped value between [0,1] for degee of randomness of particle motion.
     void setParticleRandomness(float x);
     
-    // Advance particle system by the given time step.
-    void update (
-        double secondsSinceLastUpdate
+    // Camera the simulation measures projected sizes against. pixelScale is the number
+    // of pixels across one world unit at clip space w = 1.
+    void setCamera (
+        const glm::mat4 & viewProjectMatrix,
+        float pixelScale
+    );
+    
+    // Bind the simulation program's ParticleSim uniform block to bindingIndex.
+    void setUniformBlockBinding (
+        GLuint bindingIndex
     );
     
+    // Advance tornado curve motion by the given time step, and write this frame's
+    // simulation parameters to uniforms.
+    void updateUniformData (
+        double secondsSinceLastUpdate,
+        ParticleSimUniforms & uniforms
+    );
+    
+    // Advance particles, reading simulation parameters from the uniform buffer range
+    // bound at the index given to setUniformBlockBinding().
+    void update();
+    
+    // Call once per frame after the last command reading particlePositionsVbo(), so
+    // the buffer is not overwritten while still in use.
+    void fenceParticlePositionReads();
+    
     
     glm::vec3 getCenterOfTornado() const;
     
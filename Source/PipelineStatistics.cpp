@@ -0,0 +1,343 @@
+//
+//  PipelineStatistics.cpp
+//
+
+#include "PipelineStatistics.hpp"
+
+#include "GLStateCache.hpp"
+
+
+namespace {
+    uint64 g_numDrawCalls = 0;
+    uint64 g_numBytesUploaded = 0;
+    uint64 g_numUniformUploads = 0;
+    uint64 g_numSkippedUniformUploads = 0;
+    uint64 g_numVertexFetchBytes = 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::countDrawCall()
+{
+    ++g_numDrawCalls;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::countBytesUploaded (
+    uint64 numBytes
+) {
+    g_numBytesUploaded += numBytes;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::countUniformUpload()
+{
+    ++g_numUniformUploads;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::countSkippedUniformUpload()
+{
+    ++g_numSkippedUniformUploads;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::countVertexFetchBytes (
+    uint64 numBytes
+) {
+    g_numVertexFetchBytes += numBytes;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 PipelineCounters::numDrawCalls()
+{
+    return g_numDrawCalls;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 PipelineCounters::numBytesUploaded()
+{
+    return g_numBytesUploaded;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 PipelineCounters::numUniformUploads()
+{
+    return g_numUniformUploads;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 PipelineCounters::numSkippedUniformUploads()
+{
+    return g_numSkippedUniformUploads;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 PipelineCounters::numVertexFetchBytes()
+{
+    return g_numVertexFetchBytes;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineCounters::reset()
+{
+    g_numDrawCalls = 0;
+    g_numBytesUploaded = 0;
+    g_numUniformUploads = 0;
+    g_numSkippedUniformUploads = 0;
+    g_numVertexFetchBytes = 0;
+}
+
+
+
+class PipelineStatisticsQueriesImpl {
+private:
+    friend class PipelineStatisticsQueries;
+
+    struct FrameQueries {
+        GLuint transformFeedbackQuery;
+        GLuint samplesPassedQueries[RenderStage_Count];
+
+        // Bit per RenderStage with a samples passed query issued this frame.
+        uint issuedStages;
+        bool issuedTransformFeedbackQuery;
+
+        bool pending;
+
+        // CPU counters are filled in when the frame is closed off, and reported with
+        // the query results.
+        PipelineStatistics statistics;
+    };
+
+    FrameQueries m_frames[PipelineStatisticsQueries::NumFramesInRing];
+
+    // Slot of the frame being issued.
+    uint m_currentFrame;
+    uint64 m_frameNumber;
+    bool m_frameStarted;
+
+    PipelineStatistics m_latestStatistics;
+    bool m_hasLatestStatistics;
+
+
+    PipelineStatisticsQueriesImpl();
+
+    ~PipelineStatisticsQueriesImpl();
+
+    void collectFinishedFrames();
+
+    // Returns false if any query of frame is not yet available.
+    bool readFrame(FrameQueries & frame) const;
+};
+
+
+//---------------------------------------------------------------------------------------
+PipelineStatisticsQueriesImpl::PipelineStatisticsQueriesImpl()
+    : m_currentFrame(0),
+      m_frameNumber(0),
+      m_frameStarted(false),
+      m_hasLatestStatistics(false)
+{
+    for (FrameQueries & frame : m_frames) {
+        glGenQueries(1, &frame.transformFeedbackQuery);
+        glGenQueries(RenderStage_Count, frame.samplesPassedQueries);
+        frame.issuedStages = 0;
+        frame.issuedTransformFeedbackQuery = false;
+        frame.pending = false;
+    }
+
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+PipelineStatisticsQueriesImpl::~PipelineStatisticsQueriesImpl()
+{
+    for (FrameQueries & frame : m_frames) {
+        glDeleteQueries(1, &frame.transformFeedbackQuery);
+        glDeleteQueries(RenderStage_Count, frame.samplesPassedQueries);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+PipelineStatisticsQueries::PipelineStatisticsQueries()
+{
+    impl = new PipelineStatisticsQueriesImpl();
+}
+
+
+//---------------------------------------------------------------------------------------
+PipelineStatisticsQueries::~PipelineStatisticsQueries()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineStatisticsQueries::beginFrame()
+{
+    // Close off the previous frame with the counts gathered while it was issued, then
+    // collect it along with any older frames.
+    if (impl->m_frameStarted) {
+        PipelineStatisticsQueriesImpl::FrameQueries & previous =
+            impl->m_frames[impl->m_currentFrame];
+
+        previous.statistics.numDrawCalls = PipelineCounters::numDrawCalls();
+        previous.statistics.numBytesUploaded = PipelineCounters::numBytesUploaded();
+        previous.statistics.numUniformUploads = PipelineCounters::numUniformUploads();
+        previous.statistics.numSkippedUniformUploads =
+            PipelineCounters::numSkippedUniformUploads();
+        previous.statistics.numVertexFetchBytes = PipelineCounters::numVertexFetchBytes();
+        previous.statistics.numStateChanges = GLStateCache::numIssuedCalls();
+        previous.statistics.numElidedStateChanges = GLStateCache::numElidedCalls();
+        previous.pending = true;
+    }
+
+    impl->collectFinishedFrames();
+
+    if (impl->m_frameStarted) {
+        impl->m_currentFrame = (impl->m_currentFrame + 1) % NumFramesInRing;
+        ++impl->m_frameNumber;
+    }
+    impl->m_frameStarted = true;
+
+    // If the GPU is still working through this slot's last frame, drop its results
+    // rather than wait for them.
+    PipelineStatisticsQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    frame.pending = false;
+    frame.issuedStages = 0;
+    frame.issuedTransformFeedbackQuery = false;
+    frame.statistics.frameNumber = impl->m_frameNumber;
+
+    PipelineCounters::reset();
+    GLStateCache::resetCallCounts();
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineStatisticsQueriesImpl::collectFinishedFrames()
+{
+    // Walk from oldest to newest, ending with the current slot, and stop at the first
+    // frame still in flight, since later frames finish after it.
+    for (uint i = 1; i <= PipelineStatisticsQueries::NumFramesInRing; ++i) {
+        FrameQueries & frame =
+            m_frames[(m_currentFrame + i) % PipelineStatisticsQueries::NumFramesInRing];
+        if (!frame.pending) {
+            continue;
+        }
+
+        if (!readFrame(frame)) {
+            break;
+        }
+
+        frame.pending = false;
+        m_latestStatistics = frame.statistics;
+        m_hasLatestStatistics = true;
+    }
+
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool PipelineStatisticsQueriesImpl::readFrame (
+    FrameQueries & frame
+) const {
+    // Query availability first, so results are only read when all are.
+    GLuint available = GL_TRUE;
+    if (frame.issuedTransformFeedbackQuery) {
+        glGetQueryObjectuiv(frame.transformFeedbackQuery, GL_QUERY_RESULT_AVAILABLE,
+                            &available);
+    }
+    for (int stage = 0; available && stage < RenderStage_Count; ++stage) {
+        if (frame.issuedStages & (1u << stage)) {
+            glGetQueryObjectuiv(frame.samplesPassedQueries[stage],
+                                GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+    }
+    if (!available) {
+        return false;
+    }
+
+    PipelineStatistics & statistics = frame.statistics;
+
+    statistics.transformFeedbackPrimitivesWritten = 0;
+    if (frame.issuedTransformFeedbackQuery) {
+        GLuint numPrimitives = 0;
+        glGetQueryObjectuiv(frame.transformFeedbackQuery, GL_QUERY_RESULT, &numPrimitives);
+        statistics.transformFeedbackPrimitivesWritten = numPrimitives;
+    }
+
+    for (int stage = 0; stage < RenderStage_Count; ++stage) {
+        GLuint anySamplesPassed = GL_FALSE;
+        if (frame.issuedStages & (1u << stage)) {
+            glGetQueryObjectuiv(frame.samplesPassedQueries[stage], GL_QUERY_RESULT,
+                                &anySamplesPassed);
+        }
+        statistics.anySamplesPassed[stage] = (anySamplesPassed != GL_FALSE);
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineStatisticsQueries::beginStage (
+    RenderStage stage
+) {
+    if (!impl->m_frameStarted) {
+        return;
+    }
+
+    PipelineStatisticsQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, frame.samplesPassedQueries[stage]);
+
+    // The particle simulation is the only stage using transform feedback.
+    if (stage == RenderStage_ParticleUpdate) {
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, frame.transformFeedbackQuery);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void PipelineStatisticsQueries::endStage (
+    RenderStage stage
+) {
+    if (!impl->m_frameStarted) {
+        return;
+    }
+
+    PipelineStatisticsQueriesImpl::FrameQueries & frame = impl->m_frames[impl->m_currentFrame];
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    frame.issuedStages |= (1u << stage);
+
+    if (stage == RenderStage_ParticleUpdate) {
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        frame.issuedTransformFeedbackQuery = true;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+bool PipelineStatisticsQueries::latestStatistics (
+    PipelineStatistics & statistics
+) const {
+    if (!impl->m_hasLatestStatistics) {
+        return false;
+    }
+
+    statistics = impl->m_latestStatistics;
+    return true;
+}
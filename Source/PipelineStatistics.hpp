@@ -0,0 +1,108 @@
+//
+//  PipelineStatistics.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+#include "GLPlatform.h"
+#include "RendererTypes.h"
+
+
+// Forward declaration
+class PipelineStatisticsQueriesImpl;
+
+
+// Work submitted in one frame, for checking that culling and LOD changes reduce it.
+struct PipelineStatistics {
+    // Counts frames since the PipelineStatisticsQueries was created, starting at zero.
+    uint64 frameNumber;
+
+    //-- Read back from GL queries.
+
+    // Particles written by the transform feedback simulation.
+    uint64 transformFeedbackPrimitivesWritten;
+
+    // Whether any sample of each stage passed the depth test. OpenGL ES 3.0 has no
+    // sample counting occlusion query, only GL_ANY_SAMPLES_PASSED.
+    bool anySamplesPassed[RenderStage_Count];
+
+    //-- Counted on the CPU while the frame was issued.
+
+    uint64 numDrawCalls;
+
+    // GL state changes forwarded to the driver and dropped as redundant by
+    // GLStateCache.
+    uint64 numStateChanges;
+    uint64 numElidedStateChanges;
+
+    // Bytes written into buffers by glBufferData and mapped uniform updates.
+    uint64 numBytesUploaded;
+
+    // Calls to the ShaderProgram::setUniform setters, uploaded or skipped as unchanged.
+    uint64 numUniformUploads;
+    uint64 numSkippedUniformUploads;
+
+    // Bytes of vertex attributes read by instanced cube draws, counting every vertex
+    // invocation. Post transform caching lowers what the GPU actually fetches.
+    uint64 numVertexFetchBytes;
+};
+
+
+// Counts draw calls and uploads as they are issued. Call the count methods next to
+// each glDraw* call and buffer upload.
+class PipelineCounters {
+public:
+    static void countDrawCall();
+
+    static void countBytesUploaded(uint64 numBytes);
+
+    static void countUniformUpload();
+
+    static void countSkippedUniformUpload();
+
+    static void countVertexFetchBytes(uint64 numBytes);
+
+    static uint64 numDrawCalls();
+
+    static uint64 numBytesUploaded();
+
+    static uint64 numUniformUploads();
+
+    static uint64 numSkippedUniformUploads();
+
+    static uint64 numVertexFetchBytes();
+
+    static void reset();
+};
+
+
+// Gathers PipelineStatistics for each frame.
+//
+// Queries are kept in a ring several frames deep and only read once available, as in
+// GpuTimerQueries, so results arrive a few frames late and collecting them never stalls.
+// beginFrame resets PipelineCounters and the GLStateCache call counts, so there should
+// be one PipelineStatisticsQueries in use at a time.
+class PipelineStatisticsQueries {
+public:
+    static const uint NumFramesInRing = 5;
+
+    PipelineStatisticsQueries();
+
+    ~PipelineStatisticsQueries();
+
+    // Call at the start of each frame, before any stage. Collects results of finished
+    // frames.
+    void beginFrame();
+
+    // Stages must not nest, and each may be queried at most once per frame.
+    void beginStage(RenderStage stage);
+
+    void endStage(RenderStage stage);
+
+    // Returns false if no frame has completed yet.
+    bool latestStatistics(PipelineStatistics & statistics) const;
+
+private:
+    PipelineStatisticsQueriesImpl * impl;
+};
@@ -0,0 +1,137 @@
+//
+//  Profiler.cpp
+//
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+    struct ProfileEvent {
+        const char * name;
+        uint64 startNanoseconds;
+        uint64 durationNanoseconds;
+    };
+
+    // Written only by its owning thread. numWritten is published with release
+    // ordering, so a reader that acquires it sees every event before it.
+    struct ThreadRing {
+        uint threadId;
+        std::atomic<uint64> numWritten;
+        ProfileEvent events[Profiler::RingCapacity];
+    };
+
+    // Rings live for the rest of the process, so exports may include threads that
+    // have exited.
+    std::mutex g_ringsMutex;
+    std::vector<ThreadRing *> g_rings;
+
+    thread_local ThreadRing * t_ring = nullptr;
+
+    const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+
+    //-----------------------------------------------------------------------------------
+    ThreadRing * createThreadRing()
+    {
+        ThreadRing * ring = new ThreadRing();
+        ring->numWritten.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        ring->threadId = static_cast<uint>(g_rings.size()) + 1;
+        g_rings.push_back(ring);
+
+        return ring;
+    }
+}
+
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+
+//---------------------------------------------------------------------------------------
+void Profiler::setEnabled (
+    bool enabled
+) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 Profiler::nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+
+//---------------------------------------------------------------------------------------
+void Profiler::recordEvent (
+    const char * name,
+    uint64 startNanoseconds,
+    uint64 endNanoseconds
+) {
+    if (!t_ring) {
+        t_ring = createThreadRing();
+    }
+
+    const uint64 index = t_ring->numWritten.load(std::memory_order_relaxed);
+
+    ProfileEvent & event = t_ring->events[index % RingCapacity];
+    event.name = name;
+    event.startNanoseconds = startNanoseconds;
+    event.durationNanoseconds = endNanoseconds - startNanoseconds;
+
+    t_ring->numWritten.store(index + 1, std::memory_order_release);
+}
+
+
+//---------------------------------------------------------------------------------------
+bool Profiler::writeChromeTrace (
+    const std::string & filePath
+) {
+    FILE * file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    for (const ThreadRing * ring : g_rings) {
+        const uint64 numWritten = ring->numWritten.load(std::memory_order_acquire);
+        const uint64 begin = (numWritten > RingCapacity) ? numWritten - RingCapacity : 0;
+
+        for (uint64 i = begin; i < numWritten; ++i) {
+            const ProfileEvent & event = ring->events[i % RingCapacity];
+
+            // Complete events, with times in microseconds.
+            fprintf(file,
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                "\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", event.name, ring->threadId,
+                event.startNanoseconds * 1e-3, event.durationNanoseconds * 1e-3);
+            first = false;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    for (ThreadRing * ring : g_rings) {
+        ring->numWritten.store(0, std::memory_order_release);
+    }
+}
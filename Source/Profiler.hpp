@@ -0,0 +1,82 @@
+//
+//  Profiler.hpp
+//
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "NumericTypes.h"
+
+
+// Records the duration of PROFILE_SCOPE blocks into per thread ring buffers, for export
+// as Chrome trace event JSON (also loaded by Perfetto, ui.perfetto.dev).
+//
+// Recording takes no locks. Each thread writes only to its own ring, which keeps the
+// most recent RingCapacity events. While disabled, a scope costs one relaxed atomic
+// load and a branch.
+class Profiler {
+public:
+    static const uint RingCapacity = 1 << 16;
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Monotonic time since the profiler's epoch.
+    static uint64 nowNanoseconds();
+
+    // name must outlive the profiler, e.g. a string literal.
+    static void recordEvent(const char * name, uint64 startNanoseconds,
+                            uint64 endNanoseconds);
+
+    // Writes events from all threads. Events recorded while writing may be torn, so
+    // disable the profiler first. Returns false if the file cannot be written.
+    static bool writeChromeTrace(const std::string & filePath);
+
+    // Discards all recorded events.
+    static void clear();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+
+// Records the lifetime of the enclosing scope when the profiler is enabled.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char * name)
+        : m_name(nullptr)
+    {
+        if (Profiler::isEnabled()) {
+            m_name = name;
+            m_startNanoseconds = Profiler::nowNanoseconds();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_name) {
+            Profiler::recordEvent(m_name, m_startNanoseconds, Profiler::nowNanoseconds());
+        }
+    }
+
+private:
+    const char * m_name;
+    uint64 m_startNanoseconds;
+
+    // Non-copyable
+    ProfileScope(const ProfileScope &);
+    ProfileScope & operator = (const ProfileScope &);
+};
+
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block. name must be a string literal.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
@@ -0,0 +1,226 @@
+//
+//  ProgramBinaryCache.cpp
+//
+
+#include "ProgramBinaryCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+
+namespace {
+    std::string g_directory;
+
+    uint g_numHits = 0;
+    uint g_numMisses = 0;
+    uint g_numRejected = 0;
+
+    // Start of every cache file, bumped if the layout changes.
+    const char FileMagic[8] = { 'C', 'N', 'P', 'B', 'I', 'N', '0', '1' };
+
+    struct FileHeader {
+        char magic[8];
+        uint64 key;
+        uint32 binaryFormat;
+        uint32 numBytes;
+    };
+
+
+    //-----------------------------------------------------------------------------------
+    std::string cacheFilePath(uint64 key)
+    {
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.bin",
+                 static_cast<unsigned long long>(key));
+
+        return g_directory + "/" + fileName;
+    }
+
+
+    //-----------------------------------------------------------------------------------
+    bool isBinaryFormatSupported(GLenum binaryFormat)
+    {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        if (numFormats <= 0) {
+            return false;
+        }
+
+        std::vector<GLint> formats(numFormats);
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+        return std::find(formats.begin(), formats.end(),
+                         static_cast<GLint>(binaryFormat)) != formats.end();
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void ProgramBinaryCache::setDirectory (
+    const std::string & directory
+) {
+    g_directory = directory;
+    g_numHits = 0;
+    g_numMisses = 0;
+    g_numRejected = 0;
+
+    if (!directory.empty()) {
+        // Fails harmlessly if it already exists. If it cannot be created, stores fail
+        // and every load misses.
+        mkdir(directory.c_str(), 0755);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+bool ProgramBinaryCache::isEnabled()
+{
+    if (g_directory.empty()) {
+        return false;
+    }
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+    return numFormats > 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 ProgramBinaryCache::hash (
+    const void * data,
+    size_t numBytes,
+    uint64 hash
+) {
+    const uint8 * bytes = static_cast<const uint8 *>(data);
+    for (size_t i = 0; i < numBytes; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint64 ProgramBinaryCache::driverHash()
+{
+    uint64 result = hash(nullptr, 0);
+
+    const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : names) {
+        const char * value = reinterpret_cast<const char *>(glGetString(name));
+        if (value) {
+            // Include the terminator, so adjacent strings cannot run together.
+            result = hash(value, strlen(value) + 1, result);
+        }
+    }
+
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool ProgramBinaryCache::load (
+    uint64 key,
+    GLenum & binaryFormat,
+    std::vector<uint8> & binary
+) {
+    FILE * file = fopen(cacheFilePath(key).c_str(), "rb");
+    if (!file) {
+        ++g_numMisses;
+        return false;
+    }
+
+    FileHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0 &&
+                 header.key == key &&
+                 header.numBytes > 0;
+
+    if (valid) {
+        binary.resize(header.numBytes);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    // A format the driver no longer lists would make glProgramBinary raise
+    // GL_INVALID_ENUM, so treat it as a miss.
+    if (!valid || !isBinaryFormatSupported(header.binaryFormat)) {
+        ++g_numMisses;
+        return false;
+    }
+
+    binaryFormat = header.binaryFormat;
+    ++g_numHits;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ProgramBinaryCache::store (
+    uint64 key,
+    GLenum binaryFormat,
+    const std::vector<uint8> & binary
+) {
+    if (binary.empty()) {
+        return;
+    }
+
+    // Write to a temporary file and rename it into place, so a concurrent or
+    // interrupted run never sees a partial binary.
+    const std::string path = cacheFilePath(key);
+    const std::string temporaryPath = path + ".tmp";
+
+    FILE * file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+
+    FileHeader header;
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.numBytes = static_cast<uint32>(binary.size());
+
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                         fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+
+    if (fclose(file) == 0 && written) {
+        rename(temporaryPath.c_str(), path.c_str());
+    } else {
+        remove(temporaryPath.c_str());
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+uint ProgramBinaryCache::numHits()
+{
+    return g_numHits;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint ProgramBinaryCache::numMisses()
+{
+    return g_numMisses;
+}
+
+
+//---------------------------------------------------------------------------------------
+uint ProgramBinaryCache::numRejected()
+{
+    return g_numRejected;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ProgramBinaryCache::countRejected()
+{
+    ++g_numRejected;
+}
@@ -0,0 +1,60 @@
+//
+//  ProgramBinaryCache.hpp
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "NumericTypes.h"
+#include "GLPlatform.h"
+
+
+// On disk cache of linked program binaries from glGetProgramBinary, used by
+// ShaderProgram::link() to skip compiling and linking on later runs.
+//
+// Binaries are keyed by a hash of everything that determines the program: shader
+// sources, transform feedback varyings, and the GL vendor, renderer and version
+// strings, so a driver update misses rather than loading a stale binary. Drivers may
+// still reject a binary, in which case ShaderProgram compiles from source and replaces
+// the cached copy.
+//
+// Disabled until a directory is set, and when the driver supports no binary formats.
+class ProgramBinaryCache {
+public:
+    // Creates directory if it does not exist. An empty path disables the cache.
+    static void setDirectory(const std::string & directory);
+
+    static bool isEnabled();
+
+    // FNV-1a hash of data, continuing from hash.
+    static uint64 hash(const void * data, size_t numBytes, uint64 hash = 14695981039346656037ull);
+
+    // Hash of the current context's vendor, renderer and version strings.
+    static uint64 driverHash();
+
+    // Returns false on a miss, or if the cached binary's format is not one the driver
+    // currently accepts.
+    static bool load (
+        uint64 key,
+        GLenum & binaryFormat,
+        std::vector<uint8> & binary
+    );
+
+    static void store (
+        uint64 key,
+        GLenum binaryFormat,
+        const std::vector<uint8> & binary
+    );
+
+    // Counts since the directory was set. Hits include binaries later rejected.
+    static uint numHits();
+
+    static uint numMisses();
+
+    // Binaries the driver refused in glProgramBinary.
+    static uint numRejected();
+
+    static void countRejected();
+};
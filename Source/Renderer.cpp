@@ -0,0 +1,1823 @@
+//
+//  Renderer.cpp
+//
+
+#include "Renderer.hpp"
+
+#include <vector>
+using std::vector;
+
+#include <algorithm>
+#include <memory>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "ShaderPermutations.hpp"
+#include "ShaderProgram.hpp"
+#include "ParticleSystem.hpp"
+#include "VertexAttributeDefines.h"
+#include "Mesh.hpp"
+#include "UniformBufferRing.hpp"
+#include "Align.hpp"
+#include "GLStateCache.hpp"
+#include "GLExtensions.hpp"
+#include "Profiler.hpp"
+#include "PipelineStatistics.hpp"
+
+
+struct Transforms {
+    glm::mat4 modelMatrix;
+    glm::mat4 viewMatrix;
+    glm::mat4 projectMatrix;
+    glm::mat4 normalMatrix;
+};
+static const GLuint UniformBindingIndex_Transforms = 0;
+
+
+struct LightSource {
+    glm::vec4 position_worldSpace;
+    glm::vec4 rgbIntensity;
+};
+static const GLuint UniformBindingIndex_LightSource = 1;
+
+
+struct Material {
+    glm::vec4 Ka; // Coefficients of ambient reflectivity
+    glm::vec4 Kd; // Coefficients of diffuse reflectivity
+};
+static const GLuint UniformBindingIndex_Matrial = 2;
+
+
+// Maps the cube mesh's quantized positions back to cube space.
+struct CubeMeshUniforms {
+    glm::vec3 positionScale;
+    float padding0;
+    glm::vec3 positionBias;
+    float padding1;
+};
+static const GLuint UniformBindingIndex_CubeMesh = 7;
+
+
+//-- Per frame uniform blocks, written together each frame into m_uniformBufferRing.
+
+// ParticleSimUniforms (ParticleSystem.hpp)
+static const GLuint UniformBindingIndex_ParticleSim = 3;
+
+// Shared by shadow map, variance shadow map and shadow splat programs.
+struct ShadowPassUniforms {
+    glm::mat4 modelMatrix;
+    glm::mat4 lightViewMatrix;
+    glm::mat4 lightProjectMatrix;
+    float cubeRandomness;
+    float pointScale;    // Splat diameter in pixels at clip space w = 1.
+    float depthScale;    // 1 / light far plane, maps linear depth to [0,1].
+    float splatOpacity;  // Peak opacity contributed by a single splatted cube.
+    GLuint orientationSeed;
+    GLuint padding[3];
+};
+static const GLuint UniformBindingIndex_ShadowPass = 4;
+
+
+struct CubeUniforms {
+    float cubeRandomness;
+    GLuint orientationSeed;
+    float impostorThreshold;  // Cubes fewer pixels across are drawn as impostors.
+    float padding0;
+    glm::vec2 viewportSize;
+    float padding1[2];
+};
+static const GLuint UniformBindingIndex_Cube = 5;
+
+
+struct GroundPlaneUniforms {
+    glm::mat4 modelMatrix;
+    glm::mat4 viewProjectMatrix;
+    glm::mat4 shadowMatrix;
+    GLint shadowTechnique;
+    float depthScale;
+    float padding[2];
+};
+static const GLuint UniformBindingIndex_GroundPlane = 6;
+
+// Hashed with gl_InstanceID by InstanceOrientation.glsl to give each cube its axis of
+// rotation.
+static const GLuint CubeOrientationSeed = 0x2545f491;
+
+// Vertices of a CubeGeometry_Procedural cube, generated by ProceduralCube.glsl.
+static const GLsizei NumProceduralCubeVertices = 36;
+
+// Vertices of a CubeGeometry_VisibleFaces cube, three faces of two triangles.
+static const GLsizei NumVisibleFaceCubeVertices = 18;
+
+// Number of frames the CPU may run ahead of the GPU before waiting on a fence.
+static const uint NumFramesInFlight = 3;
+
+
+// Above this many active cubes, shadows are splatted as points into a low resolution
+// light space opacity map rather than rasterizing every cube into the shadow map.
+static const uint ShadowSplatInstanceThreshold = 100000;
+
+// Shadow splat map dimensions relative to the framebuffer.
+static const float ShadowSplatResolutionScale = 0.5f;
+
+// Peak opacity contributed by a single splatted cube.
+static const float ShadowSplatOpacity = 0.35f;
+
+// Variance shadow map dimensions relative to the shadow map, a quarter of the texels.
+static const float VarianceShadowMapResolutionScale = 0.5f;
+
+// Light projection far plane, used to normalize linear depth for variance shadows.
+static const float LightFarPlane = 500.0f;
+
+// Texture units used by the ground plane shader.
+static const GLint TextureUnit_ShadowMap = 0;
+static const GLint TextureUnit_ShadowSplat = 1;
+static const GLint TextureUnit_VarianceShadowMap = 2;
+
+
+
+class RendererImpl {
+private:
+    friend class Renderer;
+    
+//-- Members:
+    
+    AssetDirectory m_assetDirectory;
+    
+    FramebufferSize m_framebufferSize;
+    
+    std::shared_ptr<ParticleSystem> m_particleSystem;
+    
+    // Cube data
+        Mesh m_mesh_cube;
+        ShaderPermutations m_shaderPermutations_cube;
+        ShaderProgram * m_shaderProgram_cube;  // Variant for m_cubeRandomness
+        
+        // Cube orientation based on cube randomness
+        float m_cubeRandomness;
+        
+        CubeGeometry m_cubeGeometry;
+        
+        // Impostors are off while zero.
+        float m_impostorThreshold;
+        ShaderPermutations m_shaderPermutations_impostor;
+        ShaderProgram * m_shaderProgram_impostor;  // Null while impostors are off
+
+        // Uniform Buffer Data
+        GLuint m_ubo;
+        GLuint m_uboBufferSize;
+        Transforms m_sceneTransforms;
+        GLint m_uniformBufferDataOffset_Transforms;
+        
+        LightSource m_lightSource;
+        GLint m_uniformBufferDataOffset_LightSource;
+        
+        Material m_material;
+        GLint m_uniformBufferDataOffset_Material;
+        
+        CubeMeshUniforms m_cubeMeshUniforms;
+        GLint m_uniformBufferDataOffset_CubeMesh;
+    
+    
+    // Per frame uniform data, offsets are relative to the start of each frame's region.
+        UniformBufferRing m_uniformBufferRing;
+        GLintptr m_perFrameOffset_ParticleSim;
+        GLintptr m_perFrameOffset_ShadowPass;
+        GLintptr m_perFrameOffset_Cube;
+        GLintptr m_perFrameOffset_GroundPlane;
+        ShadowPassUniforms m_shadowPassUniforms;
+        GroundPlaneUniforms m_groundPlaneUniforms;
+    
+    
+    
+    // Shadow map
+        GLuint m_texture_shadowMap;
+        FramebufferSize m_shadowMapSize;
+        GLuint m_framebuffer_shadowMap;
+        ShaderPermutations m_shaderPermutations_shadowMap;
+        ShaderProgram * m_shaderProgram_shadowMap;
+        glm::mat4 m_lightViewMatrix;
+        glm::mat4 m_lightProjectMatrix;
+        glm::mat4 m_shadowMatrix;
+    
+    
+    // Shadow splat
+        GLuint m_texture_shadowSplat;
+        FramebufferSize m_shadowSplatSize;
+        GLuint m_framebuffer_shadowSplat;
+        ShaderProgram m_shaderProgram_shadowSplat;
+    
+    
+    // One VAO per ParticleSystem buffer, with particle positions mapped to
+    // ATTRIBUTE_INSTANCE_0. Indexed by ParticleSystem::particlePositionsBufferIndex().
+        GLuint m_vao_cubes[ParticleSystem::NumParticleBuffers];
+        
+        // No vertex buffers besides particle positions and projected sizes, for shadow
+        // splats, procedural cubes and impostors.
+        GLuint m_vao_particlePositions[ParticleSystem::NumParticleBuffers];
+    
+    
+    // Variance shadow map
+        // Index into m_shaderProgram_gaussianBlur's uniform table.
+        int m_uniformIndex_texelStep;
+        
+        bool m_varianceShadowsSupported;
+        GLuint m_texture_varianceShadowMap;  // RG16F depth moments
+        GLuint m_texture_varianceBlur;       // Intermediate for separable blur
+        GLuint m_renderbuffer_varianceDepth;
+        FramebufferSize m_varianceShadowMapSize;
+        GLuint m_framebuffer_varianceShadowMap;
+        GLuint m_framebuffer_varianceBlur;
+        GLuint m_vao_fullscreenTriangle;
+        ShaderPermutations m_shaderPermutations_varianceShadowMap;
+        ShaderProgram * m_shaderProgram_varianceShadowMap;
+        ShaderProgram m_shaderProgram_gaussianBlur;
+    
+    
+    // Technique requested through setShadowTechnique:
+    ShadowTechnique m_shadowTechnique;
+    
+    // Technique used for the current frame, which m_shadowTechnique names unless it
+    // is ShadowTechnique_Automatic.
+    ShadowTechnique m_activeShadowTechnique;
+    
+    
+    // Not owned, may be null.
+    RenderStageListener * m_renderStageListener;
+    
+    GpuTimerQueries m_gpuTimerQueries;
+    PipelineStatisticsQueries m_pipelineStatisticsQueries;
+    
+    
+    // Ground plane
+        Mesh m_mesh_groundPlane;
+        ShaderProgram m_shaderProgram_groundPlane;
+        
+        // Links still in progress when setup first used the programs.
+        uint m_numProgramsLinkingAtFirstUse;
+    
+    
+    
+//-- Methods:
+    RendererImpl (
+        const AssetDirectory & assetDirectory,
+        FramebufferSize framebufferSize,
+        uint numCubes,
+        uint maxCubes,
+        float cubeRandomness
+    );
+    
+    ~RendererImpl();
+    
+    // Submits every program's link without waiting for any of them.
+    void loadShaders();
+    
+    // Defines of the cube and shadow map program variants for m_cubeGeometry.
+    ShaderDefines cubeVariantDefines(bool rotation) const;
+    
+    // Submits the rotated and unrotated variants of each cube program for
+    // m_cubeGeometry and m_impostorThreshold.
+    void linkCubeVariants();
+    
+    // Picks the cube, impostor and shadow map program variants for m_cubeRandomness,
+    // m_cubeGeometry and m_impostorThreshold.
+    void selectShaderVariants();
+    
+    // Binds the uniform blocks of every cube and shadow map variant linked so far.
+    void bindCubeVariantUniformBlocks();
+    
+    // Programs submitted for linking whose link has not finished yet.
+    uint numProgramsLinking() const;
+    
+    void loadGaussianBlurUniforms();
+    
+    void loadCubeVertexData();
+    
+    void loadGroundPlaneVertexData();
+    
+    void loadGroundPlaneUniforms();
+    
+    void initParticleVertexArrays();
+    
+    void initCubeVertexArrays();
+    
+    void loadCubeUniforms();
+    
+    void loadShadowPassUniforms();
+    
+    void setUBOBindings();
+    
+    void setParticlePositionAttribMapping(GLuint particlePositionsVbo);
+    
+    void setProjectedSizeAttribMapping(GLuint particlePositionsVbo);
+    
+    void setDefaultGLState();
+    
+    void initShadowPassResources();
+    
+    void initShadowMapMatrices();
+    
+    void initShadowSplatResources();
+    
+    void initVarianceShadowResources();
+    
+    void update(double secondsSinceLastUpdate);
+    
+    void updatePerFrameUniforms(double secondsSinceLastUpdate);
+    
+    void render(GLuint framebuffer, FramebufferSize framebufferSize);
+    
+    void shadowMapPass();
+    
+    void shadowSplatPass();
+    
+    void varianceShadowMapPass();
+    
+    void blurVarianceShadowMap();
+    
+    void drawCubes();
+    
+    void drawImpostors();
+    
+    void renderCubes();
+    
+    void renderGroundPlane();
+    
+    void beginStage(RenderStage stage);
+    
+    void endStage(RenderStage stage);
+    
+}; // end class RendererImpl
+
+
+//---------------------------------------------------------------------------------------
+RendererImpl::RendererImpl (
+    const AssetDirectory & assetDirectory,
+    FramebufferSize framebufferSize,
+    uint numCubes,
+    uint maxCubes,
+    float cubeRandomness
+)
+    : m_assetDirectory(assetDirectory),
+      m_framebufferSize(framebufferSize),
+      m_cubeRandomness(cubeRandomness),
+      m_cubeGeometry(CubeGeometry_Mesh),
+      m_impostorThreshold(0.0f),
+      m_shaderProgram_impostor(nullptr),
+      m_renderStageListener(nullptr),
+      m_numProgramsLinkingAtFirstUse(0)
+{
+    PROFILE_SCOPE("Renderer::init");
+    
+    // Resource setup binds offscreen framebuffers, so remember the caller's binding.
+    GLint callerFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &callerFramebuffer);
+    
+    // Cube program variants depend on the cube mesh's vertex encoding.
+    loadCubeVertexData();
+    
+    loadShaders();
+    selectShaderVariants();
+    
+    // The ParticleSystem links its program while ours are still being built, when the
+    // driver supports KHR_parallel_shader_compile.
+    const uint numActiveParticles = numCubes;
+    const uint maxParticles = maxCubes;
+    m_particleSystem = std::make_shared<ParticleSystem>(m_assetDirectory,
+                                                        numActiveParticles,
+                                                        maxParticles,
+                                                        cubeRandomness);
+    
+    // Setup that uses no program runs before any status query, so it overlaps the
+    // builds too.
+    setDefaultGLState();
+    
+    initShadowPassResources();
+    
+    initShadowSplatResources();
+    
+    initVarianceShadowResources();
+    
+    initParticleVertexArrays();
+    
+    loadGroundPlaneVertexData();
+    
+    // From here on, using a program waits for its link.
+    m_numProgramsLinkingAtFirstUse = numProgramsLinking();
+    
+    m_particleSystem->setUniformBlockBinding(UniformBindingIndex_ParticleSim);
+    
+    loadGaussianBlurUniforms();
+    
+    setUBOBindings();
+    
+    loadCubeUniforms();
+    
+    initShadowMapMatrices();
+    
+    loadShadowPassUniforms();
+
+    loadGroundPlaneUniforms();
+    
+    // Work submitted before the first render, such as the particle simulation in
+    // update(), needs a complete framebuffer bound. There is no default framebuffer
+    // when rendering headless.
+    GLStateCache::bindFramebuffer(static_cast<GLuint>(callerFramebuffer));
+}
+
+
+//---------------------------------------------------------------------------------------
+RendererImpl::~RendererImpl()
+{
+    glDeleteBuffers(1, &m_ubo);
+    
+    glDeleteVertexArrays(ParticleSystem::NumParticleBuffers, m_vao_cubes);
+    glDeleteVertexArrays(ParticleSystem::NumParticleBuffers, m_vao_particlePositions);
+    glDeleteVertexArrays(1, &m_vao_fullscreenTriangle);
+    
+    glDeleteFramebuffers(1, &m_framebuffer_shadowMap);
+    glDeleteFramebuffers(1, &m_framebuffer_shadowSplat);
+    glDeleteFramebuffers(1, &m_framebuffer_varianceShadowMap);
+    glDeleteFramebuffers(1, &m_framebuffer_varianceBlur);
+    glDeleteRenderbuffers(1, &m_renderbuffer_varianceDepth);
+    
+    glDeleteTextures(1, &m_texture_shadowMap);
+    glDeleteTextures(1, &m_texture_shadowSplat);
+    glDeleteTextures(1, &m_texture_varianceShadowMap);
+    glDeleteTextures(1, &m_texture_varianceBlur);
+    
+    // Names deleted above may be reused by objects created later, so the cache must
+    // not assume they are still bound.
+    GLStateCache::invalidate();
+}
+
+
+//---------------------------------------------------------------------------------------
+Renderer::Renderer (
+    const AssetDirectory & assetDirectory,
+    FramebufferSize framebufferSize,
+    uint numCubes,
+    uint maxCubes,
+    float cubeRandomness
+) {
+    impl = new RendererImpl(assetDirectory, framebufferSize, numCubes, maxCubes,
+                            cubeRandomness);
+}
+
+
+//---------------------------------------------------------------------------------------
+Renderer::~Renderer()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::setDefaultGLState()
+{
+    // Clear values
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClearDepthf(1.0f);
+    
+    // Depth settings
+    GLStateCache::enable(GL_DEPTH_TEST);
+    GLStateCache::depthMask(GL_TRUE);
+    glDepthFunc(GL_LEQUAL);
+    glDepthRangef(0.0f, 1.0f);
+    
+    // Enable backface culling
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+    
+    CHECK_GL_ERRORS;
+}
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadCubeVertexData()
+{
+    PROFILE_SCOPE("Renderer::loadCubeVertexData");
+    
+    // Cube vertex data.
+    std::vector<Mesh::Vertex> vertexData = {
+        // Positions             Normals
+        // Bottom
+        { -0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f}, // 0
+        {  0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f}, // 1
+        {  0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f}, // 2
+        { -0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f}, // 3
+        
+        // Top
+        { -0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f}, // 4
+        {  0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f}, // 5
+        {  0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f}, // 6
+        { -0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f}, // 7
+        
+        // Left
+        { -0.5f, -0.5f,  0.5f,  -1.0f,  0.0f,  0.0f}, // 8
+        { -0.5f, -0.5f, -0.5f,  -1.0f,  0.0f,  0.0f}, // 9
+        { -0.5f,  0.5f,  0.5f,  -1.0f,  0.0f,  0.0f}, // 10
+        { -0.5f,  0.5f, -0.5f,  -1.0f,  0.0f,  0.0f}, // 11
+        
+        // Back
+        { -0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f}, // 12
+        {  0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f}, // 13
+        {  0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f}, // 14
+        { -0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f}, // 15
+        
+        // Right
+        {  0.5f, -0.5f,  0.5f,   1.0f,  0.0f,  0.0f}, // 16
+        {  0.5f, -0.5f, -0.5f,   1.0f,  0.0f,  0.0f}, // 17
+        {  0.5f,  0.5f, -0.5f,   1.0f,  0.0f,  0.0f}, // 18
+        {  0.5f,  0.5f,  0.5f,   1.0f,  0.0f,  0.0f}, // 19
+        
+        // Front
+        { -0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f}, // 20
+        {  0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f}, // 21
+        {  0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f}, // 22
+        { -0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f}, // 23
+    };
+    
+    // Halves the vertex size, and reproduces the cube's positions and axis aligned
+    // normals exactly.
+    m_mesh_cube.uploadVertexData(vertexData, VertexEncoding_Snorm16Octahedral);
+    
+    m_cubeMeshUniforms.positionScale = m_mesh_cube.positionScale();
+    m_cubeMeshUniforms.positionBias = m_mesh_cube.positionBias();
+    
+    
+    std::vector<Mesh::Index> indexData = {
+        // Bottom
+        3,1,0, 3,2,1,
+        // Top
+        7,4,5, 7,5,6,
+        // Left
+        8,10,9, 10,11,9,
+        // Back
+        12,15,13, 15,14,13,
+        // Right
+        16,17,19, 17,18,19,
+        // Front
+        20,21,23, 21,22,23
+    };
+    
+    m_mesh_cube.uploadIndexData(indexData);
+    
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadGroundPlaneVertexData()
+{
+    std::vector<Mesh::Vertex> vertexData = {
+        // Positions             Normals
+        { -0.5f,  0.0f,  0.5f,   0.0f,  1.0f,  0.0f}, // 0
+        {  0.5f,  0.0f,  0.5f,   0.0f,  1.0f,  0.0f}, // 1
+        {  0.5f,  0.0f, -0.5f,   0.0f,  1.0f,  0.0f}, // 2
+        { -0.5f,  0.0f, -0.5f,   0.0f,  1.0f,  0.0f}  // 3
+    };
+    
+    m_mesh_groundPlane.uploadVertexData(vertexData);
+    
+    std::vector<Mesh::Index> indexData = {
+        0,2,3, 0,1,2
+    };
+                                       
+    m_mesh_groundPlane.uploadIndexData(indexData);
+    
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadGroundPlaneUniforms()
+{
+    // Assign texture units
+    {
+        ShaderProgram & program = m_shaderProgram_groundPlane;
+        program.enable();
+        
+        program.setUniform(program.uniformIndex("shadowMap"), TextureUnit_ShadowMap);
+        
+        program.setUniform(program.uniformIndex("shadowSplatMap"), TextureUnit_ShadowSplat);
+        
+        program.setUniform(program.uniformIndex("varianceShadowMap"),
+                           TextureUnit_VarianceShadowMap);
+    }
+    
+    glm::mat4 modelMatrix = glm::scale(glm::mat4(), glm::vec3(200.0f, 1.0f, 200.0f));
+    modelMatrix = glm::translate(glm::mat4(), glm::vec3(0.0f, -9.0f, -50.0f)) * modelMatrix;
+    
+    glm::mat4 viewMatrix = m_sceneTransforms.viewMatrix;
+    glm::mat4 viewProjectMatrix = m_sceneTransforms.projectMatrix * viewMatrix;
+    
+    // Uploaded each frame by updatePerFrameUniforms:
+    m_groundPlaneUniforms.modelMatrix = modelMatrix;
+    m_groundPlaneUniforms.viewProjectMatrix = viewProjectMatrix;
+    m_groundPlaneUniforms.shadowMatrix = m_shadowMatrix;
+    m_groundPlaneUniforms.shadowTechnique = m_activeShadowTechnique;
+    m_groundPlaneUniforms.depthScale = 1.0f / LightFarPlane;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Builds the VAOs used to instance cubes from each ParticleSystem buffer, so no vertex
+// attribute respecification is needed per frame.
+void RendererImpl::initParticleVertexArrays()
+{
+    initCubeVertexArrays();
+    
+    // Particle positions only, no cube geometry.
+    for (uint i(0); i < ParticleSystem::NumParticleBuffers; ++i) {
+        const GLuint particlePositionsVbo = m_particleSystem->particlePositionsVbo(i);
+        
+        glGenVertexArrays(1, &m_vao_particlePositions[i]);
+        GLStateCache::bindVertexArray(m_vao_particlePositions[i]);
+        
+        setParticlePositionAttribMapping(particlePositionsVbo);
+        setProjectedSizeAttribMapping(particlePositionsVbo);
+    }
+    
+    // Unbind vao
+    GLStateCache::bindVertexArray(0);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Pairs cube geometry with particle positions, and is rerun when the cube mesh changes
+// its vertex encoding.
+void RendererImpl::initCubeVertexArrays()
+{
+    for (uint i(0); i < ParticleSystem::NumParticleBuffers; ++i) {
+        const GLuint particlePositionsVbo = m_particleSystem->particlePositionsVbo(i);
+        
+        m_vao_cubes[i] = m_mesh_cube.createVertexArray();
+        GLStateCache::bindVertexArray(m_vao_cubes[i]);
+        
+        setParticlePositionAttribMapping(particlePositionsVbo);
+        setProjectedSizeAttribMapping(particlePositionsVbo);
+    }
+    
+    // Unbind vao
+    GLStateCache::bindVertexArray(0);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::initShadowPassResources()
+{
+    // Create Shadow map texture
+    {
+        glGenTextures(1, &m_texture_shadowMap);
+        
+        GLStateCache::bindTexture2D(m_texture_shadowMap);
+        
+        //FIXME: warning, at program startup framebufferSize is only a fraction of actual size
+        // Should create texture at first run of Renderer::update()
+        m_shadowMapSize.width = 2.0f * m_framebufferSize.width;
+        m_shadowMapSize.height = 2.0f * m_framebufferSize.height;
+        
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, m_shadowMapSize.width,
+                     m_shadowMapSize.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LESS);
+        
+        
+        GLStateCache::bindTexture2D(0);
+        CHECK_GL_ERRORS;
+    }
+    
+    
+    // Create and set up the framebuffer object
+    {
+        glGenFramebuffers(1, &m_framebuffer_shadowMap);
+        GLStateCache::bindFramebuffer(m_framebuffer_shadowMap);
+        
+        GLint level0 = 0;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                               m_texture_shadowMap, level0);
+        
+        CHECK_FRAMEBUFFER_COMPLETENESS;
+        
+        // Prevent rendering to color buffers.
+        GLenum drawBuffers[] = { GL_NONE };
+        glDrawBuffers(1, drawBuffers);
+        
+        // Revert back to default framebuffer.
+        GLStateCache::bindFramebuffer(0);
+        CHECK_GL_ERRORS;
+    }
+    
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::initShadowSplatResources()
+{
+    // Create single channel opacity texture
+    {
+        glGenTextures(1, &m_texture_shadowSplat);
+        
+        GLStateCache::bindTexture2D(m_texture_shadowSplat);
+        
+        m_shadowSplatSize.width = ShadowSplatResolutionScale * m_framebufferSize.width;
+        m_shadowSplatSize.height = ShadowSplatResolutionScale * m_framebufferSize.height;
+        
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_shadowSplatSize.width,
+                     m_shadowSplatSize.height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        
+        GLStateCache::bindTexture2D(0);
+        CHECK_GL_ERRORS;
+    }
+    
+    
+    // Create and set up the framebuffer object
+    {
+        glGenFramebuffers(1, &m_framebuffer_shadowSplat);
+        GLStateCache::bindFramebuffer(m_framebuffer_shadowSplat);
+        
+        GLint level0 = 0;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               m_texture_shadowSplat, level0);
+        
+        CHECK_FRAMEBUFFER_COMPLETENESS;
+        
+        // Revert back to default framebuffer.
+        GLStateCache::bindFramebuffer(0);
+        CHECK_GL_ERRORS;
+    }
+    
+    m_shadowTechnique = ShadowTechnique_Automatic;
+    m_activeShadowTechnique = ShadowTechnique_DepthCompare;
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::initVarianceShadowResources()
+{
+    m_texture_varianceShadowMap = 0;
+    m_texture_varianceBlur = 0;
+    m_renderbuffer_varianceDepth = 0;
+    m_framebuffer_varianceShadowMap = 0;
+    m_framebuffer_varianceBlur = 0;
+    m_vao_fullscreenTriangle = 0;
+    
+    // Rendering to half float textures requires an extension in OpenGL ES 3.0.
+    m_varianceShadowsSupported = isGLExtensionSupported("GL_EXT_color_buffer_half_float") ||
+                                 isGLExtensionSupported("GL_EXT_color_buffer_float");
+    if (!m_varianceShadowsSupported) {
+        return;
+    }
+    
+    m_varianceShadowMapSize.width = VarianceShadowMapResolutionScale * m_shadowMapSize.width;
+    m_varianceShadowMapSize.height = VarianceShadowMapResolutionScale * m_shadowMapSize.height;
+    
+    // Create depth moments texture, and intermediate texture for blurring.
+    {
+        glGenTextures(1, &m_texture_varianceShadowMap);
+        glGenTextures(1, &m_texture_varianceBlur);
+        
+        GLuint textures[] = {m_texture_varianceShadowMap, m_texture_varianceBlur};
+        for (GLuint texture : textures) {
+            GLStateCache::bindTexture2D(texture);
+            
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, m_varianceShadowMapSize.width,
+                         m_varianceShadowMapSize.height, 0, GL_RG, GL_HALF_FLOAT, NULL);
+            
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        
+        GLStateCache::bindTexture2D(0);
+        CHECK_GL_ERRORS;
+    }
+    
+    
+    // Depth buffer for rendering cubes into the moments texture.
+    {
+        glGenRenderbuffers(1, &m_renderbuffer_varianceDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer_varianceDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16,
+                              m_varianceShadowMapSize.width, m_varianceShadowMapSize.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        CHECK_GL_ERRORS;
+    }
+    
+    
+    // Create and set up the framebuffer objects
+    {
+        GLint level0 = 0;
+        
+        glGenFramebuffers(1, &m_framebuffer_varianceShadowMap);
+        GLStateCache::bindFramebuffer(m_framebuffer_varianceShadowMap);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               m_texture_varianceShadowMap, level0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                  m_renderbuffer_varianceDepth);
+        CHECK_FRAMEBUFFER_COMPLETENESS;
+        
+        glGenFramebuffers(1, &m_framebuffer_varianceBlur);
+        GLStateCache::bindFramebuffer(m_framebuffer_varianceBlur);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               m_texture_varianceBlur, level0);
+        CHECK_FRAMEBUFFER_COMPLETENESS;
+        
+        // Revert back to default framebuffer.
+        GLStateCache::bindFramebuffer(0);
+        CHECK_GL_ERRORS;
+    }
+    
+    
+    // Vertices of the blur pass are generated from gl_VertexID.
+    glGenVertexArrays(1, &m_vao_fullscreenTriangle);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::initShadowMapMatrices()
+{
+    glm::vec3 eye = m_lightSource.position_worldSpace;
+    glm::vec3 center = glm::vec3(4.0f, -5.0f, -40.0f);
+    glm::vec3 up(0.0f, 1.0f, 0.0);
+    
+    m_lightViewMatrix = glm::lookAt(eye, center, up);
+    
+    float fovy = 45.0f;
+    float aspect = static_cast<float>(m_framebufferSize.width) / m_framebufferSize.height;
+    m_lightProjectMatrix = glm::perspective(glm::radians(fovy), aspect, 0.1f, LightFarPlane);
+    
+    
+    // For scaling + translating shadow map coordinate
+    glm::mat4 biasMatrix = {
+        glm::vec4(0.5f, 0.0f, 0.0f, 0.0f), // column 0
+        glm::vec4(0.0f, 0.5f, 0.0f, 0.0f), // column 1
+        glm::vec4(0.0f, 0.0f, 0.5f, 0.0f), // column 2
+        glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)  // column 3
+    };
+    
+    m_shadowMatrix = biasMatrix * m_lightProjectMatrix * m_lightViewMatrix;
+}
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadShaders()
+{
+    PROFILE_SCOPE("Renderer::loadShaders");
+    
+    // Create Cube and Shadow Map ShaderPermutations
+    {
+        m_shaderPermutations_cube.setShaders(m_assetDirectory.at("CubeVS.glsl"),
+                                             m_assetDirectory.at("CubeFS.glsl"));
+        m_shaderPermutations_shadowMap.setShaders(m_assetDirectory.at("ShadowMapVS.glsl"),
+                                                  m_assetDirectory.at("ShadowMapFS.glsl"));
+        m_shaderPermutations_varianceShadowMap.setShaders(
+                m_assetDirectory.at("ShadowMapVS.glsl"),
+                m_assetDirectory.at("VarianceShadowMapFS.glsl"));
+        
+        // Linked once impostors are turned on.
+        m_shaderPermutations_impostor.setShaders(m_assetDirectory.at("ImpostorVS.glsl"),
+                                                 m_assetDirectory.at("ImpostorFS.glsl"));
+        
+        linkCubeVariants();
+    }
+    
+    
+    // Create Shadow Splat ShaderProgram
+    {
+        m_shaderProgram_shadowSplat.generateProgramObject();
+        m_shaderProgram_shadowSplat.attachVertexShader(m_assetDirectory.at("ShadowSplatVS.glsl"));
+        m_shaderProgram_shadowSplat.attachFragmentShader(m_assetDirectory.at("ShadowSplatFS.glsl"));
+        m_shaderProgram_shadowSplat.link();
+    }
+    
+    
+    // Create Gaussian Blur ShaderProgram
+    {
+        m_shaderProgram_gaussianBlur.generateProgramObject();
+        m_shaderProgram_gaussianBlur.attachVertexShader(
+                m_assetDirectory.at("FullscreenTriangleVS.glsl"));
+        m_shaderProgram_gaussianBlur.attachFragmentShader(
+                m_assetDirectory.at("GaussianBlurFS.glsl"));
+        m_shaderProgram_gaussianBlur.link();
+    }
+    
+    
+    // Create Ground Plane ShaderProgram
+    {
+        m_shaderProgram_groundPlane.generateProgramObject();
+        m_shaderProgram_groundPlane.attachVertexShader(m_assetDirectory.at("GroundPlaneVS.glsl"));
+        m_shaderProgram_groundPlane.attachFragmentShader(m_assetDirectory.at("GroundPlaneFS.glsl"));
+        m_shaderProgram_groundPlane.link();
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+ShaderDefines RendererImpl::cubeVariantDefines(bool rotation) const
+{
+    ShaderDefines defines;
+    if (!rotation) {
+        defines["NO_ROTATION"] = "1";
+    }
+    if (m_cubeGeometry != CubeGeometry_Mesh) {
+        defines["PROCEDURAL_CUBE"] = "1";
+    }
+    if (m_cubeGeometry == CubeGeometry_VisibleFaces) {
+        defines["VISIBLE_FACES"] = "1";
+    }
+    if (m_cubeGeometry == CubeGeometry_Mesh &&
+        m_mesh_cube.vertexEncoding() == VertexEncoding_Snorm16Octahedral)
+    {
+        defines["OCTAHEDRAL_NORMALS"] = "1";
+    }
+    
+    return defines;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Cube programs rotate each cube by cubeRandomness, and a NO_ROTATION variant drops
+// that math when cubeRandomness is zero. Both are built up front, since the randomness
+// can change any frame.
+void RendererImpl::linkCubeVariants()
+{
+    for (bool rotation : {true, false}) {
+        ShaderDefines defines = cubeVariantDefines(rotation);
+        m_shaderPermutations_shadowMap.variant(defines);
+        m_shaderPermutations_varianceShadowMap.variant(defines);
+        
+        if (m_impostorThreshold > 0.0f) {
+            const ShaderDefines noRotation = { {"NO_ROTATION", "1"} };
+            m_shaderPermutations_impostor.variant(rotation ? ShaderDefines() : noRotation);
+            
+            defines["IMPOSTORS"] = "1";
+        }
+        m_shaderPermutations_cube.variant(defines);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::selectShaderVariants()
+{
+    const bool rotation = (m_cubeRandomness != 0.0f);
+    
+    ShaderDefines defines = cubeVariantDefines(rotation);
+    m_shaderProgram_shadowMap = &m_shaderPermutations_shadowMap.variant(defines);
+    m_shaderProgram_varianceShadowMap =
+        &m_shaderPermutations_varianceShadowMap.variant(defines);
+    
+    m_shaderProgram_impostor = nullptr;
+    if (m_impostorThreshold > 0.0f) {
+        const ShaderDefines noRotation = { {"NO_ROTATION", "1"} };
+        m_shaderProgram_impostor =
+            &m_shaderPermutations_impostor.variant(rotation ? ShaderDefines() : noRotation);
+        
+        defines["IMPOSTORS"] = "1";
+    }
+    m_shaderProgram_cube = &m_shaderPermutations_cube.variant(defines);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadGaussianBlurUniforms()
+{
+    ShaderProgram & program = m_shaderProgram_gaussianBlur;
+    m_uniformIndex_texelStep = program.uniformIndex("texelStep");
+    
+    program.enable();
+    const GLint textureUnit0(0);
+    program.setUniform(program.uniformIndex("sourceTexture"), textureUnit0);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadCubeUniforms()
+{
+    float fovy = 45.0f;
+    float aspect = static_cast<float>(m_framebufferSize.width) / m_framebufferSize.height;
+    glm::mat4 projectionMatrix = glm::perspective(glm::radians(fovy), aspect, 1.0f, 400.0f);
+    
+    
+    glm::vec3 cameraLocation = {0.0f, 0.0f, 10.0f};
+    glm::mat4 viewMatrix = glm::lookAt (
+        cameraLocation,               // eye
+        glm::vec3{0.0f, 0.0f, -50.0f}, // center
+        glm::vec3{0.0f, 1.0f, 0.0f}   // up
+    );
+    
+    float angle = M_PI * 0.25f;
+    glm::mat4 rotMatrix = glm::rotate(glm::mat4(), angle, glm::vec3(1.0f, 1.0f, 1.0f));
+    glm::mat4 modelMatrix = rotMatrix;
+    
+    m_sceneTransforms.modelMatrix = modelMatrix;
+    m_sceneTransforms.viewMatrix = viewMatrix;
+    m_sceneTransforms.projectMatrix = projectionMatrix;
+    
+    // modelViewMatrix scale is uniform, so inverse == transpose
+    m_sceneTransforms.normalMatrix = modelMatrix;
+    
+    // Particle sizes in pixels are measured during simulation, for picking impostors.
+    const float pixelScale = projectionMatrix[1][1] * 0.5f * m_framebufferSize.height;
+    m_particleSystem->setCamera(projectionMatrix * viewMatrix, pixelScale);
+    
+    
+    // Convert lightSource position to EyeSpace.
+    m_lightSource.position_worldSpace = glm::vec4(-6.0f, 16.0f, 25.0f, 1.0f);
+    m_lightSource.rgbIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    
+    
+    m_material.Ka = glm::vec4(1.0f);
+    m_material.Kd = glm::vec4(0.2f, 0.4f, 8.0f, 0.0f);
+    
+    //-- Copy uniform block data to uniform buffer
+    {
+        GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+        GLvoid * pUniformBuffer = glMapBufferRange(GL_UNIFORM_BUFFER, 0, m_uboBufferSize,
+                                                   GL_MAP_WRITE_BIT);
+        
+        // Copy Transform data to uniform buffer.
+        memcpy((char *)pUniformBuffer + m_uniformBufferDataOffset_Transforms,
+               &m_sceneTransforms, sizeof(m_sceneTransforms));
+        
+        // Copy LightSource data to uniform buffer.
+        memcpy((char *)pUniformBuffer + m_uniformBufferDataOffset_LightSource,
+               &m_lightSource, sizeof(m_lightSource));
+        
+        // Copy Material data to uniform buffer.
+        memcpy((char *)pUniformBuffer + m_uniformBufferDataOffset_Material,
+               &m_material, sizeof(m_material));
+        
+        // Copy CubeMesh data to uniform buffer.
+        memcpy((char *)pUniformBuffer + m_uniformBufferDataOffset_CubeMesh,
+               &m_cubeMeshUniforms, sizeof(m_cubeMeshUniforms));
+        
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, 0);
+        PipelineCounters::countBytesUploaded(m_uboBufferSize);
+        CHECK_GL_ERRORS;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::loadShadowPassUniforms()
+{
+    // Splat diameter in pixels for a unit cube at clip space w = 1. ShadowSplatVS
+    // divides by twice the light space depth, giving the half scale cubes drawn.
+    const float cubeWidth = 1.0f;
+    const float pointScale = cubeWidth * m_lightProjectMatrix[1][1] *
+                             0.5f * m_shadowSplatSize.height;
+    
+    // Uploaded each frame by updatePerFrameUniforms:
+    m_shadowPassUniforms.modelMatrix = m_sceneTransforms.modelMatrix;
+    m_shadowPassUniforms.lightViewMatrix = m_lightViewMatrix;
+    m_shadowPassUniforms.lightProjectMatrix = m_lightProjectMatrix;
+    m_shadowPassUniforms.cubeRandomness = m_cubeRandomness;
+    m_shadowPassUniforms.pointScale = pointScale;
+    m_shadowPassUniforms.depthScale = 1.0f / LightFarPlane;
+    m_shadowPassUniforms.splatOpacity = ShadowSplatOpacity;
+    m_shadowPassUniforms.orientationSeed = CubeOrientationSeed;
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::bindCubeVariantUniformBlocks()
+{
+    // Blocks a variant compiles out, e.g. Cube without rotation, are skipped.
+    std::vector<ShaderProgram *> cubePrograms = m_shaderPermutations_cube.variants();
+    for (ShaderProgram * program : m_shaderPermutations_impostor.variants()) {
+        cubePrograms.push_back(program);
+    }
+    
+    for (ShaderProgram * program : cubePrograms) {
+        program->setUniformBlockBinding("Transforms", UniformBindingIndex_Transforms);
+        program->setUniformBlockBinding("LightSource", UniformBindingIndex_LightSource);
+        program->setUniformBlockBinding("Material", UniformBindingIndex_Matrial);
+        program->setUniformBlockBinding("Cube", UniformBindingIndex_Cube);
+        program->setUniformBlockBinding("CubeMesh", UniformBindingIndex_CubeMesh);
+    }
+    
+    for (ShaderProgram * program : m_shaderPermutations_shadowMap.variants()) {
+        program->setUniformBlockBinding("ShadowPass", UniformBindingIndex_ShadowPass);
+        program->setUniformBlockBinding("CubeMesh", UniformBindingIndex_CubeMesh);
+    }
+    
+    for (ShaderProgram * program : m_shaderPermutations_varianceShadowMap.variants()) {
+        program->setUniformBlockBinding("ShadowPass", UniformBindingIndex_ShadowPass);
+        program->setUniformBlockBinding("CubeMesh", UniformBindingIndex_CubeMesh);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+uint RendererImpl::numProgramsLinking() const
+{
+    std::vector<ShaderProgram *> programs = m_shaderPermutations_cube.variants();
+    for (const ShaderPermutations * permutations : { &m_shaderPermutations_impostor,
+                                                     &m_shaderPermutations_shadowMap,
+                                                     &m_shaderPermutations_varianceShadowMap })
+    {
+        const std::vector<ShaderProgram *> variants = permutations->variants();
+        programs.insert(programs.end(), variants.begin(), variants.end());
+    }
+    
+    uint numLinking = 0;
+    for (const ShaderProgram * program : programs) {
+        numLinking += program->isLinkComplete() ? 0 : 1;
+    }
+    for (const ShaderProgram * program : { &m_shaderProgram_shadowSplat,
+                                           &m_shaderProgram_gaussianBlur,
+                                           &m_shaderProgram_groundPlane })
+    {
+        numLinking += program->isLinkComplete() ? 0 : 1;
+    }
+    
+    return numLinking;
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::setUBOBindings()
+{
+    // Bind shader blocks to uniform buffer binding indices
+    bindCubeVariantUniformBlocks();
+    
+    GLint uniformBufferOffsetAlignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferOffsetAlignment);
+    
+    const GLint sizeofTransforms = sizeof(Transforms);
+    const GLint sizeofLightSource = sizeof(LightSource);
+    const GLint sizeofMaterial = sizeof(Material);
+    const GLint sizeofCubeMesh = sizeof(CubeMeshUniforms);
+    
+    // Create Uniform Buffer
+    glGenBuffers(1, &m_ubo);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    // UBO size much account for buffer offset alignment restriction
+    m_uboBufferSize =  align(sizeofTransforms, uniformBufferOffsetAlignment) +
+                      align(sizeofLightSource, uniformBufferOffsetAlignment) +
+                      align(sizeofMaterial, uniformBufferOffsetAlignment) +
+                      sizeofCubeMesh;
+    glBufferData(GL_UNIFORM_BUFFER, m_uboBufferSize, nullptr, GL_DYNAMIC_DRAW);
+    
+    // Map range of uniform buffer to each buffer binding index
+    {
+        GLint offSet = 0;
+        m_uniformBufferDataOffset_Transforms = offSet;
+        GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER,
+                                      UniformBindingIndex_Transforms,
+                                      m_ubo,
+                                      m_uniformBufferDataOffset_Transforms,
+                                      sizeof(Transforms));
+        
+        offSet += sizeofTransforms;
+        offSet = align(offSet, uniformBufferOffsetAlignment);
+        m_uniformBufferDataOffset_LightSource = offSet;
+        GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER,
+                                      UniformBindingIndex_LightSource,
+                                      m_ubo,
+                                      m_uniformBufferDataOffset_LightSource,
+                                      sizeof(LightSource));
+        
+        offSet += sizeofLightSource;
+        offSet = align(offSet, uniformBufferOffsetAlignment);
+        m_uniformBufferDataOffset_Material = offSet;
+        GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER,
+                                      UniformBindingIndex_Matrial,
+                                      m_ubo,
+                                      m_uniformBufferDataOffset_Material,
+                                      sizeofMaterial);
+        
+        offSet += sizeofMaterial;
+        offSet = align(offSet, uniformBufferOffsetAlignment);
+        m_uniformBufferDataOffset_CubeMesh = offSet;
+        GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER,
+                                      UniformBindingIndex_CubeMesh,
+                                      m_ubo,
+                                      m_uniformBufferDataOffset_CubeMesh,
+                                      sizeofCubeMesh);
+    }
+    
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECK_GL_ERRORS;
+    
+    
+    // Per frame uniform blocks
+    {
+        struct ProgramBlockBinding {
+            ShaderProgram * program;
+            const char * blockName;
+            GLuint bindingIndex;
+        };
+        const ProgramBlockBinding programBlockBindings[] = {
+            {&m_shaderProgram_shadowSplat, "ShadowPass", UniformBindingIndex_ShadowPass},
+            {&m_shaderProgram_groundPlane, "GroundPlane", UniformBindingIndex_GroundPlane}
+        };
+        for (const ProgramBlockBinding & binding : programBlockBindings) {
+            binding.program->setUniformBlockBinding(binding.blockName, binding.bindingIndex);
+        }
+        
+        // Lay out blocks within each frame's region of the ring.
+        GLintptr offSet = 0;
+        m_perFrameOffset_ParticleSim = offSet;
+        
+        offSet += sizeof(ParticleSimUniforms);
+        offSet = align(offSet, static_cast<GLintptr>(uniformBufferOffsetAlignment));
+        m_perFrameOffset_ShadowPass = offSet;
+        
+        offSet += sizeof(ShadowPassUniforms);
+        offSet = align(offSet, static_cast<GLintptr>(uniformBufferOffsetAlignment));
+        m_perFrameOffset_Cube = offSet;
+        
+        offSet += sizeof(CubeUniforms);
+        offSet = align(offSet, static_cast<GLintptr>(uniformBufferOffsetAlignment));
+        m_perFrameOffset_GroundPlane = offSet;
+        
+        offSet += sizeof(GroundPlaneUniforms);
+        
+        m_uniformBufferRing.allocate(offSet, NumFramesInFlight);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Writes all per frame uniform blocks with a single mapping of the uniform buffer ring.
+void RendererImpl::updatePerFrameUniforms(double secondsSinceLastUpdate)
+{
+    // In automatic mode, switch between exact and splatted shadows based on instance
+    // count. Explicitly chosen techniques are used as is.
+    ShadowTechnique shadowTechnique = m_shadowTechnique;
+    if (shadowTechnique == ShadowTechnique_Automatic) {
+        const bool manyInstances =
+            m_particleSystem->numActiveParticles() >= ShadowSplatInstanceThreshold;
+        shadowTechnique = manyInstances ? ShadowTechnique_Splat
+                                        : ShadowTechnique_DepthCompare;
+    }
+    m_activeShadowTechnique = shadowTechnique;
+    
+    ParticleSimUniforms particleSimUniforms;
+    m_particleSystem->updateUniformData(secondsSinceLastUpdate, particleSimUniforms);
+    
+    m_shadowPassUniforms.cubeRandomness = m_cubeRandomness;
+    
+    CubeUniforms cubeUniforms;
+    cubeUniforms.cubeRandomness = m_cubeRandomness;
+    cubeUniforms.orientationSeed = CubeOrientationSeed;
+    cubeUniforms.impostorThreshold = m_impostorThreshold;
+    cubeUniforms.viewportSize = glm::vec2(m_framebufferSize.width, m_framebufferSize.height);
+    
+    m_groundPlaneUniforms.shadowTechnique = m_activeShadowTechnique;
+    
+    //-- Copy uniform block data to this frame's region of the uniform buffer ring
+    {
+        char * pFrameData = static_cast<char *>(m_uniformBufferRing.mapNextFrame());
+        
+        memcpy(pFrameData + m_perFrameOffset_ParticleSim,
+               &particleSimUniforms, sizeof(particleSimUniforms));
+        
+        memcpy(pFrameData + m_perFrameOffset_ShadowPass,
+               &m_shadowPassUniforms, sizeof(m_shadowPassUniforms));
+        
+        memcpy(pFrameData + m_perFrameOffset_Cube,
+               &cubeUniforms, sizeof(cubeUniforms));
+        
+        memcpy(pFrameData + m_perFrameOffset_GroundPlane,
+               &m_groundPlaneUniforms, sizeof(m_groundPlaneUniforms));
+        
+        m_uniformBufferRing.unmap();
+    }
+    
+    // Map block ranges of this frame's region to uniform buffer binding indices
+    {
+        m_uniformBufferRing.bindRange(UniformBindingIndex_ParticleSim,
+                                     m_perFrameOffset_ParticleSim,
+                                     sizeof(ParticleSimUniforms));
+        
+        m_uniformBufferRing.bindRange(UniformBindingIndex_ShadowPass,
+                                     m_perFrameOffset_ShadowPass,
+                                     sizeof(ShadowPassUniforms));
+        
+        m_uniformBufferRing.bindRange(UniformBindingIndex_Cube,
+                                     m_perFrameOffset_Cube,
+                                     sizeof(CubeUniforms));
+        
+        m_uniformBufferRing.bindRange(UniformBindingIndex_GroundPlane,
+                                     m_perFrameOffset_GroundPlane,
+                                     sizeof(GroundPlaneUniforms));
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Maps particle positions to ATTRIBUTE_INSTANCE_0 of the bound VAO.
+void RendererImpl::setParticlePositionAttribMapping(GLuint particlePositionsVbo)
+{
+    glEnableVertexAttribArray(ATTRIBUTE_INSTANCE_0);
+    
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, particlePositionsVbo);
+    
+    
+    VertexAttributeDescriptor descriptor =
+        m_particleSystem->getVertexDescriptorForParticlePositions();
+    
+    glVertexAttribPointer(ATTRIBUTE_INSTANCE_0, descriptor.numComponents, descriptor.type,
+                          GL_FALSE, descriptor.stride, descriptor.offset);
+    
+    // Advance attribute once per instance.
+    glVertexAttribDivisor(ATTRIBUTE_INSTANCE_0, 1);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Maps each particle's projected size to ATTRIBUTE_INSTANCE_1 of the bound VAO.
+void RendererImpl::setProjectedSizeAttribMapping(GLuint particlePositionsVbo)
+{
+    glEnableVertexAttribArray(ATTRIBUTE_INSTANCE_1);
+    
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, particlePositionsVbo);
+    
+    VertexAttributeDescriptor descriptor =
+        m_particleSystem->getVertexDescriptorForProjectedSizes();
+    
+    glVertexAttribPointer(ATTRIBUTE_INSTANCE_1, descriptor.numComponents, descriptor.type,
+                          GL_FALSE, descriptor.stride, descriptor.offset);
+    glVertexAttribDivisor(ATTRIBUTE_INSTANCE_1, 1);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::update (
+    double secondsSinceLastUpdate
+) {
+    impl->update(secondsSinceLastUpdate);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::update(double secondsSinceLastUpdate)
+{
+    PROFILE_SCOPE("Renderer::update");
+    
+    beginGLErrorCheckFrame();
+    m_gpuTimerQueries.beginFrame();
+    m_pipelineStatisticsQueries.beginFrame();
+    
+    updatePerFrameUniforms(secondsSinceLastUpdate);
+    
+    beginStage(RenderStage_ParticleUpdate);
+    m_particleSystem->update();
+    endStage(RenderStage_ParticleUpdate);
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::render (
+    GLuint framebuffer,
+    FramebufferSize framebufferSize
+) {
+    impl->render(framebuffer, framebufferSize);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::render(GLuint framebuffer, FramebufferSize framebufferSize)
+{
+    PROFILE_SCOPE("Renderer::render");
+    
+    beginStage(RenderStage_ShadowPass);
+    switch (m_activeShadowTechnique) {
+        case ShadowTechnique_DepthCompare:
+            shadowMapPass();
+            break;
+            
+        case ShadowTechnique_Variance:
+            varianceShadowMapPass();
+            blurVarianceShadowMap();
+            break;
+            
+        case ShadowTechnique_Splat:
+            shadowSplatPass();
+            break;
+            
+        case ShadowTechnique_Automatic:
+            // Resolved by updatePerFrameUniforms.
+            break;
+    }
+    endStage(RenderStage_ShadowPass);
+    
+    beginStage(RenderStage_Cubes);
+    m_framebufferSize = framebufferSize;
+    GLStateCache::bindFramebuffer(framebuffer);
+    GLStateCache::viewport(0, 0, m_framebufferSize.width, m_framebufferSize.height);
+    
+    // Clear framebuffer
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    renderCubes();
+    endStage(RenderStage_Cubes);
+    
+    beginStage(RenderStage_GroundPlane);
+    renderGroundPlane();
+    endStage(RenderStage_GroundPlane);
+    
+    // This frame's region of the uniform buffer ring, and the particle buffer read
+    // this frame, may be rewritten once the GPU passes this point.
+    m_uniformBufferRing.fenceCurrentFrame();
+    m_particleSystem->fenceParticlePositionReads();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::shadowMapPass()
+{
+    glPushGroupMarkerEXT(0, "Shadow Pass");
+    
+    GLStateCache::bindFramebuffer(m_framebuffer_shadowMap);
+    
+    GLStateCache::viewport(0, 0, m_shadowMapSize.width, m_shadowMapSize.height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    
+    // Back faces are drawn, except by the visible faces variant which only emits the
+    // faces toward the light. Either covers the same silhouette, and only the ground
+    // plane samples the shadow map.
+    const bool visibleFaces = (m_cubeGeometry == CubeGeometry_VisibleFaces);
+    GLStateCache::cullFace(visibleFaces ? GL_BACK : GL_FRONT);
+    
+    m_shaderProgram_shadowMap->enable();
+    drawCubes();
+    
+    
+    // Restore default settings.
+    GLStateCache::cullFace(GL_BACK);
+    GLStateCache::bindFramebuffer(0);
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::shadowSplatPass()
+{
+    glPushGroupMarkerEXT(0, "Shadow Splat Pass");
+    
+    GLStateCache::bindFramebuffer(m_framebuffer_shadowSplat);
+    
+    GLStateCache::viewport(0, 0, m_shadowSplatSize.width, m_shadowSplatSize.height);
+    const GLfloat zeroOpacity[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, zeroOpacity);
+    
+    // Accumulate opacity as 1 - (1 - a0)(1 - a1)...(1 - an)
+    GLStateCache::disable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_BLEND);
+    GLStateCache::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+    
+    m_shaderProgram_shadowSplat.enable();
+    const uint particleBuffer = m_particleSystem->particlePositionsBufferIndex();
+    GLStateCache::bindVertexArray(m_vao_particlePositions[particleBuffer]);
+    
+    // Particle positions advance once per instance, so draw a single point per instance.
+    const GLuint numInstances = m_particleSystem->numActiveParticles();
+    glDrawArraysInstanced(GL_POINTS, 0, 1, numInstances);
+    PipelineCounters::countDrawCall();
+    
+    
+    // Restore default settings.
+    GLStateCache::disable(GL_BLEND);
+    GLStateCache::enable(GL_DEPTH_TEST);
+    GLStateCache::bindFramebuffer(0);
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::varianceShadowMapPass()
+{
+    glPushGroupMarkerEXT(0, "Variance Shadow Pass");
+    
+    GLStateCache::bindFramebuffer(m_framebuffer_varianceShadowMap);
+    
+    GLStateCache::viewport(0, 0, m_varianceShadowMapSize.width, m_varianceShadowMapSize.height);
+    
+    // Clear moments to the far plane.
+    const GLfloat farMoments[] = {1.0f, 1.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, farMoments);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    
+    m_shaderProgram_varianceShadowMap->enable();
+    drawCubes();
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::blurVarianceShadowMap()
+{
+    glPushGroupMarkerEXT(0, "Variance Shadow Blur");
+    
+    GLStateCache::disable(GL_DEPTH_TEST);
+    
+    m_shaderProgram_gaussianBlur.enable();
+    GLStateCache::bindVertexArray(m_vao_fullscreenTriangle);
+    GLStateCache::activeTexture(GL_TEXTURE0);
+    
+    // Horizontal pass, moments -> blur texture
+    GLStateCache::bindFramebuffer(m_framebuffer_varianceBlur);
+    GLStateCache::bindTexture2D(m_texture_varianceShadowMap);
+    m_shaderProgram_gaussianBlur.setUniform(m_uniformIndex_texelStep,
+                                            1.0f / m_varianceShadowMapSize.width, 0.0f);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    PipelineCounters::countDrawCall();
+    
+    // Vertical pass, blur texture -> moments
+    GLStateCache::bindFramebuffer(m_framebuffer_varianceShadowMap);
+    GLStateCache::bindTexture2D(m_texture_varianceBlur);
+    m_shaderProgram_gaussianBlur.setUniform(m_uniformIndex_texelStep,
+                                            0.0f, 1.0f / m_varianceShadowMapSize.height);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    PipelineCounters::countDrawCall();
+    
+    
+    // Restore default settings.
+    GLStateCache::bindTexture2D(0);
+    GLStateCache::enable(GL_DEPTH_TEST);
+    GLStateCache::bindFramebuffer(0);
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+// Draws a cube per active particle with the enabled program, whose variant must match
+// m_cubeGeometry.
+void RendererImpl::drawCubes()
+{
+    const uint particleBuffer = m_particleSystem->particlePositionsBufferIndex();
+    const GLuint numInstances = m_particleSystem->numActiveParticles();
+    
+    const VertexAttributeDescriptor particlePositions =
+        m_particleSystem->getVertexDescriptorForParticlePositions();
+    uint64 bytesPerInstance = particlePositions.numComponents * sizeof(GLfloat);
+    if (m_shaderProgram_impostor) {
+        bytesPerInstance += sizeof(GLfloat);  // Projected size
+    }
+    
+    if (m_cubeGeometry != CubeGeometry_Mesh) {
+        const GLsizei numVertices = (m_cubeGeometry == CubeGeometry_VisibleFaces) ?
+            NumVisibleFaceCubeVertices : NumProceduralCubeVertices;
+        
+        GLStateCache::bindVertexArray(m_vao_particlePositions[particleBuffer]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, numVertices, numInstances);
+        
+        PipelineCounters::countVertexFetchBytes(numInstances * bytesPerInstance);
+    } else {
+        GLStateCache::bindVertexArray(m_vao_cubes[particleBuffer]);
+        glDrawElementsInstanced(GL_TRIANGLES, m_mesh_cube.numIndices(),
+                                m_mesh_cube.indexType(), nullptr, numInstances);
+        
+        const uint64 indexSize = (m_mesh_cube.indexType() == GL_UNSIGNED_INT) ?
+            sizeof(GLuint) : sizeof(GLushort);
+        const uint64 bytesPerCube = m_mesh_cube.numIndices() *
+            (m_mesh_cube.vertexFormat().stride + indexSize);
+        PipelineCounters::countVertexFetchBytes(numInstances *
+                                                (bytesPerCube + bytesPerInstance));
+    }
+    PipelineCounters::countDrawCall();
+}
+
+
+//---------------------------------------------------------------------------------------
+// Draws a point sprite per active particle with the enabled impostor program, which
+// skips those drawn as cubes.
+void RendererImpl::drawImpostors()
+{
+    const uint particleBuffer = m_particleSystem->particlePositionsBufferIndex();
+    const GLuint numInstances = m_particleSystem->numActiveParticles();
+    
+    GLStateCache::bindVertexArray(m_vao_particlePositions[particleBuffer]);
+    glDrawArraysInstanced(GL_POINTS, 0, 1, numInstances);
+    PipelineCounters::countDrawCall();
+    
+    // Particle position and projected size.
+    const VertexAttributeDescriptor particlePositions =
+        m_particleSystem->getVertexDescriptorForParticlePositions();
+    PipelineCounters::countVertexFetchBytes(
+        numInstances * (particlePositions.numComponents + 1) * sizeof(GLfloat));
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::renderCubes()
+{
+    glPushGroupMarkerEXT(0, "Render Cubes");
+    
+    m_shaderProgram_cube->enable();
+    drawCubes();
+    
+    if (m_shaderProgram_impostor) {
+        m_shaderProgram_impostor->enable();
+        drawImpostors();
+    }
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::renderGroundPlane()
+{
+    glPushGroupMarkerEXT(0, "Render Ground Plane");
+    
+    GLStateCache::bindTexture2D(TextureUnit_ShadowMap, m_texture_shadowMap);
+    GLStateCache::bindTexture2D(TextureUnit_ShadowSplat, m_texture_shadowSplat);
+    GLStateCache::bindTexture2D(TextureUnit_VarianceShadowMap, m_texture_varianceShadowMap);
+    
+    m_shaderProgram_groundPlane.enable();
+    GLStateCache::bindVertexArray(m_mesh_groundPlane.vao());
+    
+    glDrawElements(GL_TRIANGLES, m_mesh_groundPlane.numIndices(), GL_UNSIGNED_SHORT, nullptr);
+    PipelineCounters::countDrawCall();
+    
+    CHECK_GL_ERRORS;
+    glPopGroupMarkerEXT();
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::beginStage(RenderStage stage)
+{
+    if (m_renderStageListener) {
+        m_renderStageListener->beginStage(stage);
+    }
+    
+    m_gpuTimerQueries.beginStage(stage);
+    m_pipelineStatisticsQueries.beginStage(stage);
+}
+
+
+//---------------------------------------------------------------------------------------
+void RendererImpl::endStage(RenderStage stage)
+{
+    m_pipelineStatisticsQueries.endStage(stage);
+    m_gpuTimerQueries.endStage(stage);
+    
+    if (m_renderStageListener) {
+        m_renderStageListener->endStage(stage);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setNumCubes (
+    uint numCubes
+) {
+    impl->m_particleSystem->setNumActiveParticles(numCubes);
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setCubeRandomness (
+    float cubeRandomness
+) {
+    impl->m_cubeRandomness = cubeRandomness;
+    impl->selectShaderVariants();
+    
+    // Update particle system randomness as well.
+    impl->m_particleSystem->setParticleRandomness(cubeRandomness);
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setCubeGeometry (
+    CubeGeometry cubeGeometry
+) {
+    impl->m_cubeGeometry = cubeGeometry;
+    
+    // Variants already linked are found rather than rebuilt.
+    impl->linkCubeVariants();
+    impl->bindCubeVariantUniformBlocks();
+    impl->selectShaderVariants();
+}
+
+
+//---------------------------------------------------------------------------------------
+bool Renderer::loadCubeMesh (
+    const std::string & filePath
+) {
+    if (!impl->m_mesh_cube.load(filePath)) {
+        return false;
+    }
+    
+    impl->m_cubeMeshUniforms.positionScale = impl->m_mesh_cube.positionScale();
+    impl->m_cubeMeshUniforms.positionBias = impl->m_mesh_cube.positionBias();
+    impl->loadCubeUniforms();
+    
+    glDeleteVertexArrays(ParticleSystem::NumParticleBuffers, impl->m_vao_cubes);
+    impl->initCubeVertexArrays();
+    
+    // The variants decode normals for the new vertex encoding.
+    impl->linkCubeVariants();
+    impl->bindCubeVariantUniformBlocks();
+    impl->selectShaderVariants();
+    
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setImpostorThreshold (
+    float pixels
+) {
+    // ImpostorVS pads each sprite by 2 pixels.
+    GLfloat pointSizeRange[2];
+    glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, pointSizeRange);
+    impl->m_impostorThreshold = std::max(0.0f, std::min(pixels, pointSizeRange[1] - 2.0f));
+    
+    impl->linkCubeVariants();
+    impl->bindCubeVariantUniformBlocks();
+    impl->selectShaderVariants();
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setShadowTechnique (
+    ShadowTechnique shadowTechnique
+) {
+    if (shadowTechnique == ShadowTechnique_Variance && !impl->m_varianceShadowsSupported) {
+        shadowTechnique = ShadowTechnique_DepthCompare;
+    }
+    
+    impl->m_shadowTechnique = shadowTechnique;
+}
+
+
+//---------------------------------------------------------------------------------------
+ShadowTechnique Renderer::activeShadowTechnique() const
+{
+    return impl->m_activeShadowTechnique;
+}
+
+
+//---------------------------------------------------------------------------------------
+void Renderer::setRenderStageListener (
+    RenderStageListener * listener
+) {
+    impl->m_renderStageListener = listener;
+}
+
+
+//---------------------------------------------------------------------------------------
+bool Renderer::latestGpuStageTimes (
+    GpuStageTimes & stageTimes
+) const {
+    return impl->m_gpuTimerQueries.latestStageTimes(stageTimes);
+}
+
+
+//---------------------------------------------------------------------------------------
+bool Renderer::latestPipelineStatistics (
+    PipelineStatistics & statistics
+) const {
+    return impl->m_pipelineStatisticsQueries.latestStatistics(statistics);
+}
+
+
+//---------------------------------------------------------------------------------------
+uint Renderer::numProgramsLinkingAtSetup() const
+{
+    return impl->m_numProgramsLinkingAtFirstUse;
+}
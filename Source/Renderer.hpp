@@ -0,0 +1,122 @@
+//
+//  Renderer.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+#include "GLPlatform.h"
+#include "RendererTypes.h"
+#include "AssetDirectory.hpp"
+#include "GpuTimerQueries.hpp"
+#include "PipelineStatistics.hpp"
+#include <string>
+
+
+// Forward declaration
+class RendererImpl;
+
+
+// Notified around each RenderStage as it is issued, e.g. to time stages in isolation.
+class RenderStageListener {
+public:
+    virtual ~RenderStageListener() { }
+    
+    virtual void beginStage(RenderStage stage) = 0;
+    
+    virtual void endStage(RenderStage stage) = 0;
+};
+
+
+// Simulates and renders the tornado of cubes with the current GL context, independent
+// of the windowing system that created it.
+class Renderer {
+public:
+    // framebufferSize is used to size shadow resources and the camera aspect ratio.
+    Renderer (
+        const AssetDirectory & assetDirectory,
+        FramebufferSize framebufferSize,
+        uint numCubes,
+        uint maxCubes,
+        float cubeRandomness
+    );
+    
+    ~Renderer();
+    
+    // Call once per frame, before Renderer::render().
+    void update (
+        double secondsSinceLastUpdate
+    );
+    
+    // Call once per frame, after Renderer::update().
+    // Renders the scene into framebuffer, with a viewport covering framebufferSize.
+    void render (
+        GLuint framebuffer,
+        FramebufferSize framebufferSize
+    );
+    
+    void setNumCubes (
+        uint numCubes
+    );
+    
+    void setCubeRandomness (
+        float cubeRandomness
+    );
+    
+    // Links the programs for a geometry on its first use.
+    void setCubeGeometry (
+        CubeGeometry cubeGeometry
+    );
+    
+    // Replaces the cube with a mesh written by Tools/ImportMesh, drawn per particle in
+    // place of the cube by CubeGeometry_Mesh. The procedural geometries and impostors
+    // still draw cubes. Returns false, keeping the current mesh, if the file is not a
+    // valid mesh file.
+    bool loadCubeMesh (
+        const std::string & filePath
+    );
+    
+    // Cubes whose bounding sphere is fewer than pixels across on screen, as measured
+    // by the particle simulation, are drawn as ray cast point sprite impostors rather
+    // than as geometry. Zero, the default, turns impostors off. Clamped to the largest
+    // supported point size.
+    void setImpostorThreshold (
+        float pixels
+    );
+    
+    // ShadowTechnique_Automatic, the default, splats shadows at 100K cubes or more
+    // and uses depth compare below that. Other techniques are used at any cube count.
+    // Falls back to ShadowTechnique_DepthCompare if the technique is unsupported.
+    void setShadowTechnique (
+        ShadowTechnique shadowTechnique
+    );
+    
+    // Technique the most recent update() chose, never ShadowTechnique_Automatic.
+    ShadowTechnique activeShadowTechnique() const;
+    
+    // listener is not owned, and may be null to stop notifications.
+    void setRenderStageListener (
+        RenderStageListener * listener
+    );
+    
+    // GPU time of each stage for the most recent frame whose timer queries have
+    // completed, usually a few frames behind. Returns false if GPU timing is
+    // unsupported or no frame has completed yet.
+    bool latestGpuStageTimes (
+        GpuStageTimes & stageTimes
+    ) const;
+    
+    // Work submitted in the most recent frame whose queries have completed, like
+    // latestGpuStageTimes. Returns false if no frame has completed yet.
+    bool latestPipelineStatistics (
+        PipelineStatistics & statistics
+    ) const;
+    
+    // Shader programs whose link was still in progress once the constructor had
+    // submitted them all and needed the first, showing how much of the build overlapped
+    // other setup. Always 0 without KHR_parallel_shader_compile.
+    uint numProgramsLinkingAtSetup() const;
+    
+private:
+    RendererImpl * impl;
+};
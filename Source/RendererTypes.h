@@ -0,0 +1,79 @@
+//
+//  RendererTypes.h
+//
+// Types shared between the C++ Renderer and its platform front ends, kept C compatible
+// for use from Objective-C headers.
+
+#pragma once
+
+
+struct FramebufferSize {
+    GLint width;
+    GLint height;
+};
+typedef struct FramebufferSize FramebufferSize;
+
+
+// Technique used to shadow the ground plane.
+// Values must match the SHADOW_TECHNIQUE_* defines in GroundPlaneFS.glsl.
+enum ShadowTechnique {
+    // Hardware depth comparison against a full resolution shadow map.
+    ShadowTechnique_DepthCompare = 0,
+    
+    // Blurred variance shadow map at a quarter of the shadow map resolution.
+    ShadowTechnique_Variance = 1,
+    
+    // Particles splatted into a low resolution opacity map.
+    ShadowTechnique_Splat = 2,
+    
+    // Splat at high instance counts, depth compare otherwise. Resolved by the Renderer
+    // each frame, so never seen by the shaders.
+    ShadowTechnique_Automatic = 3
+};
+typedef enum ShadowTechnique ShadowTechnique;
+
+
+// Source of the cube vertices each instance is drawn from.
+enum CubeGeometry {
+    // Positions and normals fetched from an indexed vertex buffer.
+    CubeGeometry_Mesh = 0,
+    
+    // Positions and normals derived from gl_VertexID, with no vertex or index
+    // buffers, so only per instance attributes are fetched.
+    CubeGeometry_Procedural = 1,
+    
+    // Procedural, but only the three faces that can face the viewer (the light in the
+    // shadow pass), halving the triangles per cube.
+    CubeGeometry_VisibleFaces = 2
+};
+typedef enum CubeGeometry CubeGeometry;
+
+
+// Stages of a frame, in the order they execute.
+enum RenderStage {
+    // ParticleSystem simulation step, during Renderer::update().
+    RenderStage_ParticleUpdate = 0,
+    
+    // Whichever shadow pass the active ShadowTechnique uses, including blurring.
+    RenderStage_ShadowPass,
+    
+    // Framebuffer clear and instanced cube draw.
+    RenderStage_Cubes,
+    
+    RenderStage_GroundPlane,
+    
+    RenderStage_Count
+};
+typedef enum RenderStage RenderStage;
+
+
+static inline const char * renderStageName(RenderStage stage)
+{
+    switch (stage) {
+        case RenderStage_ParticleUpdate: return "particle_update";
+        case RenderStage_ShadowPass:     return "shadow_pass";
+        case RenderStage_Cubes:          return "cubes";
+        case RenderStage_GroundPlane:    return "ground_plane";
+        default:                         return "unknown";
+    }
+}
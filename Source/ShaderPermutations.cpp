@@ -0,0 +1,125 @@
+//
+//  ShaderPermutations.cpp
+//
+
+#include "ShaderPermutations.hpp"
+
+#include <map>
+#include <memory>
+
+
+class ShaderPermutationsImpl {
+private:
+    friend class ShaderPermutations;
+    
+    std::string m_vertexShaderPath;
+    std::string m_fragmentShaderPath;
+    
+    std::vector<std::string> m_transformFeedbackVaryings;
+    GLenum m_transformFeedbackBufferMode;
+    
+    // Keyed by defines, which std::map keeps sorted by name.
+    std::map<std::string, std::unique_ptr<ShaderProgram>> m_variants;
+    
+    
+    ShaderPermutationsImpl();
+    
+    static std::string variantKey(const ShaderDefines & defines);
+};
+
+
+//---------------------------------------------------------------------------------------
+ShaderPermutationsImpl::ShaderPermutationsImpl()
+    : m_transformFeedbackBufferMode(GL_INTERLEAVED_ATTRIBS)
+{
+
+}
+
+
+//---------------------------------------------------------------------------------------
+ShaderPermutations::ShaderPermutations()
+{
+    impl = new ShaderPermutationsImpl();
+}
+
+
+//---------------------------------------------------------------------------------------
+ShaderPermutations::~ShaderPermutations()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ShaderPermutations::setShaders (
+    const std::string & vertexShaderPath,
+    const std::string & fragmentShaderPath
+) {
+    impl->m_vertexShaderPath = vertexShaderPath;
+    impl->m_fragmentShaderPath = fragmentShaderPath;
+}
+
+
+//---------------------------------------------------------------------------------------
+void ShaderPermutations::setTransformFeedbackVaryings (
+    const std::vector<std::string> & varyings,
+    GLenum bufferMode
+) {
+    impl->m_transformFeedbackVaryings = varyings;
+    impl->m_transformFeedbackBufferMode = bufferMode;
+}
+
+
+//---------------------------------------------------------------------------------------
+std::string ShaderPermutationsImpl::variantKey (
+    const ShaderDefines & defines
+) {
+    std::string key;
+    for (const auto & define : defines) {
+        key += define.first;
+        key += '=';
+        key += define.second;
+        key += '\n';
+    }
+    
+    return key;
+}
+
+
+//---------------------------------------------------------------------------------------
+ShaderProgram & ShaderPermutations::variant (
+    const ShaderDefines & defines
+) {
+    std::unique_ptr<ShaderProgram> & program =
+        impl->m_variants[ShaderPermutationsImpl::variantKey(defines)];
+    
+    if (!program) {
+        program.reset(new ShaderProgram());
+        program->generateProgramObject();
+        program->attachVertexShader(impl->m_vertexShaderPath);
+        program->attachFragmentShader(impl->m_fragmentShaderPath);
+        program->setDefines(defines);
+        
+        if (!impl->m_transformFeedbackVaryings.empty()) {
+            program->setTransformFeedbackVaryings(impl->m_transformFeedbackVaryings,
+                                                  impl->m_transformFeedbackBufferMode);
+        }
+        
+        program->link();
+    }
+    
+    return *program;
+}
+
+
+//---------------------------------------------------------------------------------------
+std::vector<ShaderProgram *> ShaderPermutations::variants() const
+{
+    std::vector<ShaderProgram *> result;
+    for (const auto & variant : impl->m_variants) {
+        result.push_back(variant.second.get());
+    }
+    
+    return result;
+}
@@ -0,0 +1,51 @@
+//
+//  ShaderPermutations.hpp
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ShaderProgram.hpp"
+
+
+// Forward declaration
+class ShaderPermutationsImpl;
+
+
+// Variants of one shader program, each built from the same sources with a different
+// set of defines, so uniform parameters known to take a special value can select a
+// variant without the math they disable.
+//
+// Variants are linked on first request and kept until destruction. Request every
+// variant that may be used at load time, so their links proceed together and none is
+// built mid frame.
+class ShaderPermutations {
+public:
+    ShaderPermutations();
+
+    ~ShaderPermutations();
+
+    // Call before requesting a variant.
+    void setShaders (
+        const std::string & vertexShaderPath,
+        const std::string & fragmentShaderPath
+    );
+
+    void setTransformFeedbackVaryings (
+        const std::vector<std::string> & varyings,
+        GLenum bufferMode
+    );
+
+    // Returns the program built with defines, linking it if not yet requested.
+    // Lookups build a key from defines, so keep the result rather than calling this
+    // every frame.
+    ShaderProgram & variant(const ShaderDefines & defines = ShaderDefines());
+
+    // Every variant requested so far, for setup such as uniform block bindings.
+    std::vector<ShaderProgram *> variants() const;
+
+private:
+    ShaderPermutationsImpl * impl;
+};
@@ -4,8 +4,9 @@
 
 #import "ShaderProgram.hpp"
 
-#include <fstream>
-using std::ifstream;
+#include <algorithm>
+#include <cstring>
+#include <deque>
 
 #include <iostream>
 using std::endl;
@@ -15,12 +16,97 @@ using std::cerr;
 #include <string>
 using std::string;
 
+#include <set>
+
 #include <sstream>
 using std::stringstream;
 
 #include <vector>
 using std::vector;
 
+#import "AssetPack.hpp"
+#import "GLStateCache.hpp"
+#import "PipelineStatistics.hpp"
+#import "ProgramBinaryCache.hpp"
+#import "Profiler.hpp"
+#import "GLExtensions.hpp"
+#import "VertexAttributeDefines.h"
+
+
+// KHR_parallel_shader_compile token, missing from the iOS headers.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+
+#define STRINGIFY_VALUE(value) #value
+#define STRINGIFY(value) STRINGIFY_VALUE(value)
+#define SHADER_DEFINE(name) "#define " #name " " STRINGIFY(name) "\n"
+
+namespace {
+    // Built in include, so shaders share attribute locations with the C++ code.
+    const char * const VertexAttributeDefinesName = "VertexAttributeDefines.h";
+    const char * const VertexAttributeDefinesSource =
+        SHADER_DEFINE(ATTRIBUTE_POSITION)
+        SHADER_DEFINE(ATTRIBUTE_NORMAL)
+        SHADER_DEFINE(ATTRIBUTE_TEXTCOORD)
+        SHADER_DEFINE(ATTRIBUTE_INSTANCE_0)
+        SHADER_DEFINE(ATTRIBUTE_INSTANCE_1)
+        SHADER_DEFINE(ATTRIBUTE_SLOT_0)
+        SHADER_DEFINE(ATTRIBUTE_SLOT_1)
+        SHADER_DEFINE(ATTRIBUTE_SLOT_2)
+        SHADER_DEFINE(ATTRIBUTE_SLOT_3);
+    
+    
+    //-----------------------------------------------------------------------------------
+    bool startsWith (
+        const char * begin,
+        const char * end,
+        const char * prefix
+    ) {
+        const size_t prefixLength = strlen(prefix);
+        return static_cast<size_t>(end - begin) >= prefixLength &&
+               memcmp(begin, prefix, prefixLength) == 0;
+    }
+    
+    
+    //-----------------------------------------------------------------------------------
+    // Returns true if the line from begin to end is an #include directive, setting
+    // fileName to its operand.
+    bool parseInclude (
+        const char * begin,
+        const char * end,
+        std::string & fileName
+    ) {
+        while (begin < end && (*begin == ' ' || *begin == '\t')) {
+            ++begin;
+        }
+        if (!startsWith(begin, end, "#include")) {
+            return false;
+        }
+        
+        const char * nameBegin = std::find(begin, end, '"');
+        const char * nameEnd = (nameBegin == end) ? end : std::find(nameBegin + 1, end, '"');
+        if (nameEnd == end) {
+            return false;
+        }
+        
+        fileName.assign(nameBegin + 1, nameEnd);
+        return true;
+    }
+    
+    
+    //-----------------------------------------------------------------------------------
+    // Looked up once, rather than scanning the extension list on every poll.
+    bool isParallelShaderCompileSupported()
+    {
+        static const bool supported =
+            isGLExtensionSupported("GL_KHR_parallel_shader_compile");
+        
+        return supported;
+    }
+}
+
 
 
 class ShaderProgramImpl {
@@ -31,6 +117,63 @@ private:
     
     std::vector<GLuint> shaderObjects;
     
+    // Sources are preprocessed at link(), and compiled only if no cached binary is
+    // found.
+    struct ShaderSource {
+        GLenum shaderType;
+        std::string filePath;
+        AssetData asset;
+        
+        // Preprocessed source, as the strings passed to glShaderSource. File contents
+        // are not copied, so with an AssetPack open they point into its mapping.
+        std::vector<const GLchar *> strings;
+        std::vector<GLint> lengths;
+        
+        // Files making up the preprocessed source, indexed by source string number.
+        std::vector<std::string> fileNames;
+    };
+    std::vector<ShaderSource> shaderSources;
+    
+    // Files read from disk when not packed, and text generated by preprocessing, for
+    // ShaderSource strings to point into. A deque never moves elements as it grows.
+    std::deque<std::string> sourceStorage;
+    
+    // Parallel to shaderObjects, for reporting compile errors.
+    std::vector<std::vector<std::string>> shaderFileNames;
+    
+    ShaderDefines defines;
+    
+    // Active uniforms outside blocks, sorted by name.
+    struct Uniform {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint arraySize;
+        
+        // Bits of the last value uploaded through a setter, if hasValue.
+        bool hasValue;
+        uint8 value[16];
+    };
+    std::vector<Uniform> uniforms;
+    
+    // Active uniform blocks, sorted by name.
+    struct UniformBlock {
+        std::string name;
+        GLuint index;
+        GLint dataSize;
+        GLuint binding;
+    };
+    std::vector<UniformBlock> uniformBlocks;
+    
+    std::vector<std::string> transformFeedbackVaryings;
+    GLenum transformFeedbackBufferMode;
+    
+    // Set while a submitted link has not had its status checked. Its binary is stored
+    // under pendingCacheKey once checked, if storePendingBinary is set.
+    bool linkPending;
+    bool storePendingBinary;
+    uint64 pendingCacheKey;
+    
     
     ShaderProgramImpl();
     
@@ -38,25 +181,73 @@ private:
     
     void attachShader(const char * filePath, GLenum shaderType);
     
-    void checkCompilationStatus(GLuint shaderObject);
+    void checkCompilationStatus (
+        GLuint shaderObject,
+        const std::vector<std::string> & fileNames
+    );
     
-    void checkLinkStatus();
+    bool checkLinkStatus();
     
     GLuint createShader(GLenum shaderType);
     
-    void compileShader(GLuint shaderObject, const std::string & shader);
+    void compileShader(GLuint shaderObject, const ShaderSource & shaderSource);
+    
+    // From the open AssetPack or else from disk. Returns false if neither has it.
+    bool loadSource(const std::string & filePath, AssetData & asset);
+    
+    void appendSource (
+        ShaderSource & shaderSource,
+        const char * data,
+        size_t numBytes
+    );
+    
+    void appendGeneratedSource(ShaderSource & shaderSource, const std::string & text);
     
-    void extractSourceCode(std::string & shaderSource, const char * filePath);
+    void preprocess(ShaderSource & shaderSource);
+    
+    void expandIncludes (
+        const AssetData & asset,
+        const std::string & directory,
+        int sourceStringNumber,
+        std::set<std::string> & includedFiles,
+        ShaderSource & shaderSource
+    );
     
     void releaseShaderObjects();
     
     void link();
+    
+    // Checks the status of a pending link, waiting for it if needed.
+    void finishLink();
+    
+    void applyTransformFeedbackVaryings();
+    
+    uint64 binaryCacheKey() const;
+    
+    // Returns false on a cache miss, or if the driver rejects the cached binary.
+    bool loadProgramBinary(uint64 cacheKey);
+    
+    void storeProgramBinary(uint64 cacheKey);
+    
+    // Fills uniforms and uniformBlocks from the linked program.
+    void reflect();
+    
+    // Returns nullptr if the block is not active.
+    UniformBlock * findUniformBlock(const char * blockName);
+    
+    // Returns true if value differs from the uniform's last value, recording it.
+    // Otherwise counts a skipped upload.
+    bool updateUniformValue(int uniformIndex, const void * value, size_t numBytes);
 
 };
 
 //------------------------------------------------------------------------------------
 ShaderProgramImpl::ShaderProgramImpl()
-        : programObject(0)
+        : programObject(0),
+          transformFeedbackBufferMode(GL_INTERLEAVED_ATTRIBS),
+          linkPending(false),
+          storePendingBinary(false),
+          pendingCacheKey(0)
 {
     
 }
@@ -99,44 +290,180 @@ void ShaderProgramImpl::attachShader (
     const char * filePath,
     GLenum shaderType
 ) {
-    GLuint shaderObject = glCreateShader(shaderType);
-    CHECK_GL_ERRORS;
+    ShaderSource shaderSource;
+    shaderSource.shaderType = shaderType;
+    shaderSource.filePath = filePath;
+    loadSource(filePath, shaderSource.asset);
+    
+    shaderSources.push_back(shaderSource);
+}
 
-    shaderObjects.push_back(shaderObject);
 
-    std::string shaderSourceCode;
-    extractSourceCode(shaderSourceCode, filePath);
-    compileShader(shaderObject, shaderSourceCode);
+//------------------------------------------------------------------------------------
+void ShaderProgram::setDefines (
+    const ShaderDefines & defines
+) {
+    impl->defines = defines;
 }
 
 
 //------------------------------------------------------------------------------------
-void ShaderProgramImpl::extractSourceCode (
-    string & shaderSource,
-    const char * filePath
+void ShaderProgram::setTransformFeedbackVaryings (
+    const std::vector<std::string> & varyings,
+    GLenum bufferMode
 ) {
-    std::ifstream file;
+    impl->transformFeedbackVaryings = varyings;
+    impl->transformFeedbackBufferMode = bufferMode;
+    impl->applyTransformFeedbackVaryings();
+}
 
-    file.open(filePath);
-    if (!file) {
-        stringstream strStream;
-        strStream << "Error -- Failed to open file: " << filePath << endl;
-        std::cerr << strStream.str();
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::applyTransformFeedbackVaryings()
+{
+    if (transformFeedbackVaryings.empty()) {
+        return;
     }
+    
+    std::vector<const GLchar *> names;
+    for (const std::string & varying : transformFeedbackVaryings) {
+        names.push_back(varying.c_str());
+    }
+    
+    glTransformFeedbackVaryings(programObject, static_cast<GLsizei>(names.size()),
+                                names.data(), transformFeedbackBufferMode);
+    CHECK_GL_ERRORS;
+}
 
-    std::stringstream strBuffer;
-    std::string str;
 
-    while(file.good()) {
-        getline(file, str, '\r');
-        strBuffer << str;
+//------------------------------------------------------------------------------------
+bool ShaderProgramImpl::loadSource (
+    const std::string & filePath,
+    AssetData & asset
+) {
+    sourceStorage.emplace_back();
+    if (AssetPack::load(filePath, sourceStorage.back(), asset)) {
+        return true;
     }
-    file.close();
+    sourceStorage.pop_back();
+    
+    std::cerr << "Error -- Failed to open file: " << filePath << endl;
     
-    // Append null terminator.
-    strBuffer << '\0';
+    asset.data = "";
+    asset.numBytes = 0;
+    
+    return false;
+}
 
-    shaderSource = strBuffer.str();
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::appendSource (
+    ShaderSource & shaderSource,
+    const char * data,
+    size_t numBytes
+) {
+    if (numBytes > 0) {
+        shaderSource.strings.push_back(data);
+        shaderSource.lengths.push_back(static_cast<GLint>(numBytes));
+    }
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::appendGeneratedSource (
+    ShaderSource & shaderSource,
+    const std::string & text
+) {
+    sourceStorage.push_back(text);
+    appendSource(shaderSource, sourceStorage.back().data(), sourceStorage.back().size());
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::preprocess (
+    ShaderSource & shaderSource
+) {
+    const size_t slash = shaderSource.filePath.rfind('/');
+    const std::string directory = (slash == std::string::npos) ?
+        std::string() : shaderSource.filePath.substr(0, slash + 1);
+    
+    shaderSource.fileNames.assign(1, shaderSource.filePath);
+    
+    std::set<std::string> includedFiles;
+    expandIncludes(shaderSource.asset, directory, 0, includedFiles, shaderSource);
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::expandIncludes (
+    const AssetData & asset,
+    const std::string & directory,
+    int sourceStringNumber,
+    std::set<std::string> & includedFiles,
+    ShaderSource & shaderSource
+) {
+    const char * end = asset.data + asset.numBytes;
+    const char * segmentBegin = asset.data;
+    const char * lineBegin = asset.data;
+    std::string fileName;
+    int lineNumber = 0;
+    
+    // Lines are passed through in segments, split only around directives.
+    while (lineBegin < end) {
+        const char * newline =
+            static_cast<const char *>(memchr(lineBegin, '\n', end - lineBegin));
+        const char * lineEnd = newline ? newline + 1 : end;
+        ++lineNumber;
+        
+        const std::string resumeLine = "#line " + std::to_string(lineNumber + 1) + " " +
+                                       std::to_string(sourceStringNumber) + "\n";
+        
+        if (parseInclude(lineBegin, lineEnd, fileName)) {
+            appendSource(shaderSource, segmentBegin, lineBegin - segmentBegin);
+            segmentBegin = lineEnd;
+            
+            // Keep line numbers unchanged when a file is included again.
+            if (!includedFiles.insert(fileName).second) {
+                appendGeneratedSource(shaderSource, "\n");
+            } else {
+                AssetData includedAsset;
+                if (fileName == VertexAttributeDefinesName) {
+                    includedAsset.data = VertexAttributeDefinesSource;
+                    includedAsset.numBytes = strlen(VertexAttributeDefinesSource);
+                } else {
+                    loadSource(directory + fileName, includedAsset);
+                }
+                
+                const int includedNumber = static_cast<int>(shaderSource.fileNames.size());
+                shaderSource.fileNames.push_back(fileName);
+                
+                appendGeneratedSource(shaderSource,
+                                      "#line 1 " + std::to_string(includedNumber) + "\n");
+                expandIncludes(includedAsset, directory, includedNumber, includedFiles,
+                               shaderSource);
+                
+                // The included file may not end in a newline.
+                appendGeneratedSource(shaderSource, "\n" + resumeLine);
+            }
+        }
+        else if (sourceStringNumber == 0 && !defines.empty() &&
+                 startsWith(lineBegin, lineEnd, "#version"))
+        {
+            // Defines must follow #version, which has to come first.
+            appendSource(shaderSource, segmentBegin, lineEnd - segmentBegin);
+            segmentBegin = lineEnd;
+            
+            std::string text = newline ? "" : "\n";
+            for (const auto & define : defines) {
+                text += "#define " + define.first + " " + define.second + "\n";
+            }
+            appendGeneratedSource(shaderSource, text + resumeLine);
+        }
+        
+        lineBegin = lineEnd;
+    }
+    
+    appendSource(shaderSource, segmentBegin, end - segmentBegin);
 }
 
 
@@ -150,15 +477,396 @@ void ShaderProgram::link()
 //------------------------------------------------------------------------------------
 void ShaderProgramImpl::link()
 {
+    PROFILE_SCOPE("ShaderProgram::link");
+    
+    for (ShaderSource & shaderSource : shaderSources) {
+        preprocess(shaderSource);
+    }
+    
+    const bool useBinaryCache = ProgramBinaryCache::isEnabled();
+    uint64 cacheKey = 0;
+    
+    if (useBinaryCache) {
+        cacheKey = binaryCacheKey();
+        if (loadProgramBinary(cacheKey)) {
+            shaderSources.clear();
+            sourceStorage.clear();
+            reflect();
+            return;
+        }
+    }
+    
+    for (const ShaderSource & shaderSource : shaderSources) {
+        GLuint shaderObject = glCreateShader(shaderSource.shaderType);
+        CHECK_GL_ERRORS;
+        
+        shaderObjects.push_back(shaderObject);
+        shaderFileNames.push_back(shaderSource.fileNames);
+        compileShader(shaderObject, shaderSource);
+    }
+    
+    // glShaderSource has copied the strings.
+    shaderSources.clear();
+    sourceStorage.clear();
+    
     for(auto shaderObject : shaderObjects) {
         glAttachShader(programObject, shaderObject);
     }
+    
+    if (useBinaryCache) {
+        glProgramParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
     glLinkProgram(programObject);
+    CHECK_GL_ERRORS;
     
-    checkLinkStatus();
+    // Querying status would wait for the compile and link to finish, so leave it to
+    // first use and let the driver work on several programs at once.
+    linkPending = true;
+    storePendingBinary = useBinaryCache;
+    pendingCacheKey = cacheKey;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::finishLink()
+{
+    if (!linkPending) {
+        return;
+    }
+    linkPending = false;
+    
+    PROFILE_SCOPE("ShaderProgram::finishLink");
+    
+    for (size_t i = 0; i < shaderObjects.size(); ++i) {
+        checkCompilationStatus(shaderObjects[i], shaderFileNames[i]);
+    }
+    
+    const bool linked = checkLinkStatus();
     releaseShaderObjects();
     CHECK_GL_ERRORS;
+    
+    if (storePendingBinary && linked) {
+        storeProgramBinary(pendingCacheKey);
+    }
+    
+    if (linked) {
+        reflect();
+    }
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::reflect()
+{
+    uniforms.clear();
+    uniformBlocks.clear();
+    
+    GLint numUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    
+    std::vector<GLchar> name(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < numUniforms; ++i) {
+        Uniform uniform;
+        GLsizei nameLength = 0;
+        glGetActiveUniform(programObject, static_cast<GLuint>(i), maxNameLength,
+                           &nameLength, &uniform.arraySize, &uniform.type, name.data());
+        uniform.name.assign(name.data(), nameLength);
+        
+        // Block members have no location, and are set through their buffer.
+        uniform.location = glGetUniformLocation(programObject, uniform.name.c_str());
+        if (uniform.location == -1) {
+            continue;
+        }
+        
+        const size_t arraySuffix = uniform.name.rfind("[0]");
+        if (arraySuffix != std::string::npos && arraySuffix + 3 == uniform.name.size()) {
+            uniform.name.erase(arraySuffix);
+        }
+        
+        uniform.hasValue = false;
+        uniforms.push_back(uniform);
+    }
+    
+    GLint numBlocks = 0;
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+    
+    name.resize(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < numBlocks; ++i) {
+        UniformBlock block;
+        block.index = static_cast<GLuint>(i);
+        
+        GLsizei nameLength = 0;
+        glGetActiveUniformBlockName(programObject, block.index, maxNameLength, &nameLength,
+                                    name.data());
+        block.name.assign(name.data(), nameLength);
+        
+        GLint binding = 0;
+        glGetActiveUniformBlockiv(programObject, block.index, GL_UNIFORM_BLOCK_DATA_SIZE,
+                                  &block.dataSize);
+        glGetActiveUniformBlockiv(programObject, block.index, GL_UNIFORM_BLOCK_BINDING,
+                                  &binding);
+        block.binding = static_cast<GLuint>(binding);
+        
+        uniformBlocks.push_back(block);
+    }
+    CHECK_GL_ERRORS;
+    
+    std::sort(uniforms.begin(), uniforms.end(), [](const Uniform & a, const Uniform & b) {
+        return a.name < b.name;
+    });
+    std::sort(uniformBlocks.begin(), uniformBlocks.end(),
+              [](const UniformBlock & a, const UniformBlock & b) {
+        return a.name < b.name;
+    });
+}
+
+
+//------------------------------------------------------------------------------------
+int ShaderProgram::uniformIndex (
+    const char * uniformName
+) const {
+    impl->finishLink();
+    
+    const auto & uniforms = impl->uniforms;
+    auto uniform = std::lower_bound(uniforms.begin(), uniforms.end(), uniformName,
+        [](const ShaderProgramImpl::Uniform & a, const char * name) {
+            return a.name.compare(name) < 0;
+        });
+    
+    if (uniform == uniforms.end() || uniform->name != uniformName) {
+        return -1;
+    }
+    
+    return static_cast<int>(uniform - uniforms.begin());
+}
+
+
+//------------------------------------------------------------------------------------
+GLuint ShaderProgram::uniformBlockIndex (
+    const char * blockName
+) const {
+    impl->finishLink();
+    
+    const ShaderProgramImpl::UniformBlock * block = impl->findUniformBlock(blockName);
+    
+    return block ? block->index : GL_INVALID_INDEX;
+}
+
+
+//------------------------------------------------------------------------------------
+ShaderProgramImpl::UniformBlock * ShaderProgramImpl::findUniformBlock (
+    const char * blockName
+) {
+    auto block = std::lower_bound(uniformBlocks.begin(), uniformBlocks.end(), blockName,
+        [](const UniformBlock & a, const char * name) {
+            return a.name.compare(name) < 0;
+        });
+    
+    if (block == uniformBlocks.end() || block->name != blockName) {
+        return nullptr;
+    }
+    
+    return &*block;
+}
+
+
+//------------------------------------------------------------------------------------
+uint ShaderProgram::numActiveUniforms() const
+{
+    impl->finishLink();
+    return static_cast<uint>(impl->uniforms.size());
+}
+
+
+//------------------------------------------------------------------------------------
+uint ShaderProgram::numActiveUniformBlocks() const
+{
+    impl->finishLink();
+    return static_cast<uint>(impl->uniformBlocks.size());
+}
+
+
+//------------------------------------------------------------------------------------
+bool ShaderProgramImpl::updateUniformValue (
+    int uniformIndex,
+    const void * value,
+    size_t numBytes
+) {
+    Uniform & uniform = uniforms[uniformIndex];
+    if (uniform.hasValue && memcmp(uniform.value, value, numBytes) == 0) {
+        PipelineCounters::countSkippedUniformUpload();
+        return false;
+    }
+    
+    uniform.hasValue = true;
+    memcpy(uniform.value, value, numBytes);
+    PipelineCounters::countUniformUpload();
+    
+    return true;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform (
+    int uniformIndex,
+    GLint value
+) {
+    if (uniformIndex < 0 || !impl->updateUniformValue(uniformIndex, &value, sizeof(value))) {
+        return;
+    }
+    
+    glUniform1i(impl->uniforms[uniformIndex].location, value);
+    CHECK_GL_ERRORS;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform (
+    int uniformIndex,
+    GLfloat value
+) {
+    if (uniformIndex < 0 || !impl->updateUniformValue(uniformIndex, &value, sizeof(value))) {
+        return;
+    }
+    
+    glUniform1f(impl->uniforms[uniformIndex].location, value);
+    CHECK_GL_ERRORS;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform (
+    int uniformIndex,
+    GLfloat x,
+    GLfloat y
+) {
+    const GLfloat value[] = { x, y };
+    if (uniformIndex < 0 || !impl->updateUniformValue(uniformIndex, value, sizeof(value))) {
+        return;
+    }
+    
+    glUniform2f(impl->uniforms[uniformIndex].location, x, y);
+    CHECK_GL_ERRORS;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniformBlockBinding (
+    const char * blockName,
+    GLuint bindingIndex
+) {
+    impl->finishLink();
+    
+    ShaderProgramImpl::UniformBlock * block = impl->findUniformBlock(blockName);
+    if (!block || block->binding == bindingIndex) {
+        return;
+    }
+    
+    glUniformBlockBinding(impl->programObject, block->index, bindingIndex);
+    CHECK_GL_ERRORS;
+    
+    block->binding = bindingIndex;
+}
+
+
+//------------------------------------------------------------------------------------
+bool ShaderProgram::isLinkComplete() const
+{
+    if (!impl->linkPending) {
+        return true;
+    }
+    
+    // Without the extension, the first status query may block.
+    if (!isParallelShaderCompileSupported()) {
+        return true;
+    }
+    
+    GLint complete = GL_FALSE;
+    glGetProgramiv(impl->programObject, GL_COMPLETION_STATUS_KHR, &complete);
+    CHECK_GL_ERRORS;
+    
+    return complete == GL_TRUE;
+}
+
+
+//------------------------------------------------------------------------------------
+uint64 ShaderProgramImpl::binaryCacheKey() const
+{
+    uint64 key = ProgramBinaryCache::driverHash();
+    
+    for (const ShaderSource & shaderSource : shaderSources) {
+        key = ProgramBinaryCache::hash(&shaderSource.shaderType,
+                                       sizeof(shaderSource.shaderType), key);
+        for (size_t i = 0; i < shaderSource.strings.size(); ++i) {
+            key = ProgramBinaryCache::hash(shaderSource.strings[i],
+                                           shaderSource.lengths[i], key);
+        }
+    }
+    
+    key = ProgramBinaryCache::hash(&transformFeedbackBufferMode,
+                                   sizeof(transformFeedbackBufferMode), key);
+    for (const std::string & varying : transformFeedbackVaryings) {
+        key = ProgramBinaryCache::hash(varying.c_str(), varying.size() + 1, key);
+    }
+    
+    return key;
+}
+
+
+//------------------------------------------------------------------------------------
+bool ShaderProgramImpl::loadProgramBinary (
+    uint64 cacheKey
+) {
+    GLenum binaryFormat;
+    std::vector<uint8> binary;
+    if (!ProgramBinaryCache::load(cacheKey, binaryFormat, binary)) {
+        return false;
+    }
+    
+    glProgramBinary(programObject, binaryFormat, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    
+    GLint linkSuccess = GL_FALSE;
+    glGetProgramiv(programObject, GL_LINK_STATUS, &linkSuccess);
+    CHECK_GL_ERRORS;
+    
+    if (linkSuccess == GL_TRUE) {
+        return true;
+    }
+    
+    // Drivers may reject binaries at any time, e.g. after an update that left the
+    // version string unchanged. Start again from a new program object, since a failed
+    // load may discard state set before link such as transform feedback varyings.
+    ProgramBinaryCache::countRejected();
+    
+    glDeleteProgram(programObject);
+    programObject = glCreateProgram();
+    applyTransformFeedbackVaryings();
+    
+    return false;
+}
+
+
+//------------------------------------------------------------------------------------
+void ShaderProgramImpl::storeProgramBinary (
+    uint64 cacheKey
+) {
+    GLint numBytes = 0;
+    glGetProgramiv(programObject, GL_PROGRAM_BINARY_LENGTH, &numBytes);
+    if (numBytes <= 0) {
+        return;
+    }
+    
+    std::vector<uint8> binary(numBytes);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(programObject, numBytes, nullptr, &binaryFormat, binary.data());
+    CHECK_GL_ERRORS;
+    
+    ProgramBinaryCache::store(cacheKey, binaryFormat, binary);
 }
 
 
@@ -173,6 +881,7 @@ ShaderProgram::~ShaderProgram()
 //------------------------------------------------------------------------------------
 ShaderProgramImpl::~ShaderProgramImpl()
 {
+    releaseShaderObjects();
     glDeleteProgram(programObject);
 }
 
@@ -183,19 +892,20 @@ void ShaderProgramImpl::releaseShaderObjects() {
         glDetachShader(programObject, shaderObject);
         glDeleteShader(shaderObject);
     }
+    shaderObjects.clear();
+    shaderFileNames.clear();
 }
 
 
 //------------------------------------------------------------------------------------
 void ShaderProgramImpl::compileShader (
     GLuint shaderObject,
-    const string & shaderSourceCode
+    const ShaderSource & shaderSource
 ) {
-    const char * sourceCodeStr = shaderSourceCode.c_str();
-    glShaderSource(shaderObject, 1, (const GLchar **)&sourceCodeStr, NULL);
+    glShaderSource(shaderObject, static_cast<GLsizei>(shaderSource.strings.size()),
+                   shaderSource.strings.data(), shaderSource.lengths.data());
 
     glCompileShader(shaderObject);
-    checkCompilationStatus(shaderObject);
     
     CHECK_GL_ERRORS;
 }
@@ -203,7 +913,8 @@ void ShaderProgramImpl::compileShader (
 
 //------------------------------------------------------------------------------------
 void ShaderProgramImpl::checkCompilationStatus (
-    GLuint shaderObject
+    GLuint shaderObject,
+    const std::vector<std::string> & fileNames
 ) {
     GLint compileSuccess;
 
@@ -219,6 +930,11 @@ void ShaderProgramImpl::checkCompilationStatus (
 
         std::string message = "Error Compiling Shader: ";
         message += errorMessage;
+        
+        // Errors are reported as source string number:line.
+        for (size_t i = 0; i < fileNames.size(); ++i) {
+            message += "\n  source string " + std::to_string(i) + ": " + fileNames[i];
+        }
 
         std::cerr << message << std::endl;
     }
@@ -227,20 +943,21 @@ void ShaderProgramImpl::checkCompilationStatus (
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::enable() const {
-    glUseProgram(impl->programObject);
+    impl->finishLink();
+    GLStateCache::useProgram(impl->programObject);
     CHECK_GL_ERRORS;
 }
 
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::disable() const {
-    glUseProgram((GLuint)NULL);
+    GLStateCache::useProgram((GLuint)NULL);
     CHECK_GL_ERRORS;
 }
 
 
 //------------------------------------------------------------------------------------
-void ShaderProgramImpl::checkLinkStatus()
+bool ShaderProgramImpl::checkLinkStatus()
 {
     GLint linkSuccess;
 
@@ -258,12 +975,15 @@ void ShaderProgramImpl::checkLinkStatus()
         strStream << "Error Linking Shaders: " << errorMessage << std::endl;
         std::cerr << strStream.str();
     }
+    
+    return linkSuccess == GL_TRUE;
 }
 
 
 //------------------------------------------------------------------------------------
 GLuint ShaderProgram::programObject() const
 {
+    impl->finishLink();
     return impl->programObject;
 }
 
@@ -273,6 +993,7 @@ GLint ShaderProgram::getUniformLocation (
     const char * uniformName
 ) const
 {
+    impl->finishLink();
     GLint result =
         glGetUniformLocation(impl->programObject, (const GLchar *)uniformName);
     
@@ -294,6 +1015,7 @@ GLint ShaderProgram::getUniformLocation (
 GLint ShaderProgram::getAttribLocation (
     const char * attributeName
 ) const {
+    impl->finishLink();
     GLint result =
         glGetAttribLocation(impl->programObject, (const GLchar *)attributeName);
     
@@ -314,5 +1036,6 @@ GLint ShaderProgram::getAttribLocation (
 //------------------------------------------------------------------------------------
 ShaderProgram::operator GLuint () const
 {
+    impl->finishLink();
     return impl->programObject;
 }
\ No newline at end of file
@@ -4,13 +4,19 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 
 
 // Forward declaration
 class ShaderProgramImpl;
 
 
+// Preprocessor definitions, name to value, inserted after a shader's #version line.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+
 class ShaderProgram {
 public:
     ShaderProgram();
@@ -23,7 +29,33 @@ public:
     
     void attachFragmentShader(const std::string & filePath);
     
+    // Call before link(). Applies to every attached shader.
+    void setDefines(const ShaderDefines & defines);
+    
+    // Call before link(). Records the varyings so they are part of the program's
+    // binary cache key.
+    void setTransformFeedbackVaryings (
+        const std::vector<std::string> & varyings,
+        GLenum bufferMode
+    );
+    
+    // Compiles the attached shaders and links them, or loads the program from
+    // ProgramBinaryCache when it holds a binary for the same sources and driver.
+    //
+    // Sources are first preprocessed: each #include "File.glsl" line is replaced by
+    // that file, found relative to the including file and included at most once, and
+    // the defines are inserted after #version. "VertexAttributeDefines.h" is built in,
+    // giving shaders the same ATTRIBUTE_* locations as the C++ code. Compile errors in
+    // included files are reported against the source string number of each file.
+    //
+    // Compile and link status are checked on first use of the program, through any of
+    // the methods below, so that drivers supporting KHR_parallel_shader_compile can
+    // build several programs concurrently. Link all programs before using any.
     void link();
+    
+    // True once a submitted link has finished, so first use will not wait for it.
+    // Always true without KHR_parallel_shader_compile.
+    bool isLinkComplete() const;
 
     void enable() const;
 
@@ -35,6 +67,33 @@ public:
     
     GLint getAttribLocation(const char * attributeName) const;
     
+    //-- Reflection, a table of active uniforms and uniform blocks built once the link
+    // completes.
+    
+    // Position of the named active uniform in the table, or -1 if it is not active.
+    // Arrays are named without "[0]". Look indices up once, since lookup compares names.
+    int uniformIndex(const char * uniformName) const;
+    
+    // Index of the named active uniform block, or GL_INVALID_INDEX.
+    GLuint uniformBlockIndex(const char * blockName) const;
+    
+    uint numActiveUniforms() const;
+    
+    uint numActiveUniformBlocks() const;
+    
+    // Typed setters taking an index from uniformIndex(), for a program that is
+    // enabled. Each compares against the last value set, and skips uploading an
+    // unchanged value, counting it in PipelineCounters. Index -1 is ignored, as
+    // glUniform* ignores location -1.
+    void setUniform(int uniformIndex, GLint value);
+    
+    void setUniform(int uniformIndex, GLfloat value);
+    
+    void setUniform(int uniformIndex, GLfloat x, GLfloat y);
+    
+    // Binds the named block if it is active and not already bound to bindingIndex.
+    void setUniformBlockBinding(const char * blockName, GLuint bindingIndex);
+    
     // Support conversion to GLuint for use with GL functions.
     // Returns programObject.
     operator GLuint () const;
@@ -0,0 +1,150 @@
+//
+//  TornadoMath.hpp
+//
+// Scalar reference versions of the math used to simulate the tornado. The per
+// particle functions mirror TornadoParticleSimVS.glsl, and must be kept in sync with it.
+
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+
+// Bezier curve matrices, in the layout of ParticleSimUniforms.
+struct BezierMatrices {
+    glm::mat4 basisMatrix;  // B(t)   = basisMatrix * vec4(1, t, t^2, t^3)
+    glm::mat4 derivMatrix;  // B'(t)  = derivMatrix * vec4(1, t, t^2, 0)
+};
+
+
+//---------------------------------------------------------------------------------------
+inline BezierMatrices bezierMatricesFromControlPoints (
+    const glm::vec3 & p0,
+    const glm::vec3 & p1,
+    const glm::vec3 & p2,
+    const glm::vec3 & p3
+) {
+    glm::mat4 pMatrix = {
+        glm::vec4(p0, 0.0f),
+        glm::vec4(p1, 0.0f),
+        glm::vec4(p2, 0.0f),
+        glm::vec4(p3, 0.0f)
+    };
+
+    glm::mat4 coefficientMatrix = {
+        { 1.0f,  0.0f,  0.0f,  0.0f},
+        {-3.0f,  3.0f,  0.0f,  0.0f},
+        { 3.0f, -6.0f,  3.0f,  0.0f},
+        {-1.0f,  3.0f, -3.0f,  1.0f}
+    };
+
+    glm::mat4 derivCoefficientMatrix = {
+        {-3.0f,  3.0f,  0.0f,  0.0f},
+        { 6.0f, -12.0f, 6.0f,  0.0f},
+        {-3.0f,  9.0f, -9.0f,  3.0f},
+        { 0.0f,  0.0f,  0.0f,  0.0f},
+    };
+
+    BezierMatrices matrices;
+    matrices.basisMatrix = pMatrix * coefficientMatrix;
+    matrices.derivMatrix = pMatrix * derivCoefficientMatrix;
+
+    return matrices;
+}
+
+
+//---------------------------------------------------------------------------------------
+// B(t) in matrix form, as evaluated by the shader.
+inline glm::vec3 bezierPoint (
+    const glm::mat4 & basisMatrix,
+    float t
+) {
+    float t2 = t*t;
+    float t3 = t*t2;
+    return glm::vec3(basisMatrix * glm::vec4(1.0f, t, t2, t3));
+}
+
+
+//---------------------------------------------------------------------------------------
+// B(t) from the columns of basisMatrix, using Horner's rule.
+inline glm::vec3 bezierPointHorner (
+    const glm::mat4 & basisMatrix,
+    float t
+) {
+    glm::vec3 c0(basisMatrix[0]);
+    glm::vec3 c1(basisMatrix[1]);
+    glm::vec3 c2(basisMatrix[2]);
+    glm::vec3 c3(basisMatrix[3]);
+    return ((c3 * t + c2) * t + c1) * t + c0;
+}
+
+
+//---------------------------------------------------------------------------------------
+// B(t) by repeated linear interpolation of the control points.
+inline glm::vec3 bezierPointDeCasteljau (
+    const glm::vec3 & p0,
+    const glm::vec3 & p1,
+    const glm::vec3 & p2,
+    const glm::vec3 & p3,
+    float t
+) {
+    glm::vec3 a = glm::mix(p0, p1, t);
+    glm::vec3 b = glm::mix(p1, p2, t);
+    glm::vec3 c = glm::mix(p2, p3, t);
+
+    glm::vec3 d = glm::mix(a, b, t);
+    glm::vec3 e = glm::mix(b, c, t);
+
+    return glm::mix(d, e, t);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Normalized B'(t).
+inline glm::vec3 bezierTangent (
+    const glm::mat4 & derivMatrix,
+    float t
+) {
+    glm::vec4 tangent = derivMatrix * glm::vec4(1.0f, t, t*t, 0.0f);
+    return glm::normalize(glm::vec3(tangent));
+}
+
+
+//---------------------------------------------------------------------------------------
+inline glm::vec4 quatFromAxisAngle (
+    const glm::vec3 & axis,  // Axis of rotation, assumed normalized.
+    float angle              // Angle of rotation in radians.
+) {
+    float halfAngle = angle * 0.5f;
+    float sinHalfAngle = std::sin(halfAngle);
+    return glm::vec4(axis * sinHalfAngle, std::cos(halfAngle));
+}
+
+
+//---------------------------------------------------------------------------------------
+inline glm::vec3 rotatePosition (
+    const glm::vec3 & position,
+    const glm::vec3 & axis,  // Axis of rotation, assumed normalized.
+    float angle              // Angle of rotation in radians.
+) {
+    glm::vec4 q = quatFromAxisAngle(axis, angle);
+    glm::vec3 u(q);
+    return position + 2.0f * glm::cross(u, glm::cross(u, position) + q.w * position);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Tangent at t rotated 90 degrees about an axis perpendicular to it. As in the shader,
+// the axis is not normalized.
+inline glm::vec3 normalToCurve (
+    const glm::mat4 & derivMatrix,
+    float t
+) {
+    glm::vec3 tangent = bezierTangent(derivMatrix, t);
+
+    glm::vec3 tangent_cross_x = glm::cross(glm::vec3(1.0f, 0.0f, 0.0f), tangent);
+    glm::vec3 axis = glm::cross(tangent, tangent_cross_x);
+
+    return rotatePosition(tangent, axis, glm::radians(90.0f));
+}
@@ -0,0 +1,508 @@
+//
+//  TornadoMathSIMD.hpp
+//
+// Structure of arrays versions of the per particle kernels in TornadoMath.hpp, written
+// once against a small float vector interface and instantiated per instruction set:
+//
+//   SimdFloat1     Plain float, one particle at a time.
+//   SimdFloatSSE   4 wide, when compiled with SSE2.
+//   SimdFloatAVX   8 wide, when compiled with AVX (FMA is used if also enabled).
+//   SimdFloatNEON  4 wide, when compiled with NEON.
+//
+// Kernels process count particles, where count must be a multiple of V::Width.
+
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "NumericTypes.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+    #include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+    #include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+
+//---------------------------------------------------------------------------------------
+// Float vector types
+//
+// Each provides Width, broadcast construction from float, load/store of Width
+// consecutive floats, arithmetic operators, and mulAdd(a, b, c) = a * b + c,
+// sqrt and roundNearest.
+//---------------------------------------------------------------------------------------
+
+struct SimdFloat1 {
+    static const uint Width = 1;
+    float v;
+
+    SimdFloat1() { }
+    SimdFloat1(float s) : v(s) { }
+
+    static SimdFloat1 load(const float * p) { return SimdFloat1(*p); }
+    void store(float * p) const { *p = v; }
+};
+
+inline SimdFloat1 operator + (SimdFloat1 a, SimdFloat1 b) { return a.v + b.v; }
+inline SimdFloat1 operator - (SimdFloat1 a, SimdFloat1 b) { return a.v - b.v; }
+inline SimdFloat1 operator * (SimdFloat1 a, SimdFloat1 b) { return a.v * b.v; }
+inline SimdFloat1 operator / (SimdFloat1 a, SimdFloat1 b) { return a.v / b.v; }
+inline SimdFloat1 operator - (SimdFloat1 a) { return -a.v; }
+inline SimdFloat1 mulAdd(SimdFloat1 a, SimdFloat1 b, SimdFloat1 c) { return a.v * b.v + c.v; }
+inline SimdFloat1 sqrt(SimdFloat1 a) { return std::sqrt(a.v); }
+inline SimdFloat1 roundNearest(SimdFloat1 a) { return std::floor(a.v + 0.5f); }
+
+
+#if defined(__SSE2__)
+struct SimdFloatSSE {
+    static const uint Width = 4;
+    __m128 v;
+
+    SimdFloatSSE() { }
+    SimdFloatSSE(__m128 r) : v(r) { }
+    SimdFloatSSE(float s) : v(_mm_set1_ps(s)) { }
+
+    static SimdFloatSSE load(const float * p) { return _mm_loadu_ps(p); }
+    void store(float * p) const { _mm_storeu_ps(p, v); }
+};
+
+inline SimdFloatSSE operator + (SimdFloatSSE a, SimdFloatSSE b) { return _mm_add_ps(a.v, b.v); }
+inline SimdFloatSSE operator - (SimdFloatSSE a, SimdFloatSSE b) { return _mm_sub_ps(a.v, b.v); }
+inline SimdFloatSSE operator * (SimdFloatSSE a, SimdFloatSSE b) { return _mm_mul_ps(a.v, b.v); }
+inline SimdFloatSSE operator / (SimdFloatSSE a, SimdFloatSSE b) { return _mm_div_ps(a.v, b.v); }
+inline SimdFloatSSE operator - (SimdFloatSSE a) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+inline SimdFloatSSE sqrt(SimdFloatSSE a) { return _mm_sqrt_ps(a.v); }
+
+inline SimdFloatSSE mulAdd(SimdFloatSSE a, SimdFloatSSE b, SimdFloatSSE c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a.v, b.v, c.v);
+#else
+    return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v);
+#endif
+}
+
+inline SimdFloatSSE roundNearest(SimdFloatSSE a)
+{
+#if defined(__SSE4_1__)
+    return _mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#else
+    // Conversion uses the current rounding mode, round to nearest by default.
+    return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v));
+#endif
+}
+#endif // __SSE2__
+
+
+#if defined(__AVX__)
+struct SimdFloatAVX {
+    static const uint Width = 8;
+    __m256 v;
+
+    SimdFloatAVX() { }
+    SimdFloatAVX(__m256 r) : v(r) { }
+    SimdFloatAVX(float s) : v(_mm256_set1_ps(s)) { }
+
+    static SimdFloatAVX load(const float * p) { return _mm256_loadu_ps(p); }
+    void store(float * p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline SimdFloatAVX operator + (SimdFloatAVX a, SimdFloatAVX b) { return _mm256_add_ps(a.v, b.v); }
+inline SimdFloatAVX operator - (SimdFloatAVX a, SimdFloatAVX b) { return _mm256_sub_ps(a.v, b.v); }
+inline SimdFloatAVX operator * (SimdFloatAVX a, SimdFloatAVX b) { return _mm256_mul_ps(a.v, b.v); }
+inline SimdFloatAVX operator / (SimdFloatAVX a, SimdFloatAVX b) { return _mm256_div_ps(a.v, b.v); }
+inline SimdFloatAVX operator - (SimdFloatAVX a) { return _mm256_sub_ps(_mm256_setzero_ps(), a.v); }
+inline SimdFloatAVX sqrt(SimdFloatAVX a) { return _mm256_sqrt_ps(a.v); }
+
+inline SimdFloatAVX mulAdd(SimdFloatAVX a, SimdFloatAVX b, SimdFloatAVX c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a.v, b.v, c.v);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v);
+#endif
+}
+
+inline SimdFloatAVX roundNearest(SimdFloatAVX a)
+{
+    return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+#endif // __AVX__
+
+
+#if defined(__ARM_NEON)
+struct SimdFloatNEON {
+    static const uint Width = 4;
+    float32x4_t v;
+
+    SimdFloatNEON() { }
+    SimdFloatNEON(float32x4_t r) : v(r) { }
+    SimdFloatNEON(float s) : v(vdupq_n_f32(s)) { }
+
+    static SimdFloatNEON load(const float * p) { return vld1q_f32(p); }
+    void store(float * p) const { vst1q_f32(p, v); }
+};
+
+inline SimdFloatNEON operator + (SimdFloatNEON a, SimdFloatNEON b) { return vaddq_f32(a.v, b.v); }
+inline SimdFloatNEON operator - (SimdFloatNEON a, SimdFloatNEON b) { return vsubq_f32(a.v, b.v); }
+inline SimdFloatNEON operator * (SimdFloatNEON a, SimdFloatNEON b) { return vmulq_f32(a.v, b.v); }
+inline SimdFloatNEON operator - (SimdFloatNEON a) { return vnegq_f32(a.v); }
+
+inline SimdFloatNEON mulAdd(SimdFloatNEON a, SimdFloatNEON b, SimdFloatNEON c)
+{
+#if defined(__aarch64__)
+    return vfmaq_f32(c.v, a.v, b.v);
+#else
+    return vmlaq_f32(c.v, a.v, b.v);
+#endif
+}
+
+#if defined(__aarch64__)
+inline SimdFloatNEON operator / (SimdFloatNEON a, SimdFloatNEON b) { return vdivq_f32(a.v, b.v); }
+inline SimdFloatNEON sqrt(SimdFloatNEON a) { return vsqrtq_f32(a.v); }
+inline SimdFloatNEON roundNearest(SimdFloatNEON a) { return vrndnq_f32(a.v); }
+#else
+// ARMv7 has no vector divide, square root or rounding, so refine estimates instead.
+inline SimdFloatNEON operator / (SimdFloatNEON a, SimdFloatNEON b)
+{
+    float32x4_t reciprocal = vrecpeq_f32(b.v);
+    reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+    reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+    return vmulq_f32(a.v, reciprocal);
+}
+
+// Inputs must be positive.
+inline SimdFloatNEON sqrt(SimdFloatNEON a)
+{
+    float32x4_t rsqrt = vrsqrteq_f32(a.v);
+    rsqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.v, rsqrt), rsqrt), rsqrt);
+    rsqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.v, rsqrt), rsqrt), rsqrt);
+    return vmulq_f32(a.v, rsqrt);
+}
+
+inline SimdFloatNEON roundNearest(SimdFloatNEON a)
+{
+    // Add 0.5 with the sign of a, then truncate.
+    const uint32x4_t signBit = vdupq_n_u32(0x80000000);
+    uint32x4_t half = vorrq_u32(vandq_u32(vreinterpretq_u32_f32(a.v), signBit),
+                                vreinterpretq_u32_f32(vdupq_n_f32(0.5f)));
+    return vcvtq_f32_s32(vcvtq_s32_f32(vaddq_f32(a.v, vreinterpretq_f32_u32(half))));
+}
+#endif
+#endif // __ARM_NEON
+
+
+//---------------------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------------------
+
+template <typename V>
+struct SimdVec3 {
+    V x, y, z;
+};
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+inline SimdVec3<V> cross (
+    const SimdVec3<V> & a,
+    const SimdVec3<V> & b
+) {
+    SimdVec3<V> result;
+    result.x = a.y * b.z - a.z * b.y;
+    result.y = a.z * b.x - a.x * b.z;
+    result.z = a.x * b.y - a.y * b.x;
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Sine and cosine of x, to within about 5e-7 for |x| up to a few thousand radians.
+template <typename V>
+inline void sinCos (
+    V x,
+    V & sinX,
+    V & cosX
+) {
+    // Reduce x to [-pi, pi], then evaluate Taylor series at x/2, within [-pi/2, pi/2],
+    // and apply the double angle formulas.
+    x = x - roundNearest(x * V(0.159154943f)) * V(6.28318531f);
+    const V h = x * V(0.5f);
+    const V h2 = h * h;
+
+    V sinH = mulAdd(h2, V(-2.50521084e-8f), V(2.75573192e-6f));
+    sinH = mulAdd(h2, sinH, V(-1.98412698e-4f));
+    sinH = mulAdd(h2, sinH, V(8.33333333e-3f));
+    sinH = mulAdd(h2, sinH, V(-1.66666667e-1f));
+    sinH = mulAdd(h2, sinH, V(1.0f)) * h;
+
+    V cosH = mulAdd(h2, V(-2.75573192e-7f), V(2.48015873e-5f));
+    cosH = mulAdd(h2, cosH, V(-1.38888889e-3f));
+    cosH = mulAdd(h2, cosH, V(4.16666667e-2f));
+    cosH = mulAdd(h2, cosH, V(-0.5f));
+    cosH = mulAdd(h2, cosH, V(1.0f));
+
+    sinX = V(2.0f) * sinH * cosH;
+    cosX = V(1.0f) - V(2.0f) * sinH * sinH;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Rotates position by the unit quaternion (u, w).
+template <typename V>
+inline SimdVec3<V> rotateByQuat (
+    const SimdVec3<V> & position,
+    const SimdVec3<V> & u,
+    V w
+) {
+    SimdVec3<V> t = cross(u, position);
+    t.x = mulAdd(w, position.x, t.x);
+    t.y = mulAdd(w, position.y, t.y);
+    t.z = mulAdd(w, position.z, t.z);
+
+    const SimdVec3<V> r = cross(u, t);
+    SimdVec3<V> result;
+    result.x = mulAdd(V(2.0f), r.x, position.x);
+    result.y = mulAdd(V(2.0f), r.y, position.y);
+    result.z = mulAdd(V(2.0f), r.z, position.z);
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Kernels
+//---------------------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------------------
+// B(t) in matrix form, basisMatrix * vec4(1, t, t^2, t^3), as evaluated by the shader.
+template <typename V>
+void bezierPointsMatrix (
+    const glm::mat4 & basisMatrix,
+    const float * t,
+    float * x,
+    float * y,
+    float * z,
+    uint count
+) {
+    V c[4][3];
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            c[col][row] = V(basisMatrix[col][row]);
+        }
+    }
+
+    for (uint i = 0; i < count; i += V::Width) {
+        const V t1 = V::load(t + i);
+        const V t2 = t1 * t1;
+        const V t3 = t2 * t1;
+
+        (c[0][0] + c[1][0] * t1 + c[2][0] * t2 + c[3][0] * t3).store(x + i);
+        (c[0][1] + c[1][1] * t1 + c[2][1] * t2 + c[3][1] * t3).store(y + i);
+        (c[0][2] + c[1][2] * t1 + c[2][2] * t2 + c[3][2] * t3).store(z + i);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// B(t) from the columns of basisMatrix, using Horner's rule.
+template <typename V>
+void bezierPointsHorner (
+    const glm::mat4 & basisMatrix,
+    const float * t,
+    float * x,
+    float * y,
+    float * z,
+    uint count
+) {
+    V c[4][3];
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            c[col][row] = V(basisMatrix[col][row]);
+        }
+    }
+
+    float * out[3] = {x, y, z};
+    for (uint i = 0; i < count; i += V::Width) {
+        const V t1 = V::load(t + i);
+        for (int row = 0; row < 3; ++row) {
+            V p = mulAdd(c[3][row], t1, c[2][row]);
+            p = mulAdd(p, t1, c[1][row]);
+            p = mulAdd(p, t1, c[0][row]);
+            p.store(out[row] + i);
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// B(t) by repeated linear interpolation of the control points.
+template <typename V>
+void bezierPointsDeCasteljau (
+    const glm::vec3 & p0,
+    const glm::vec3 & p1,
+    const glm::vec3 & p2,
+    const glm::vec3 & p3,
+    const float * t,
+    float * x,
+    float * y,
+    float * z,
+    uint count
+) {
+    float * out[3] = {x, y, z};
+    for (int row = 0; row < 3; ++row) {
+        const V q0(p0[row]);
+        const V q1(p1[row]);
+        const V q2(p2[row]);
+        const V q3(p3[row]);
+
+        for (uint i = 0; i < count; i += V::Width) {
+            const V t1 = V::load(t + i);
+
+            const V a = mulAdd(q1 - q0, t1, q0);
+            const V b = mulAdd(q2 - q1, t1, q1);
+            const V c = mulAdd(q3 - q2, t1, q2);
+
+            const V d = mulAdd(b - a, t1, a);
+            const V e = mulAdd(c - b, t1, b);
+
+            mulAdd(e - d, t1, d).store(out[row] + i);
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// quatFromAxisAngle and rotatePosition, rotating positions in place about unit axes.
+template <typename V>
+void rotatePositions (
+    float * x,
+    float * y,
+    float * z,
+    const float * axisX,
+    const float * axisY,
+    const float * axisZ,
+    const float * angle,
+    uint count
+) {
+    for (uint i = 0; i < count; i += V::Width) {
+        V sinHalfAngle, cosHalfAngle;
+        sinCos(V::load(angle + i) * V(0.5f), sinHalfAngle, cosHalfAngle);
+
+        SimdVec3<V> u;
+        u.x = V::load(axisX + i) * sinHalfAngle;
+        u.y = V::load(axisY + i) * sinHalfAngle;
+        u.z = V::load(axisZ + i) * sinHalfAngle;
+
+        SimdVec3<V> position;
+        position.x = V::load(x + i);
+        position.y = V::load(y + i);
+        position.z = V::load(z + i);
+
+        const SimdVec3<V> result = rotateByQuat(position, u, cosHalfAngle);
+        result.x.store(x + i);
+        result.y.store(y + i);
+        result.z.store(z + i);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// normalToCurve(derivMatrix, t) for each t.
+template <typename V>
+void normalsToCurve (
+    const glm::mat4 & derivMatrix,
+    const float * t,
+    float * x,
+    float * y,
+    float * z,
+    uint count
+) {
+    V d[3][3];
+    for (int col = 0; col < 3; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            d[col][row] = V(derivMatrix[col][row]);
+        }
+    }
+
+    // Quaternion for a 90 degree rotation is (axis * sin(45), cos(45)).
+    const V sin45(0.707106781f);
+    const V cos45(0.707106781f);
+
+    for (uint i = 0; i < count; i += V::Width) {
+        const V t1 = V::load(t + i);
+
+        SimdVec3<V> tangent;
+        tangent.x = mulAdd(mulAdd(d[2][0], t1, d[1][0]), t1, d[0][0]);
+        tangent.y = mulAdd(mulAdd(d[2][1], t1, d[1][1]), t1, d[0][1]);
+        tangent.z = mulAdd(mulAdd(d[2][2], t1, d[1][2]), t1, d[0][2]);
+
+        const V invLength = V(1.0f) / sqrt(tangent.x * tangent.x +
+                                           tangent.y * tangent.y +
+                                           tangent.z * tangent.z);
+        tangent.x = tangent.x * invLength;
+        tangent.y = tangent.y * invLength;
+        tangent.z = tangent.z * invLength;
+
+        // axis = cross(tangent, cross(vec3(1,0,0), tangent)), expanded.
+        SimdVec3<V> u;
+        u.x = (tangent.y * tangent.y + tangent.z * tangent.z) * sin45;
+        u.y = -(tangent.x * tangent.y) * sin45;
+        u.z = -(tangent.x * tangent.z) * sin45;
+
+        const SimdVec3<V> result = rotateByQuat(tangent, u, cos45);
+        result.x.store(x + i);
+        result.y.store(y + i);
+        result.z.store(z + i);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// bezierMatricesFromControlPoints, with the coefficient matrix products expanded:
+//   B(t)  columns are p0, 3(p1 - p0), 3(p0 - 2p1 + p2), -p0 + 3p1 - 3p2 + p3
+//   B'(t) columns are the derivatives of those, 3(p1 - p0), 6(p0 - 2p1 + p2), ...
+// Each column is one 4 wide vector, so only the 4 wide types apply.
+template <typename V>
+void bezierMatricesFromControlPointsExpanded (
+    const glm::vec3 & p0,
+    const glm::vec3 & p1,
+    const glm::vec3 & p2,
+    const glm::vec3 & p3,
+    float * basisMatrix,   // 16 floats, column major
+    float * derivMatrix    // 16 floats, column major
+) {
+    static_assert(V::Width == 4, "Columns are 4 wide");
+
+    const float q0[4] = {p0.x, p0.y, p0.z, 0.0f};
+    const float q1[4] = {p1.x, p1.y, p1.z, 0.0f};
+    const float q2[4] = {p2.x, p2.y, p2.z, 0.0f};
+    const float q3[4] = {p3.x, p3.y, p3.z, 0.0f};
+
+    const V v0 = V::load(q0);
+    const V v1 = V::load(q1);
+    const V v2 = V::load(q2);
+    const V v3 = V::load(q3);
+
+    const V c1 = V(3.0f) * (v1 - v0);
+    const V c2 = V(3.0f) * (v0 - V(2.0f) * v1 + v2);
+    const V c3 = (v3 - v0) + V(3.0f) * (v1 - v2);
+
+    v0.store(basisMatrix + 0);
+    c1.store(basisMatrix + 4);
+    c2.store(basisMatrix + 8);
+    c3.store(basisMatrix + 12);
+
+    c1.store(derivMatrix + 0);
+    (V(2.0f) * c2).store(derivMatrix + 4);
+    (V(3.0f) * c3).store(derivMatrix + 8);
+    V(0.0f).store(derivMatrix + 12);
+}
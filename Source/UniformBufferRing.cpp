@@ -0,0 +1,197 @@
+//
+//  UniformBufferRing.cpp
+//
+
+#include "UniformBufferRing.hpp"
+
+#include <vector>
+using std::vector;
+
+#include "Align.hpp"
+#include "GLStateCache.hpp"
+#include "PipelineStatistics.hpp"
+
+
+class UniformBufferRingImpl {
+private:
+    friend class UniformBufferRing;
+    
+    GLuint m_ubo;
+    GLint m_offsetAlignment;
+    GLsizeiptr m_bytesPerFrame;
+    
+    // Index of frame region most recently returned by mapNextFrame().
+    uint m_currentFrame;
+    
+    // One fence per frame region, null when the region is free for writing.
+    std::vector<GLsync> m_fences;
+    
+    
+    UniformBufferRingImpl();
+    
+    ~UniformBufferRingImpl();
+    
+    void waitForFrame(uint frameIndex);
+};
+
+
+//---------------------------------------------------------------------------------------
+UniformBufferRingImpl::UniformBufferRingImpl()
+    : m_ubo(0),
+      m_offsetAlignment(1),
+      m_bytesPerFrame(0),
+      m_currentFrame(0)
+{
+    
+}
+
+
+//---------------------------------------------------------------------------------------
+UniformBufferRing::UniformBufferRing()
+{
+    impl = new UniformBufferRingImpl();
+}
+
+
+//---------------------------------------------------------------------------------------
+UniformBufferRing::~UniformBufferRing()
+{
+    delete impl;
+    impl = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+UniformBufferRingImpl::~UniformBufferRingImpl()
+{
+    for (GLsync fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(1, &m_ubo);
+}
+
+
+//---------------------------------------------------------------------------------------
+void UniformBufferRing::allocate (
+    GLsizeiptr bytesPerFrame,
+    uint numFrames
+) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &impl->m_offsetAlignment);
+    
+    // Each frame region must start on an aligned offset.
+    impl->m_bytesPerFrame = align(bytesPerFrame,
+                                  static_cast<GLsizeiptr>(impl->m_offsetAlignment));
+    
+    impl->m_fences.assign(numFrames, nullptr);
+    
+    // Start on last region so that the first call to mapNextFrame() returns region 0.
+    impl->m_currentFrame = numFrames - 1;
+    
+    if (impl->m_ubo == 0) {
+        glGenBuffers(1, &impl->m_ubo);
+    }
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, impl->m_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, impl->m_bytesPerFrame * numFrames, nullptr,
+                 GL_DYNAMIC_DRAW);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+void UniformBufferRingImpl::waitForFrame (
+    uint frameIndex
+) {
+    GLsync & fence = m_fences[frameIndex];
+    if (fence == nullptr) {
+        return;
+    }
+    
+    // Flush on the first wait so the fence is guaranteed to signal.
+    const GLuint64 oneSecond = 1000000000;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, oneSecond);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, 0, oneSecond);
+    }
+    
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+
+//---------------------------------------------------------------------------------------
+GLvoid * UniformBufferRing::mapNextFrame()
+{
+    const uint numFrames = static_cast<uint>(impl->m_fences.size());
+    impl->m_currentFrame = (impl->m_currentFrame + 1) % numFrames;
+    
+    impl->waitForFrame(impl->m_currentFrame);
+    
+    // The fence guarantees the GPU is done with this region, so the driver need not
+    // synchronize, nor preserve the previous contents.
+    const GLintptr offset = impl->m_currentFrame * impl->m_bytesPerFrame;
+    const GLbitfield access = GL_MAP_WRITE_BIT |
+                              GL_MAP_INVALIDATE_RANGE_BIT |
+                              GL_MAP_UNSYNCHRONIZED_BIT;
+    
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, impl->m_ubo);
+    GLvoid * frameData = glMapBufferRange(GL_UNIFORM_BUFFER, offset, impl->m_bytesPerFrame,
+                                          access);
+    CHECK_GL_ERRORS;
+    
+    // The caller may write less, but the whole region is handed to the driver.
+    PipelineCounters::countBytesUploaded(impl->m_bytesPerFrame);
+    
+    return frameData;
+}
+
+
+//---------------------------------------------------------------------------------------
+void UniformBufferRing::unmap()
+{
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+void UniformBufferRing::bindRange (
+    GLuint bindingIndex,
+    GLintptr offset,
+    GLsizeiptr size
+) const {
+    const GLintptr frameOffset = impl->m_currentFrame * impl->m_bytesPerFrame;
+    GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, impl->m_ubo,
+                                  frameOffset + offset, size);
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+void UniformBufferRing::fenceCurrentFrame()
+{
+    GLsync & fence = impl->m_fences[impl->m_currentFrame];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+GLint UniformBufferRing::offsetAlignment() const
+{
+    return impl->m_offsetAlignment;
+}
+
+
+//---------------------------------------------------------------------------------------
+GLuint UniformBufferRing::ubo() const
+{
+    return impl->m_ubo;
+}
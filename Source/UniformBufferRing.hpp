@@ -0,0 +1,55 @@
+//
+//  UniformBufferRing.hpp
+//
+
+#pragma once
+
+#include "NumericTypes.h"
+#import "GLPlatform.h"
+
+
+// Forward declaration
+class UniformBufferRingImpl;
+
+
+// A single uniform buffer divided into numFrames regions, one written per frame.
+// Regions are mapped unsynchronized, with fences ensuring the GPU has finished reading
+// a region before the CPU overwrites it.
+class UniformBufferRing {
+public:
+    UniformBufferRing();
+    
+    ~UniformBufferRing();
+    
+    // Allocates numFrames regions of bytesPerFrame each. The size of each region is
+    // rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+    void allocate (
+        GLsizeiptr bytesPerFrame,
+        uint numFrames
+    );
+    
+    // Advances to the next frame region, waiting for the GPU to release it if needed,
+    // and returns a write only pointer to it.
+    GLvoid * mapNextFrame();
+    
+    void unmap();
+    
+    // Binds [offset, offset + size) of the current frame region to bindingIndex.
+    // offset must be a multiple of offsetAlignment().
+    void bindRange (
+        GLuint bindingIndex,
+        GLintptr offset,
+        GLsizeiptr size
+    ) const;
+    
+    // Call after the last command reading the current frame region has been issued.
+    void fenceCurrentFrame();
+    
+    // Value of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+    GLint offsetAlignment() const;
+    
+    GLuint ubo() const;
+    
+private:
+    UniformBufferRingImpl * impl;
+};
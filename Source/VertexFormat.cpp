@@ -0,0 +1,176 @@
+//
+//  VertexFormat.cpp
+//
+
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "VertexAttributeDefines.h"
+
+
+namespace {
+    // Layout of VertexEncoding_Snorm16Octahedral and VertexEncoding_Snorm16Packed.
+    struct QuantizedVertex {
+        GLshort position[4];  // xyz, w pads the normal to 4 byte alignment.
+        GLuint normal;        // Octahedral snorm16 pair, or GL_INT_2_10_10_10_REV.
+    };
+    
+    
+    //-----------------------------------------------------------------------------------
+    GLshort toSnorm16 (
+        float value
+    ) {
+        const float clamped = std::min(std::max(value, -1.0f), 1.0f);
+        return static_cast<GLshort>(std::round(clamped * 32767.0f));
+    }
+    
+    
+    //-----------------------------------------------------------------------------------
+    // Projects the unit normal onto the octahedron |x| + |y| + |z| = 1, folding the
+    // lower half over the upper, as decode_octahedral_normal undoes.
+    GLuint encodeOctahedral (
+        const glm::vec3 & normal
+    ) {
+        const glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) +
+                                      std::abs(normal.z));
+        
+        glm::vec2 encoded(n.x, n.y);
+        if (n.z < 0.0f) {
+            encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        
+        const GLshort components[2] = { toSnorm16(encoded.x), toSnorm16(encoded.y) };
+        GLuint packed;
+        memcpy(&packed, components, sizeof(packed));
+        
+        return packed;
+    }
+    
+    
+    //-----------------------------------------------------------------------------------
+    GLuint encodeInt2101010 (
+        const glm::vec3 & normal
+    ) {
+        GLuint packed = 0;
+        for (int i = 0; i < 3; ++i) {
+            const float clamped = std::min(std::max(normal[i], -1.0f), 1.0f);
+            const GLint component = static_cast<GLint>(std::round(clamped * 511.0f));
+            packed |= (static_cast<GLuint>(component) & 0x3ff) << (10 * i);
+        }
+        
+        return packed;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+VertexFormat VertexFormat::forEncoding (
+    VertexEncoding encoding
+) {
+    VertexFormat format;
+    
+    switch (encoding) {
+        case VertexEncoding_Float:
+            format.stride = sizeof(FloatVertex);
+            format.attributes = {
+                {ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, 0},
+                {ATTRIBUTE_NORMAL,   3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat)}
+            };
+            break;
+            
+        // Positions are padded to 8 bytes, keeping the normal 4 byte aligned.
+        case VertexEncoding_Snorm16Octahedral:
+            format.stride = 4 * sizeof(GLshort) + sizeof(GLuint);
+            format.attributes = {
+                {ATTRIBUTE_POSITION, 3, GL_SHORT, GL_TRUE, 0},
+                {ATTRIBUTE_NORMAL,   2, GL_SHORT, GL_TRUE, 4 * sizeof(GLshort)}
+            };
+            break;
+            
+        case VertexEncoding_Snorm16Packed:
+            format.stride = 4 * sizeof(GLshort) + sizeof(GLuint);
+            format.attributes = {
+                {ATTRIBUTE_POSITION, 3, GL_SHORT, GL_TRUE, 0},
+                {ATTRIBUTE_NORMAL,   4, GL_INT_2_10_10_10_REV, GL_TRUE, 4 * sizeof(GLshort)}
+            };
+            break;
+    }
+    
+    return format;
+}
+
+
+//---------------------------------------------------------------------------------------
+void VertexFormat::setAttribPointers() const
+{
+    for (const VertexAttributeFormat & attribute : attributes) {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.numComponents, attribute.type,
+                              attribute.normalized, stride,
+                              reinterpret_cast<const GLvoid *>(attribute.offset));
+    }
+    
+    CHECK_GL_ERRORS;
+}
+
+
+//---------------------------------------------------------------------------------------
+EncodedVertices VertexFormat::encode (
+    const std::vector<FloatVertex> & vertices,
+    VertexEncoding encoding
+) {
+    EncodedVertices encoded;
+    encoded.positionScale = glm::vec3(1.0f);
+    encoded.positionBias = glm::vec3(0.0f);
+    
+    if (encoding == VertexEncoding_Float || vertices.empty()) {
+        const GLubyte * begin = reinterpret_cast<const GLubyte *>(vertices.data());
+        encoded.data.assign(begin, begin + vertices.size() * sizeof(FloatVertex));
+        return encoded;
+    }
+    
+    // Quantize positions over the bounds, scaled to [-1, 1] on each axis.
+    glm::vec3 lower = glm::make_vec3(vertices[0].position);
+    glm::vec3 upper = lower;
+    for (const FloatVertex & vertex : vertices) {
+        lower = glm::min(lower, glm::make_vec3(vertex.position));
+        upper = glm::max(upper, glm::make_vec3(vertex.position));
+    }
+    glm::vec3 & scale = encoded.positionScale;
+    glm::vec3 & bias = encoded.positionBias;
+    bias = 0.5f * (upper + lower);
+    scale = 0.5f * (upper - lower);
+    
+    // A flat axis has any scale.
+    for (int i = 0; i < 3; ++i) {
+        scale[i] = (scale[i] > 0.0f) ? scale[i] : 1.0f;
+    }
+    
+    encoded.data.resize(vertices.size() * sizeof(QuantizedVertex));
+    QuantizedVertex * quantizedVertices =
+        reinterpret_cast<QuantizedVertex *>(encoded.data.data());
+    
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const FloatVertex & vertex = vertices[i];
+        const glm::vec3 normal = glm::normalize(glm::make_vec3(vertex.normal));
+        const glm::vec3 quantized =
+            (glm::make_vec3(vertex.position) - bias) / scale;
+        
+        QuantizedVertex & out = quantizedVertices[i];
+        out.position[0] = toSnorm16(quantized.x);
+        out.position[1] = toSnorm16(quantized.y);
+        out.position[2] = toSnorm16(quantized.z);
+        out.position[3] = 0;
+        
+        out.normal = (encoding == VertexEncoding_Snorm16Octahedral) ?
+            encodeOctahedral(normal) : encodeInt2101010(normal);
+    }
+    
+    return encoded;
+}
@@ -0,0 +1,75 @@
+//
+//  VertexFormat.hpp
+//
+// Describes the interleaved layout of vertex data in a buffer, so the attribute
+// pointers of a VAO can be set from the description rather than hard-coded.
+//
+
+#pragma once
+
+#import "GLPlatform.h"
+#import <glm/glm.hpp>
+#import <vector>
+
+
+// Layouts a Mesh can store its vertices in.
+enum VertexEncoding {
+    // 24 bytes, float positions and normals.
+    VertexEncoding_Float = 0,
+    
+    // 12 bytes, snorm16 positions relative to the mesh bounds (see EncodedVertices)
+    // and octahedral snorm16 normals, decoded by decode_octahedral_normal in
+    // MeshDecoding.glsl.
+    VertexEncoding_Snorm16Octahedral = 1,
+    
+    // 12 bytes, snorm16 positions as above and GL_INT_2_10_10_10_REV normals, which
+    // need no decoding in the shader but keep 10 bits per component.
+    VertexEncoding_Snorm16Packed = 2
+};
+
+
+// Vertex before encoding, and the layout of VertexEncoding_Float.
+struct FloatVertex {
+    GLfloat position[3];
+    GLfloat normal[3];
+};
+
+
+// Vertex data stored in a VertexEncoding.
+struct EncodedVertices {
+    std::vector<GLubyte> data;
+    
+    // Quantized encodings store positions relative to the bounds of the vertices,
+    // which shaders map back with position * positionScale + positionBias.
+    glm::vec3 positionScale;
+    glm::vec3 positionBias;
+};
+
+
+// One vertex attribute, as passed to glVertexAttribPointer.
+struct VertexAttributeFormat {
+    GLuint location;  // ATTRIBUTE_* slot from VertexAttributeDefines.h.
+    GLint numComponents;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;    // Bytes from the start of the vertex.
+};
+
+
+struct VertexFormat {
+    GLsizei stride;
+    std::vector<VertexAttributeFormat> attributes;
+    
+    // Position and normal attributes of vertices stored in encoding.
+    static VertexFormat forEncoding (
+        VertexEncoding encoding
+    );
+    
+    // Enables and points each attribute of the bound VAO at the bound GL_ARRAY_BUFFER.
+    void setAttribPointers() const;
+    
+    static EncodedVertices encode (
+        const std::vector<FloatVertex> & vertices,
+        VertexEncoding encoding
+    );
+};
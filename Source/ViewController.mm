@@ -29,6 +29,8 @@
 
 - (void) layoutUIControls;
 
+- (void) writeFrameStatistics;
+
 
 
 - (UIFont *) labelFont;
@@ -107,6 +109,12 @@
                                                                  numCubes:numCubes
                                                                  maxCubes:MAX_NUMBER_OF_CUBES
                                                            cubeRandomness:cubeRandomness];
+    
+    // Leaving the foreground is the last reliable point before the app may be killed.
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(writeFrameStatistics)
+                                                 name:UIApplicationDidEnterBackgroundNotification
+                                               object:nil];
  
 }
 
@@ -288,9 +296,26 @@
 }
 
 
+//---------------------------------------------------------------------------------------
+// Logs the frame statistics report, and writes it to FrameStatistics.txt in the app's
+// Documents directory.
+- (void) writeFrameStatistics
+{
+    NSString * report = [_cubenadoRenderer frameStatisticsReport];
+    NSLog(@"%@", report);
+    
+    NSURL * documents = [[[NSFileManager defaultManager] URLsForDirectory:NSDocumentDirectory
+                                                                inDomains:NSUserDomainMask] firstObject];
+    NSURL * url = [documents URLByAppendingPathComponent:@"FrameStatistics.txt"];
+    [report writeToURL:url atomically:YES encoding:NSUTF8StringEncoding error:nil];
+}
+
+
 //---------------------------------------------------------------------------------------
 - (void)dealloc
 {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
     if ([EAGLContext currentContext] == self.eaglContext) {
         [EAGLContext setCurrentContext:nil];
     }
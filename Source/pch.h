@@ -16,8 +16,7 @@
 #endif
 
 #ifdef __cplusplus
-    #import <OpenGLES/ES3/gl.h>
-    #import <OpenGLES/ES3/glext.h>
+    #import "GLPlatform.h"
 
     #import "GLCheckErrors.h"
     #import "NumericTypes.h"
@@ -0,0 +1,622 @@
+//
+//  CubenadoBenchmark.cpp
+//
+// Sweeps cube count, cube randomness, framebuffer size, shadow technique and cube
+// geometry, timing each RenderStage in isolation and whole frames end to end.
+//
+// Usage: CubenadoBenchmark [options]
+//   --cubes LIST        Cube counts (default 10,100,1000,10000,100000,1000000,10000000).
+//   --randomness LIST   Cube randomness values (default 0,0.5,1).
+//   --resolutions LIST  Framebuffer sizes as WxH (default 375x667,750x1334).
+//   --shadows LIST      Any of depth, variance, splat (default depth).
+//   --geometry LIST     Any of mesh, procedural, faces (default mesh).
+//   --frames N          Timed frames per configuration and mode (default 60).
+//   --warmup N          Untimed frames before timing each configuration (default 10).
+//   --assets DIR        Directory holding the .glsl assets (default Assets).
+//   --csv FILE          Write results as CSV.
+//   --json FILE         Write results as JSON.
+//   --compare FILE      Compare against a baseline CSV written by --csv, and exit with
+//                       status 2 if any stage regressed.
+//   --threshold F       Relative p50 slowdown counted as a regression (default 0.10).
+//
+// Results are labelled with the shadow technique the renderer used, which differs from
+// the requested one where that is unsupported.
+//
+// Stage timings bracket each stage with glFinish, so they include GPU execution but
+// not overlap with neighbouring stages. The "frame" stage is measured in a separate
+// run with a single glFinish per frame.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "HeadlessContext.hpp"
+#include "OffscreenFramebuffer.hpp"
+#include "Renderer.hpp"
+
+
+// Simulation advances by a fixed step, so frames are reproducible run to run.
+static const double kSecondsPerFrame = 1.0 / 60.0;
+
+static const char * kFrameStageName = "frame";
+
+
+struct Options {
+    std::vector<uint> numCubes;
+    std::vector<float> cubeRandomness;
+    std::vector<FramebufferSize> framebufferSizes;
+    std::vector<ShadowTechnique> shadowTechniques;
+    std::vector<CubeGeometry> cubeGeometries;
+    uint numFrames = 60;
+    uint numWarmupFrames = 10;
+    std::string assetsPath = "Assets";
+    std::string csvPath;
+    std::string jsonPath;
+    std::string baselinePath;
+    double regressionThreshold = 0.10;
+};
+
+
+struct Configuration {
+    uint numCubes;
+    float cubeRandomness;
+    FramebufferSize framebufferSize;
+    ShadowTechnique shadowTechnique;
+    CubeGeometry cubeGeometry;
+};
+
+
+struct StageStatistics {
+    uint numSamples;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+};
+
+
+struct Result {
+    Configuration configuration;
+    std::string stage;
+    StageStatistics statistics;
+};
+
+
+// Times each stage between glFinish calls.
+class StageTimer : public RenderStageListener {
+public:
+    std::vector<double> samplesMs[RenderStage_Count];
+
+    void beginStage(RenderStage) override
+    {
+        glFinish();
+        m_stageStart = std::chrono::steady_clock::now();
+    }
+
+    void endStage(RenderStage stage) override
+    {
+        glFinish();
+        const auto stageEnd = std::chrono::steady_clock::now();
+        samplesMs[stage].push_back(
+            std::chrono::duration<double, std::milli>(stageEnd - m_stageStart).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_stageStart;
+};
+
+
+//---------------------------------------------------------------------------------------
+static const char * shadowTechniqueName (
+    ShadowTechnique shadowTechnique
+) {
+    switch (shadowTechnique) {
+        case ShadowTechnique_DepthCompare: return "depth";
+        case ShadowTechnique_Variance:     return "variance";
+        case ShadowTechnique_Splat:        return "splat";
+        case ShadowTechnique_Automatic:    return "auto";
+    }
+    return "unknown";
+}
+
+
+//---------------------------------------------------------------------------------------
+static const char * cubeGeometryName (
+    CubeGeometry cubeGeometry
+) {
+    switch (cubeGeometry) {
+        case CubeGeometry_Mesh:         return "mesh";
+        case CubeGeometry_Procedural:   return "procedural";
+        case CubeGeometry_VisibleFaces: return "faces";
+    }
+    return "unknown";
+}
+
+
+//---------------------------------------------------------------------------------------
+static std::vector<std::string> splitList (
+    const std::string & list
+) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+
+//---------------------------------------------------------------------------------------
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: CubenadoBenchmark [--cubes LIST] [--randomness LIST]\n"
+        "                         [--resolutions WxH,...] [--shadows LIST]\n"
+        "                         [--geometry LIST]\n"
+        "                         [--frames N] [--warmup N] [--assets DIR]\n"
+        "                         [--csv FILE] [--json FILE]\n"
+        "                         [--compare BASELINE.csv] [--threshold F]\n");
+}
+
+
+//---------------------------------------------------------------------------------------
+// Returns false on malformed arguments.
+static bool parseOptions (
+    int argc,
+    char ** argv,
+    Options & options
+) {
+    std::string cubesList = "10,100,1000,10000,100000,1000000,10000000";
+    std::string randomnessList = "0,0.5,1";
+    std::string resolutionsList = "375x667,750x1334";
+    std::string shadowsList = "depth";
+    std::string geometryList = "mesh";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            return false;
+        }
+        const char * value = argv[++i];
+
+        if (arg == "--cubes") {
+            cubesList = value;
+        } else if (arg == "--randomness") {
+            randomnessList = value;
+        } else if (arg == "--resolutions") {
+            resolutionsList = value;
+        } else if (arg == "--shadows") {
+            shadowsList = value;
+        } else if (arg == "--geometry") {
+            geometryList = value;
+        } else if (arg == "--frames") {
+            options.numFrames = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--warmup") {
+            options.numWarmupFrames = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--assets") {
+            options.assetsPath = value;
+        } else if (arg == "--csv") {
+            options.csvPath = value;
+        } else if (arg == "--json") {
+            options.jsonPath = value;
+        } else if (arg == "--compare") {
+            options.baselinePath = value;
+        } else if (arg == "--threshold") {
+            options.regressionThreshold = strtod(value, nullptr);
+        } else {
+            return false;
+        }
+    }
+
+    for (const std::string & item : splitList(cubesList)) {
+        const uint numCubes = static_cast<uint>(strtoul(item.c_str(), nullptr, 10));
+        if (numCubes == 0) {
+            return false;
+        }
+        options.numCubes.push_back(numCubes);
+    }
+
+    for (const std::string & item : splitList(randomnessList)) {
+        options.cubeRandomness.push_back(strtof(item.c_str(), nullptr));
+    }
+
+    for (const std::string & item : splitList(resolutionsList)) {
+        FramebufferSize size;
+        if (sscanf(item.c_str(), "%dx%d", &size.width, &size.height) != 2 ||
+            size.width <= 0 || size.height <= 0) {
+            return false;
+        }
+        options.framebufferSizes.push_back(size);
+    }
+
+    for (const std::string & item : splitList(shadowsList)) {
+        if (item == "depth") {
+            options.shadowTechniques.push_back(ShadowTechnique_DepthCompare);
+        } else if (item == "variance") {
+            options.shadowTechniques.push_back(ShadowTechnique_Variance);
+        } else if (item == "splat") {
+            options.shadowTechniques.push_back(ShadowTechnique_Splat);
+        } else {
+            return false;
+        }
+    }
+
+    for (const std::string & item : splitList(geometryList)) {
+        if (item == "mesh") {
+            options.cubeGeometries.push_back(CubeGeometry_Mesh);
+        } else if (item == "procedural") {
+            options.cubeGeometries.push_back(CubeGeometry_Procedural);
+        } else if (item == "faces") {
+            options.cubeGeometries.push_back(CubeGeometry_VisibleFaces);
+        } else {
+            return false;
+        }
+    }
+
+    return !options.numCubes.empty() && !options.cubeRandomness.empty() &&
+           !options.framebufferSizes.empty() && !options.shadowTechniques.empty() &&
+           !options.cubeGeometries.empty() && options.numFrames > 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Nearest rank percentile of sorted samples, for percentile in [0,100].
+static double percentile (
+    const std::vector<double> & sortedSamples,
+    double percentile
+) {
+    const size_t rank = static_cast<size_t>(
+        std::ceil(percentile / 100.0 * sortedSamples.size()));
+    return sortedSamples[std::max<size_t>(rank, 1) - 1];
+}
+
+
+//---------------------------------------------------------------------------------------
+static StageStatistics computeStatistics (
+    std::vector<double> samples
+) {
+    StageStatistics statistics = {};
+    statistics.numSamples = static_cast<uint>(samples.size());
+    if (samples.empty()) {
+        return statistics;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+    for (double sample : samples) {
+        total += sample;
+    }
+
+    statistics.meanMs = total / samples.size();
+    statistics.p50Ms = percentile(samples, 50.0);
+    statistics.p95Ms = percentile(samples, 95.0);
+    statistics.p99Ms = percentile(samples, 99.0);
+
+    return statistics;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Appends one Result per stage and one for the whole frame.
+static void runConfiguration (
+    Renderer & renderer,
+    const OffscreenFramebuffer & framebuffer,
+    const Configuration & configuration,
+    const Options & options,
+    std::vector<Result> & results
+) {
+    renderer.setNumCubes(configuration.numCubes);
+    renderer.setCubeRandomness(configuration.cubeRandomness);
+    renderer.setShadowTechnique(configuration.shadowTechnique);
+    renderer.setCubeGeometry(configuration.cubeGeometry);
+
+    const GLuint target = framebuffer.framebuffer();
+    const FramebufferSize size = configuration.framebufferSize;
+
+    for (uint i = 0; i < options.numWarmupFrames; ++i) {
+        renderer.update(kSecondsPerFrame);
+        renderer.render(target, size);
+    }
+
+    // Stages in isolation.
+    StageTimer stageTimer;
+    renderer.setRenderStageListener(&stageTimer);
+    for (uint i = 0; i < options.numFrames; ++i) {
+        renderer.update(kSecondsPerFrame);
+        renderer.render(target, size);
+    }
+    renderer.setRenderStageListener(nullptr);
+
+    // End to end, letting stages overlap as they would in the app.
+    glFinish();
+    std::vector<double> frameSamplesMs;
+    for (uint i = 0; i < options.numFrames; ++i) {
+        const auto frameStart = std::chrono::steady_clock::now();
+        renderer.update(kSecondsPerFrame);
+        renderer.render(target, size);
+        glFinish();
+        const auto frameEnd = std::chrono::steady_clock::now();
+        frameSamplesMs.push_back(
+            std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+    }
+
+    Result result;
+    result.configuration = configuration;
+    result.configuration.shadowTechnique = renderer.activeShadowTechnique();
+    for (int stage = 0; stage < RenderStage_Count; ++stage) {
+        result.stage = renderStageName(static_cast<RenderStage>(stage));
+        result.statistics = computeStatistics(stageTimer.samplesMs[stage]);
+        results.push_back(result);
+    }
+
+    result.stage = kFrameStageName;
+    result.statistics = computeStatistics(frameSamplesMs);
+    results.push_back(result);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Identifies a result across runs, for comparison against a baseline.
+static std::string resultKey (
+    const Configuration & configuration,
+    const std::string & stage
+) {
+    char key[256];
+    snprintf(key, sizeof(key), "%u,%.3f,%d,%d,%s,%s,%s", configuration.numCubes,
+             configuration.cubeRandomness, configuration.framebufferSize.width,
+             configuration.framebufferSize.height,
+             shadowTechniqueName(configuration.shadowTechnique),
+             cubeGeometryName(configuration.cubeGeometry), stage.c_str());
+    return key;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writeCSV (
+    const std::string & path,
+    const std::vector<Result> & results
+) {
+    FILE * file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "cubes,randomness,width,height,shadow,geometry,stage,"
+                  "samples,mean_ms,p50_ms,p95_ms,p99_ms\n");
+    for (const Result & result : results) {
+        const StageStatistics & s = result.statistics;
+        fprintf(file, "%s,%u,%.4f,%.4f,%.4f,%.4f\n",
+                resultKey(result.configuration, result.stage).c_str(),
+                s.numSamples, s.meanMs, s.p50Ms, s.p95Ms, s.p99Ms);
+    }
+
+    fclose(file);
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writeJSON (
+    const std::string & path,
+    const std::string & rendererName,
+    const std::vector<Result> & results
+) {
+    FILE * file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"renderer\": \"%s\",\n  \"results\": [\n", rendererName.c_str());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Configuration & c = results[i].configuration;
+        const StageStatistics & s = results[i].statistics;
+        fprintf(file,
+            "    {\"cubes\": %u, \"randomness\": %.3f, \"width\": %d, \"height\": %d, "
+            "\"shadow\": \"%s\", \"geometry\": \"%s\", \"stage\": \"%s\", "
+            "\"samples\": %u, "
+            "\"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f}%s\n",
+            c.numCubes, c.cubeRandomness, c.framebufferSize.width,
+            c.framebufferSize.height, shadowTechniqueName(c.shadowTechnique),
+            cubeGeometryName(c.cubeGeometry), results[i].stage.c_str(), s.numSamples, s.meanMs, s.p50Ms, s.p95Ms,
+            s.p99Ms, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Reads p50 per result key from a CSV written by writeCSV().
+static bool readBaselineCSV (
+    const std::string & path,
+    std::map<std::string, double> & p50MsByKey
+) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);  // Header
+
+    // Baselines written before the geometry column all used the mesh.
+    const bool hasGeometry = line.find(",geometry,") != std::string::npos;
+    const int numKeyFields = hasGeometry ? 7 : 6;
+
+    while (std::getline(file, line)) {
+        // Key is the leading fields, followed by samples, mean, p50, ...
+        size_t pos = 0;
+        for (int field = 0; field < numKeyFields && pos != std::string::npos; ++field) {
+            pos = line.find(',', pos + 1);
+        }
+        if (pos == std::string::npos) {
+            continue;
+        }
+
+        const std::vector<std::string> values = splitList(line.substr(pos + 1));
+        if (values.size() < 3) {
+            continue;
+        }
+
+        std::string key = line.substr(0, pos);
+        if (!hasGeometry) {
+            key.insert(key.rfind(','), ",mesh");
+        }
+        p50MsByKey[key] = strtod(values[2].c_str(), nullptr);
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Prints each result slower than the baseline by more than threshold.
+// Returns the number of regressions.
+static uint compareToBaseline (
+    const std::vector<Result> & results,
+    const std::map<std::string, double> & baselineP50MsByKey,
+    double threshold
+) {
+    uint numRegressions = 0;
+    for (const Result & result : results) {
+        const std::string key = resultKey(result.configuration, result.stage);
+        auto baseline = baselineP50MsByKey.find(key);
+        if (baseline == baselineP50MsByKey.end()) {
+            printf("  new       %s\n", key.c_str());
+            continue;
+        }
+
+        const double baselineMs = baseline->second;
+        const double currentMs = result.statistics.p50Ms;
+        const double change = (baselineMs > 0.0) ? (currentMs / baselineMs - 1.0) : 0.0;
+
+        if (change > threshold) {
+            printf("  REGRESSED %s: p50 %.3f ms -> %.3f ms (%+.1f%%)\n", key.c_str(),
+                   baselineMs, currentMs, change * 100.0);
+            ++numRegressions;
+        } else if (change < -threshold) {
+            printf("  improved  %s: p50 %.3f ms -> %.3f ms (%+.1f%%)\n", key.c_str(),
+                   baselineMs, currentMs, change * 100.0);
+        }
+    }
+    return numRegressions;
+}
+
+
+//---------------------------------------------------------------------------------------
+int main (
+    int argc,
+    char ** argv
+) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Result> results;
+    std::string rendererName;
+
+    try {
+        HeadlessContext context;
+        rendererName = context.rendererName();
+        printf("renderer: %s\n", rendererName.c_str());
+
+        AssetDirectory assetDirectory = buildAssetDirectory(options.assetsPath, ".glsl");
+        if (assetDirectory.empty()) {
+            fprintf(stderr, "No .glsl assets found in '%s'.\n",
+                    options.assetsPath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        // Renderer sizes particle buffers by cube count and shadow maps by framebuffer
+        // size, so one is created per pair and reused across the remaining parameters.
+        for (FramebufferSize size : options.framebufferSizes) {
+            OffscreenFramebuffer framebuffer(size);
+
+            for (uint numCubes : options.numCubes) {
+                Renderer renderer(assetDirectory, size, numCubes, numCubes,
+                                  options.cubeRandomness.front());
+
+                for (float cubeRandomness : options.cubeRandomness) {
+                    for (ShadowTechnique shadowTechnique : options.shadowTechniques) {
+                        for (CubeGeometry cubeGeometry : options.cubeGeometries) {
+                            const Configuration configuration = {
+                                numCubes, cubeRandomness, size, shadowTechnique,
+                                cubeGeometry
+                            };
+
+                            const size_t firstResult = results.size();
+                            runConfiguration(renderer, framebuffer, configuration,
+                                             options, results);
+
+                            printf("%8u cubes, randomness %.2f, %dx%d, %-8s %-10s",
+                                   numCubes, cubeRandomness, size.width, size.height,
+                                   shadowTechniqueName(
+                                       results[firstResult].configuration.shadowTechnique),
+                                   cubeGeometryName(cubeGeometry));
+                            for (size_t i = firstResult; i < results.size(); ++i) {
+                                printf("  %s %.2f", results[i].stage.c_str(),
+                                       results[i].statistics.p50Ms);
+                            }
+                            printf("  (p50 ms)\n");
+                            fflush(stdout);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    catch (const std::exception & e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    if (!options.csvPath.empty() && !writeCSV(options.csvPath, results)) {
+        fprintf(stderr, "Unable to write '%s'.\n", options.csvPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (!options.jsonPath.empty() && !writeJSON(options.jsonPath, rendererName, results)) {
+        fprintf(stderr, "Unable to write '%s'.\n", options.jsonPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (!options.baselinePath.empty()) {
+        std::map<std::string, double> baselineP50MsByKey;
+        if (!readBaselineCSV(options.baselinePath, baselineP50MsByKey)) {
+            fprintf(stderr, "Unable to read '%s'.\n", options.baselinePath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        printf("Comparing p50 against %s (threshold %.0f%%):\n",
+               options.baselinePath.c_str(), options.regressionThreshold * 100.0);
+        const uint numRegressions = compareToBaseline(results, baselineP50MsByKey,
+                                                      options.regressionThreshold);
+        printf("%u regression(s)\n", numRegressions);
+
+        if (numRegressions > 0) {
+            return 2;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
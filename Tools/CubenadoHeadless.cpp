@@ -0,0 +1,479 @@
+//
+//  CubenadoHeadless.cpp
+//
+// Renders Cubenado frames into an offscreen framebuffer with no window or display
+// server, and reports per frame timings.
+//
+// Usage: CubenadoHeadless [options]
+//   --cubes N          Number of cubes to simulate (default 10000).
+//   --max-cubes N      Capacity of the particle buffers (default max(cubes, 10000)).
+//   --randomness R     Cube randomness in [0,1] (default 0.3).
+//   --width W          Framebuffer width (default 750).
+//   --height H         Framebuffer height (default 1334).
+//   --frames N         Number of timed frames (default 300).
+//   --warmup N         Untimed frames rendered first (default 30).
+//   --shadow S         auto, depth, variance or splat (default auto, splat from 100K
+//                      cubes and depth below).
+//   --cube-geometry G  mesh, procedural or faces (default mesh).
+//   --impostors PX     Draw cubes fewer than PX pixels across as impostors (default 0,
+//                      off).
+//   --mesh FILE        Draw the mesh FILE, written by ImportMesh, in place of the cube
+//                      with --cube-geometry mesh.
+//   --assets DIR       Directory holding the .glsl assets (default Assets).
+//   --asset-pack FILE  Memory map assets from the pack FILE instead, or from the pack
+//                      compiled in by CUBENADO_EMBED_ASSETS if FILE is "embedded".
+//   --output FILE      Write per frame timings as CSV to FILE.
+//   --image FILE       Write the last frame to FILE as a binary PPM.
+//   --hitch-ms T       Report frames slower than T milliseconds (default 50).
+//   --gl-debug S       Log KHR_debug messages of severity S or above: high, medium,
+//                      low or notification (default off).
+//   --error-check M    glGetError checking in builds with CHECK_GL_ERRORS: every,
+//                      sampled or off (default every in Debug, else sampled).
+//   --shader-cache DIR Cache linked program binaries in DIR (default off).
+//   --trace FILE       Write a Chrome trace of CPU profile scopes to FILE, covering
+//                      setup and every frame.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "AssetPack.hpp"
+#include "HeadlessContext.hpp"
+#include "OffscreenFramebuffer.hpp"
+#include "Renderer.hpp"
+#include "Profiler.hpp"
+#include "FrameStatistics.hpp"
+#include "GLDebugOutput.hpp"
+#include "ProgramBinaryCache.hpp"
+
+
+// Simulation advances by a fixed step, so frames are reproducible run to run.
+static const double kSecondsPerFrame = 1.0 / 60.0;
+
+
+struct Options {
+    uint numCubes = 10000;
+    uint maxCubes = 0;
+    float cubeRandomness = 0.3f;
+    FramebufferSize framebufferSize = {750, 1334};
+    uint numFrames = 300;
+    uint numWarmupFrames = 30;
+    ShadowTechnique shadowTechnique = ShadowTechnique_Automatic;
+    CubeGeometry cubeGeometry = CubeGeometry_Mesh;
+    float impostorThreshold = 0.0f;
+    std::string meshPath;
+    std::string assetsPath = "Assets";
+    std::string assetPackPath;
+    std::string outputPath;
+    std::string imagePath;
+    std::string tracePath;
+    std::string shaderCachePath;
+    double hitchThresholdMs = 50.0;
+    bool glDebugOutput = false;
+    GLDebugSeverity glDebugSeverity = GLDebugSeverity_Medium;
+    GLErrorCheckMode errorCheckMode = glErrorCheckMode();
+};
+
+
+struct FrameTiming {
+    double updateMs;
+    double renderMs;
+    double frameMs;
+};
+
+
+//---------------------------------------------------------------------------------------
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: CubenadoHeadless [--cubes N] [--max-cubes N] [--randomness R]\n"
+        "                        [--width W] [--height H] [--frames N] [--warmup N]\n"
+        "                        [--shadow auto|depth|variance|splat]\n"
+        "                        [--assets DIR]\n"
+        "                        [--cube-geometry mesh|procedural|faces] [--impostors PX]\n"
+        "                        [--mesh FILE.mesh]\n"
+        "                        [--asset-pack FILE|embedded]\n"
+        "                        [--output FILE.csv] [--image FILE.ppm]\n"
+        "                        [--hitch-ms T] [--trace FILE.json]\n"
+        "                        [--gl-debug high|medium|low|notification]\n"
+        "                        [--error-check every|sampled|off]\n"
+        "                        [--shader-cache DIR]\n");
+}
+
+
+//---------------------------------------------------------------------------------------
+// Returns false on malformed arguments.
+static bool parseOptions (
+    int argc,
+    char ** argv,
+    Options & options
+) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            return false;
+        }
+        const char * value = argv[++i];
+
+        if (arg == "--cubes") {
+            options.numCubes = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--max-cubes") {
+            options.maxCubes = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--randomness") {
+            options.cubeRandomness = strtof(value, nullptr);
+        } else if (arg == "--width") {
+            options.framebufferSize.width = atoi(value);
+        } else if (arg == "--height") {
+            options.framebufferSize.height = atoi(value);
+        } else if (arg == "--frames") {
+            options.numFrames = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--warmup") {
+            options.numWarmupFrames = static_cast<uint>(strtoul(value, nullptr, 10));
+        } else if (arg == "--assets") {
+            options.assetsPath = value;
+        } else if (arg == "--asset-pack") {
+            options.assetPackPath = value;
+        } else if (arg == "--output") {
+            options.outputPath = value;
+        } else if (arg == "--image") {
+            options.imagePath = value;
+        } else if (arg == "--hitch-ms") {
+            options.hitchThresholdMs = strtod(value, nullptr);
+        } else if (arg == "--shader-cache") {
+            options.shaderCachePath = value;
+        } else if (arg == "--trace") {
+            options.tracePath = value;
+        } else if (arg == "--gl-debug") {
+            options.glDebugOutput = true;
+            if (strcmp(value, "high") == 0) {
+                options.glDebugSeverity = GLDebugSeverity_High;
+            } else if (strcmp(value, "medium") == 0) {
+                options.glDebugSeverity = GLDebugSeverity_Medium;
+            } else if (strcmp(value, "low") == 0) {
+                options.glDebugSeverity = GLDebugSeverity_Low;
+            } else if (strcmp(value, "notification") == 0) {
+                options.glDebugSeverity = GLDebugSeverity_Notification;
+            } else {
+                return false;
+            }
+        } else if (arg == "--error-check") {
+            if (strcmp(value, "every") == 0) {
+                options.errorCheckMode = GLErrorCheckMode_EveryCall;
+            } else if (strcmp(value, "sampled") == 0) {
+                options.errorCheckMode = GLErrorCheckMode_Sampled;
+            } else if (strcmp(value, "off") == 0) {
+                options.errorCheckMode = GLErrorCheckMode_Off;
+            } else {
+                return false;
+            }
+        } else if (arg == "--shadow") {
+            if (strcmp(value, "auto") == 0) {
+                options.shadowTechnique = ShadowTechnique_Automatic;
+            } else if (strcmp(value, "depth") == 0) {
+                options.shadowTechnique = ShadowTechnique_DepthCompare;
+            } else if (strcmp(value, "variance") == 0) {
+                options.shadowTechnique = ShadowTechnique_Variance;
+            } else if (strcmp(value, "splat") == 0) {
+                options.shadowTechnique = ShadowTechnique_Splat;
+            } else {
+                return false;
+            }
+        } else if (arg == "--impostors") {
+            options.impostorThreshold = strtof(value, nullptr);
+        } else if (arg == "--mesh") {
+            options.meshPath = value;
+        } else if (arg == "--cube-geometry") {
+            if (strcmp(value, "mesh") == 0) {
+                options.cubeGeometry = CubeGeometry_Mesh;
+            } else if (strcmp(value, "procedural") == 0) {
+                options.cubeGeometry = CubeGeometry_Procedural;
+            } else if (strcmp(value, "faces") == 0) {
+                options.cubeGeometry = CubeGeometry_VisibleFaces;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (options.maxCubes == 0) {
+        options.maxCubes = std::max(options.numCubes, 10000u);
+    }
+
+    return options.numCubes <= options.maxCubes &&
+           options.framebufferSize.width > 0 &&
+           options.framebufferSize.height > 0 &&
+           options.numFrames > 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+static double millisecondsBetween (
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end
+) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writeTimingsCSV (
+    const std::string & path,
+    const std::vector<FrameTiming> & timings
+) {
+    FILE * file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "frame,update_ms,render_ms,frame_ms\n");
+    for (size_t i = 0; i < timings.size(); ++i) {
+        fprintf(file, "%zu,%.4f,%.4f,%.4f\n", i, timings[i].updateMs,
+                timings[i].renderMs, timings[i].frameMs);
+    }
+
+    fclose(file);
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writePPM (
+    const std::string & path,
+    const OffscreenFramebuffer & framebuffer
+) {
+    std::vector<uint8> pixels;
+    framebuffer.readPixelsRGB(pixels);
+
+    FILE * file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    const FramebufferSize size = framebuffer.size();
+    fprintf(file, "P6\n%d %d\n255\n", size.width, size.height);
+    fwrite(pixels.data(), 1, pixels.size(), file);
+
+    fclose(file);
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+int main (
+    int argc,
+    char ** argv
+) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    // Enabled before the Renderer is created, so its setup is traced too.
+    Profiler::setEnabled(!options.tracePath.empty());
+
+    try {
+        HeadlessContext context;
+
+        setGLErrorCheckMode(options.errorCheckMode);
+        if (options.glDebugOutput && !GLDebugOutput::enable(options.glDebugSeverity)) {
+            fprintf(stderr, "GL_KHR_debug is unsupported, --gl-debug ignored.\n");
+        }
+
+        AssetDirectory assetDirectory;
+        if (options.assetPackPath.empty()) {
+            assetDirectory = buildAssetDirectory(options.assetsPath, ".glsl");
+        } else {
+            const bool opened = (options.assetPackPath == "embedded") ?
+                AssetPack::openEmbedded() : AssetPack::open(options.assetPackPath);
+            if (!opened) {
+                fprintf(stderr, "Cannot open asset pack '%s'.\n",
+                        options.assetPackPath.c_str());
+                return EXIT_FAILURE;
+            }
+            assetDirectory = AssetPack::buildAssetDirectory(".glsl");
+        }
+
+        if (assetDirectory.empty()) {
+            fprintf(stderr, "No .glsl assets found in '%s'.\n",
+                    options.assetPackPath.empty() ? options.assetsPath.c_str()
+                                                  : options.assetPackPath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        OffscreenFramebuffer framebuffer(options.framebufferSize);
+
+        ProgramBinaryCache::setDirectory(options.shaderCachePath);
+
+        const auto setupStart = std::chrono::steady_clock::now();
+        Renderer renderer(assetDirectory, options.framebufferSize, options.numCubes,
+                          options.maxCubes, options.cubeRandomness);
+        renderer.setShadowTechnique(options.shadowTechnique);
+        if (!options.meshPath.empty() && !renderer.loadCubeMesh(options.meshPath)) {
+            fprintf(stderr, "Cannot load mesh '%s'.\n", options.meshPath.c_str());
+            return EXIT_FAILURE;
+        }
+        renderer.setCubeGeometry(options.cubeGeometry);
+        renderer.setImpostorThreshold(options.impostorThreshold);
+        const double setupMs = millisecondsBetween(setupStart,
+                                                   std::chrono::steady_clock::now());
+
+        for (uint i = 0; i < options.numWarmupFrames; ++i) {
+            PROFILE_SCOPE("frame");
+            renderer.update(kSecondsPerFrame);
+            renderer.render(framebuffer.framebuffer(), options.framebufferSize);
+        }
+        glFinish();
+
+        // glFinish after each frame so frame times include GPU execution, rather than
+        // only the CPU cost of queuing commands.
+        std::vector<FrameTiming> timings(options.numFrames);
+
+        // Sum of GPU stage times over timed frames, from results as they complete.
+        double gpuStageMs[RenderStage_Count] = {};
+        uint numGpuFrames = 0;
+        uint64 lastGpuFrame = ~0ull;
+
+        FrameStatistics frameStatistics(options.hitchThresholdMs);
+
+        for (uint i = 0; i < options.numFrames; ++i) {
+            PROFILE_SCOPE("frame");
+
+            const auto frameStart = std::chrono::steady_clock::now();
+            renderer.update(kSecondsPerFrame);
+
+            const auto updateEnd = std::chrono::steady_clock::now();
+            renderer.render(framebuffer.framebuffer(), options.framebufferSize);
+
+            const auto renderEnd = std::chrono::steady_clock::now();
+            {
+                PROFILE_SCOPE("glFinish");
+                glFinish();
+            }
+
+            const auto frameEnd = std::chrono::steady_clock::now();
+            timings[i].updateMs = millisecondsBetween(frameStart, updateEnd);
+            timings[i].renderMs = millisecondsBetween(updateEnd, renderEnd);
+            timings[i].frameMs = millisecondsBetween(frameStart, frameEnd);
+            
+            GpuStageTimes gpuStageTimes;
+            const bool hasGpuStageTimes = renderer.latestGpuStageTimes(gpuStageTimes);
+            frameStatistics.recordFrame(timings[i].frameMs, timings[i].updateMs,
+                                        timings[i].renderMs,
+                                        hasGpuStageTimes ? &gpuStageTimes : nullptr);
+
+            if (hasGpuStageTimes && gpuStageTimes.frameNumber != lastGpuFrame) {
+                lastGpuFrame = gpuStageTimes.frameNumber;
+                for (int stage = 0; stage < RenderStage_Count; ++stage) {
+                    gpuStageMs[stage] += gpuStageTimes.milliseconds[stage];
+                }
+                ++numGpuFrames;
+            }
+        }
+
+        double totalFrameMs = 0.0;
+        double minFrameMs = timings[0].frameMs;
+        double maxFrameMs = timings[0].frameMs;
+        for (const FrameTiming & timing : timings) {
+            totalFrameMs += timing.frameMs;
+            minFrameMs = std::min(minFrameMs, timing.frameMs);
+            maxFrameMs = std::max(maxFrameMs, timing.frameMs);
+        }
+        const double meanFrameMs = totalFrameMs / timings.size();
+
+        printf("renderer:   %s%s\n", context.rendererName().c_str(),
+               context.isSurfaceless() ? "" : " (pbuffer)");
+        printf("cubes:      %u (max %u), randomness %.2f\n", options.numCubes,
+               options.maxCubes, options.cubeRandomness);
+        printf("resolution: %dx%d\n", options.framebufferSize.width,
+               options.framebufferSize.height);
+        printf("setup ms:   %.3f (%u shader links pending at first use)\n", setupMs,
+               renderer.numProgramsLinkingAtSetup());
+        if (ProgramBinaryCache::isEnabled()) {
+            printf("shader cache: %u hits, %u misses, %u rejected\n",
+                   ProgramBinaryCache::numHits(), ProgramBinaryCache::numMisses(),
+                   ProgramBinaryCache::numRejected());
+        }
+        printf("frames:     %u\n", options.numFrames);
+        printf("frame ms:   mean %.3f, min %.3f, max %.3f (%.1f fps)\n", meanFrameMs,
+               minFrameMs, maxFrameMs, 1000.0 / meanFrameMs);
+
+        if (numGpuFrames > 0) {
+            printf("gpu ms:     mean over %u frames\n", numGpuFrames);
+            for (int stage = 0; stage < RenderStage_Count; ++stage) {
+                printf("  %-16s %.3f\n", renderStageName(static_cast<RenderStage>(stage)),
+                       gpuStageMs[stage] / numGpuFrames);
+            }
+        } else {
+            printf("gpu ms:     unavailable\n");
+        }
+
+        PipelineStatistics pipelineStatistics;
+        if (renderer.latestPipelineStatistics(pipelineStatistics)) {
+            printf("pipeline:   frame %llu\n",
+                   static_cast<unsigned long long>(pipelineStatistics.frameNumber));
+            printf("  tf primitives    %llu\n", static_cast<unsigned long long>(
+                   pipelineStatistics.transformFeedbackPrimitivesWritten));
+            printf("  draw calls       %llu\n",
+                   static_cast<unsigned long long>(pipelineStatistics.numDrawCalls));
+            printf("  state changes    %llu (%llu elided)\n",
+                   static_cast<unsigned long long>(pipelineStatistics.numStateChanges),
+                   static_cast<unsigned long long>(pipelineStatistics.numElidedStateChanges));
+            printf("  bytes uploaded   %llu\n",
+                   static_cast<unsigned long long>(pipelineStatistics.numBytesUploaded));
+            printf("  uniform uploads  %llu (%llu skipped)\n",
+                   static_cast<unsigned long long>(pipelineStatistics.numUniformUploads),
+                   static_cast<unsigned long long>(
+                       pipelineStatistics.numSkippedUniformUploads));
+            printf("  vertex fetch     %llu bytes\n",
+                   static_cast<unsigned long long>(pipelineStatistics.numVertexFetchBytes));
+            printf("  samples passed  ");
+            for (int stage = 0; stage < RenderStage_Count; ++stage) {
+                printf(" %s %s", renderStageName(static_cast<RenderStage>(stage)),
+                       pipelineStatistics.anySamplesPassed[stage] ? "yes" : "no");
+            }
+            printf("\n");
+        }
+
+        printf("%s", frameStatistics.report().c_str());
+
+        if (options.glDebugOutput) {
+            printf("gl debug:   %llu messages, %llu not logged\n",
+                   static_cast<unsigned long long>(GLDebugOutput::numMessages()),
+                   static_cast<unsigned long long>(GLDebugOutput::numSuppressedMessages()));
+        }
+
+        if (!options.outputPath.empty() && !writeTimingsCSV(options.outputPath, timings)) {
+            fprintf(stderr, "Unable to write '%s'.\n", options.outputPath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (!options.imagePath.empty() && !writePPM(options.imagePath, framebuffer)) {
+            fprintf(stderr, "Unable to write '%s'.\n", options.imagePath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (!options.tracePath.empty()) {
+            Profiler::setEnabled(false);
+            if (!Profiler::writeChromeTrace(options.tracePath)) {
+                fprintf(stderr, "Unable to write '%s'.\n", options.tracePath.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception & e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,335 @@
+//
+//  ImportMesh.cpp
+//
+// Converts a Wavefront OBJ mesh to a MeshFile for Mesh::load. Triangles are reordered
+// for the vertex cache and overdraw, and vertices for fetch, so loading only maps the
+// file and uploads it.
+//
+// Usage: ImportMesh [--encoding float|octahedral|packed] OUTPUT INPUT.obj
+//   --encoding    Vertex encoding, octahedral by default.
+//
+// Only v, vn and f statements are read. Polygons are split into triangle fans, and
+// smooth normals are computed for faces without them.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MeshFile.hpp"
+#include "MeshOptimizer.hpp"
+#include "VertexFormat.hpp"
+
+
+// Position and normal indices of one face corner, normal -1 if it has none.
+typedef std::pair<int, int> Corner;
+
+
+//---------------------------------------------------------------------------------------
+// Resolves a 1 based OBJ index, or a negative one relative to the end of the list.
+static bool resolveIndex (
+    long index,
+    size_t count,
+    int & resolved
+) {
+    if (index > 0 && size_t(index) <= count) {
+        resolved = int(index - 1);
+        return true;
+    }
+    if (index < 0 && size_t(-index) <= count) {
+        resolved = int(count + index);
+        return true;
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool readObj (
+    const std::string & path,
+    std::vector<glm::vec3> & positions,
+    std::vector<glm::vec3> & normals,
+    std::vector<Corner> & corners
+) {
+    FILE * file = fopen(path.c_str(), "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open '%s'.\n", path.c_str());
+        return false;
+    }
+
+    bool succeeded = true;
+    int lineNumber = 0;
+    char line[4096];
+    while (succeeded && fgets(line, sizeof(line), file)) {
+        ++lineNumber;
+
+        glm::vec3 v;
+        if (strncmp(line, "v ", 2) == 0) {
+            succeeded = sscanf(line + 2, "%f %f %f", &v.x, &v.y, &v.z) == 3;
+            positions.push_back(v);
+        } else if (strncmp(line, "vn ", 3) == 0) {
+            succeeded = sscanf(line + 3, "%f %f %f", &v.x, &v.y, &v.z) == 3;
+            normals.push_back(v);
+        } else if (strncmp(line, "f ", 2) == 0) {
+            // Corners are v, v/vt, v//vn or v/vt/vn.
+            std::vector<Corner> polygon;
+            char * cursor = line + 2;
+            while (succeeded) {
+                char * end;
+                const long position = strtol(cursor, &end, 10);
+                if (end == cursor) {
+                    break;
+                }
+                cursor = end;
+
+                Corner corner(0, -1);
+                succeeded = resolveIndex(position, positions.size(), corner.first);
+
+                if (*cursor == '/') {
+                    strtol(++cursor, &end, 10);
+                    cursor = end;
+                    if (*cursor == '/') {
+                        const long normal = strtol(++cursor, &end, 10);
+                        cursor = end;
+                        succeeded = succeeded &&
+                                    resolveIndex(normal, normals.size(), corner.second);
+                    }
+                }
+                polygon.push_back(corner);
+            }
+
+            succeeded = succeeded && polygon.size() >= 3;
+            for (size_t i = 2; succeeded && i < polygon.size(); ++i) {
+                corners.push_back(polygon[0]);
+                corners.push_back(polygon[i - 1]);
+                corners.push_back(polygon[i]);
+            }
+        }
+    }
+    fclose(file);
+
+    if (!succeeded) {
+        fprintf(stderr, "%s:%d: Cannot parse '%s'.\n", path.c_str(), lineNumber,
+                strtok(line, "\r\n"));
+    }
+
+    return succeeded;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Gives corners without a normal the area weighted normal of their position's faces.
+static void computeMissingNormals (
+    const std::vector<glm::vec3> & positions,
+    std::vector<glm::vec3> & normals,
+    std::vector<Corner> & corners
+) {
+    std::vector<glm::vec3> smoothNormals(positions.size(), glm::vec3(0.0f));
+    bool missing = false;
+    for (size_t i = 0; i < corners.size(); i += 3) {
+        const glm::vec3 & p0 = positions[corners[i].first];
+        const glm::vec3 & p1 = positions[corners[i + 1].first];
+        const glm::vec3 & p2 = positions[corners[i + 2].first];
+        const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+
+        for (size_t k = i; k < i + 3; ++k) {
+            smoothNormals[corners[k].first] += areaNormal;
+            missing = missing || corners[k].second < 0;
+        }
+    }
+
+    if (!missing) {
+        return;
+    }
+
+    const int firstSmoothNormal = int(normals.size());
+    for (const glm::vec3 & normal : smoothNormals) {
+        const float length = glm::length(normal);
+        normals.push_back((length > 0.0f) ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    for (Corner & corner : corners) {
+        if (corner.second < 0) {
+            corner.second = firstSmoothNormal + corner.first;
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Makes one vertex of each distinct position and normal pair. Triangles using a
+// position more than once cover no pixels, and are dropped.
+static void buildVertices (
+    const std::vector<glm::vec3> & positions,
+    const std::vector<glm::vec3> & normals,
+    const std::vector<Corner> & corners,
+    std::vector<FloatVertex> & vertices,
+    std::vector<uint32> & indices
+) {
+    std::map<Corner, uint32> cornerVertices;
+    indices.reserve(corners.size());
+
+    for (size_t i = 0; i < corners.size(); i += 3) {
+        const Corner * triangle = &corners[i];
+        if (triangle[0].first == triangle[1].first ||
+            triangle[1].first == triangle[2].first ||
+            triangle[2].first == triangle[0].first)
+        {
+            continue;
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            const Corner & corner = triangle[k];
+            auto inserted = cornerVertices.insert(std::make_pair(corner,
+                                                                 uint32(vertices.size())));
+            if (inserted.second) {
+                const glm::vec3 & position = positions[corner.first];
+                const glm::vec3 normal = glm::normalize(normals[corner.second]);
+                vertices.push_back({
+                    { position.x, position.y, position.z },
+                    { normal.x, normal.y, normal.z }
+                });
+            }
+            indices.push_back(inserted.first->second);
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static size_t alignTo4 (
+    size_t offset
+) {
+    return (offset + 3) & ~size_t(3);
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writeMeshFile (
+    const std::string & path,
+    const EncodedVertices & encoded,
+    VertexEncoding encoding,
+    size_t numVertices,
+    const std::vector<uint32> & indices
+) {
+    const uint32 indexSize = (numVertices > 65536) ? 4 : 2;
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MeshFileMagic, sizeof(header.magic));
+    header.vertexEncoding = encoding;
+    header.numVertices = uint32(numVertices);
+    header.numIndices = uint32(indices.size());
+    header.indexSize = indexSize;
+    for (int i = 0; i < 3; ++i) {
+        header.positionScale[i] = encoded.positionScale[i];
+        header.positionBias[i] = encoded.positionBias[i];
+    }
+    header.vertexDataOffset = uint32(alignTo4(sizeof(header)));
+    header.indexDataOffset = uint32(alignTo4(header.vertexDataOffset + encoded.data.size()));
+    header.numBytes = header.indexDataOffset + header.numIndices * indexSize;
+
+    std::vector<char> contents(header.numBytes, 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + header.vertexDataOffset, encoded.data.data(),
+           encoded.data.size());
+
+    char * indexData = contents.data() + header.indexDataOffset;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (indexSize == 2) {
+            const uint16 index = uint16(indices[i]);
+            memcpy(indexData + 2 * i, &index, 2);
+        } else {
+            memcpy(indexData + 4 * i, &indices[i], 4);
+        }
+    }
+
+    FILE * file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    const bool written = fwrite(contents.data(), 1, contents.size(), file) ==
+                         contents.size();
+
+    return fclose(file) == 0 && written;
+}
+
+
+//---------------------------------------------------------------------------------------
+int main (
+    int argc,
+    char ** argv
+) {
+    int argument = 1;
+    VertexEncoding encoding = VertexEncoding_Snorm16Octahedral;
+    if (argument + 1 < argc && strcmp(argv[argument], "--encoding") == 0) {
+        const char * name = argv[argument + 1];
+        if (strcmp(name, "float") == 0) {
+            encoding = VertexEncoding_Float;
+        } else if (strcmp(name, "octahedral") == 0) {
+            encoding = VertexEncoding_Snorm16Octahedral;
+        } else if (strcmp(name, "packed") == 0) {
+            encoding = VertexEncoding_Snorm16Packed;
+        } else {
+            fprintf(stderr, "Unknown encoding '%s'.\n", name);
+            return EXIT_FAILURE;
+        }
+        argument += 2;
+    }
+
+    if (argc - argument != 2) {
+        fprintf(stderr, "Usage: ImportMesh [--encoding float|octahedral|packed] "
+                        "OUTPUT INPUT.obj\n");
+        return EXIT_FAILURE;
+    }
+    const std::string outputPath = argv[argument];
+    const std::string inputPath = argv[argument + 1];
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<Corner> corners;
+    if (!readObj(inputPath, positions, normals, corners)) {
+        return EXIT_FAILURE;
+    }
+    if (corners.empty()) {
+        fprintf(stderr, "'%s' has no faces.\n", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+    computeMissingNormals(positions, normals, corners);
+
+    std::vector<FloatVertex> vertices;
+    std::vector<uint32> indices;
+    buildVertices(positions, normals, corners, vertices, indices);
+
+    const float inputMissRatio = MeshOptimizer::averageCacheMissRatio(indices,
+                                                                      vertices.size());
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+    MeshOptimizer::optimizeOverdraw(indices, vertices);
+    MeshOptimizer::optimizeVertexFetch(vertices, indices);
+    if (indices.empty()) {
+        fprintf(stderr, "'%s' has no faces of nonzero size.\n", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+    const float outputMissRatio = MeshOptimizer::averageCacheMissRatio(indices,
+                                                                       vertices.size());
+
+    const EncodedVertices encoded = VertexFormat::encode(vertices, encoding);
+    if (!writeMeshFile(outputPath, encoded, encoding, vertices.size(), indices)) {
+        fprintf(stderr, "Cannot write '%s'.\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu vertices, %zu triangles, ACMR %.3f -> %.3f (FIFO %u)\n",
+           vertices.size(), indices.size() / 3, inputMissRatio, outputMissRatio,
+           MeshOptimizer::FifoCacheSize);
+
+    return EXIT_SUCCESS;
+}
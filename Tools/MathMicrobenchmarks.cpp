@@ -0,0 +1,349 @@
+//
+//  MathMicrobenchmarks.cpp
+//
+// Times the tornado simulation math kernels in each available variant: glm on one
+// particle at a time, and structure of arrays code for scalar, SSE, AVX2/FMA and NEON.
+// Each variant is checked against the glm version before it is timed.
+//
+// Usage: MathMicrobenchmarks [--particles N] [--csv FILE]
+//   --particles N   Particles per kernel call, rounded up to a multiple of 8
+//                   (default 65536, which keeps the arrays within L2 on most CPUs).
+//   --csv FILE      Write results as CSV.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MathMicrobenchmarks.hpp"
+#include "TornadoMath.hpp"
+
+
+// Each timed batch repeats a kernel until it takes at least this long.
+static const double kMinBatchSeconds = 0.02;
+static const uint kNumBatches = 5;
+
+
+struct VariantResult {
+    const char * kernel;
+    const char * variant;
+    double nsPerItem;
+    float maxError;
+};
+
+
+//---------------------------------------------------------------------------------------
+// glm variants, one particle at a time
+//---------------------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------------------
+static void glmBezierPointsMatrix(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        const glm::vec3 p = bezierPoint(d.basisMatrix, d.t[i]);
+        d.x[i] = p.x;
+        d.y[i] = p.y;
+        d.z[i] = p.z;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static void glmBezierPointsHorner(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        const glm::vec3 p = bezierPointHorner(d.basisMatrix, d.t[i]);
+        d.x[i] = p.x;
+        d.y[i] = p.y;
+        d.z[i] = p.z;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static void glmBezierPointsDeCasteljau(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        const glm::vec3 p = bezierPointDeCasteljau(d.p0, d.p1, d.p2, d.p3, d.t[i]);
+        d.x[i] = p.x;
+        d.y[i] = p.y;
+        d.z[i] = p.z;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static void glmRotatePositions(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        const glm::vec3 axis(d.axisX[i], d.axisY[i], d.axisZ[i]);
+        const glm::vec3 p = rotatePosition(glm::vec3(d.x[i], d.y[i], d.z[i]), axis,
+                                           d.angle[i]);
+        d.x[i] = p.x;
+        d.y[i] = p.y;
+        d.z[i] = p.z;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static void glmNormalsToCurve(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        const glm::vec3 n = normalToCurve(d.derivMatrix, d.t[i]);
+        d.x[i] = n.x;
+        d.y[i] = n.y;
+        d.z[i] = n.z;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static void glmBezierMatricesFromControlPoints(KernelData & d)
+{
+    glm::vec3 p0, p1, p2, p3;
+    for (uint i = 0; i < d.count; ++i) {
+        controlPointsForCall(d, i, p0, p1, p2, p3);
+        const BezierMatrices m = bezierMatricesFromControlPoints(p0, p1, p2, p3);
+
+        float * slot = &d.matrices[(i % kNumMatrixSlots) * 32];
+        std::copy(&m.basisMatrix[0][0], &m.basisMatrix[0][0] + 16, slot);
+        std::copy(&m.derivMatrix[0][0], &m.derivMatrix[0][0] + 16, slot + 16);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+static std::vector<KernelVariant> availableVariants()
+{
+    std::vector<KernelVariant> variants = {
+        {"bezier_matrix", "glm", &glmBezierPointsMatrix},
+        {"bezier_horner", "glm", &glmBezierPointsHorner},
+        {"bezier_de_casteljau", "glm", &glmBezierPointsDeCasteljau},
+        {"rotate_position", "glm", &glmRotatePositions},
+        {"normal_to_curve", "glm", &glmNormalsToCurve},
+        {"bezier_matrices_from_control_points", "glm", &glmBezierMatricesFromControlPoints},
+    };
+
+    appendSimdVariants<SimdFloat1>("scalar_soa", variants);
+
+#if defined(__SSE2__)
+    appendSimdVariants<SimdFloatSSE>("sse", variants);
+    variants.push_back({"bezier_matrices_from_control_points", "sse",
+                        &runBezierMatricesFromControlPoints<SimdFloatSSE>});
+#endif
+
+#if defined(CUBENADO_AVX_VARIANTS)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        appendAVXVariants(variants);
+    }
+#endif
+
+#if defined(__ARM_NEON)
+    appendSimdVariants<SimdFloatNEON>("neon", variants);
+    variants.push_back({"bezier_matrices_from_control_points", "neon",
+                        &runBezierMatricesFromControlPoints<SimdFloatNEON>});
+#endif
+
+    // Group variants of the same kernel, keeping glm first.
+    std::stable_sort(variants.begin(), variants.end(),
+        [](const KernelVariant & a, const KernelVariant & b) {
+            return std::string(a.kernel) < std::string(b.kernel);
+        });
+
+    return variants;
+}
+
+
+//---------------------------------------------------------------------------------------
+static void initKernelData (
+    KernelData & d,
+    uint count
+) {
+    d.count = count;
+
+    // Initial tornado control points, see ParticleSystemImpl::initTornadoCurve().
+    d.p0 = glm::vec3(0.0f, -17.0f, -50.0f);
+    d.p1 = glm::vec3(4.0f,  -9.0f,  -50.0f);
+    d.p2 = glm::vec3(-3.0f, 3.0f, -10.0f);
+    d.p3 = glm::vec3(0.0f, 9.0f,  -10.0f);
+
+    const BezierMatrices m = bezierMatricesFromControlPoints(d.p0, d.p1, d.p2, d.p3);
+    d.basisMatrix = m.basisMatrix;
+    d.derivMatrix = m.derivMatrix;
+
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+    d.t.resize(count);
+    d.axisX.resize(count);
+    d.axisY.resize(count);
+    d.axisZ.resize(count);
+    d.angle.resize(count);
+    for (uint i = 0; i < count; ++i) {
+        d.t[i] = unit(generator);
+
+        glm::vec3 axis;
+        do {
+            axis = glm::vec3(signedUnit(generator), signedUnit(generator),
+                             signedUnit(generator));
+        } while (glm::length(axis) < 0.1f);
+        axis = glm::normalize(axis);
+
+        d.axisX[i] = axis.x;
+        d.axisY[i] = axis.y;
+        d.axisZ[i] = axis.z;
+        d.angle[i] = unit(generator) * 12.5663706f;  // [0, 4pi]
+    }
+
+    d.x.resize(count);
+    d.y.resize(count);
+    d.z.resize(count);
+    d.matrices.resize(kNumMatrixSlots * 32);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Deterministic positions within a 20 unit cube, input to rotate_position.
+static void resetOutputs(KernelData & d)
+{
+    for (uint i = 0; i < d.count; ++i) {
+        d.x[i] = std::fmod(i * 0.37f, 20.0f) - 10.0f;
+        d.y[i] = std::fmod(i * 0.73f, 20.0f) - 10.0f;
+        d.z[i] = std::fmod(i * 0.19f, 20.0f) - 10.0f;
+    }
+    std::fill(d.matrices.begin(), d.matrices.end(), 0.0f);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Largest absolute difference between outputs of a and b.
+static float maxDifference (
+    const KernelData & a,
+    const KernelData & b
+) {
+    float maxError = 0.0f;
+    for (uint i = 0; i < a.count; ++i) {
+        maxError = std::max(maxError, std::abs(a.x[i] - b.x[i]));
+        maxError = std::max(maxError, std::abs(a.y[i] - b.y[i]));
+        maxError = std::max(maxError, std::abs(a.z[i] - b.z[i]));
+    }
+    for (size_t i = 0; i < a.matrices.size(); ++i) {
+        maxError = std::max(maxError, std::abs(a.matrices[i] - b.matrices[i]));
+    }
+    return maxError;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Best of kNumBatches, in nanoseconds per item.
+static double timeVariant (
+    const KernelVariant & variant,
+    KernelData & data
+) {
+    typedef std::chrono::steady_clock Clock;
+
+    // Find a repeat count that fills a batch.
+    uint numRepeats = 1;
+    for (;;) {
+        const Clock::time_point start = Clock::now();
+        for (uint i = 0; i < numRepeats; ++i) {
+            variant.function(data);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= kMinBatchSeconds) {
+            break;
+        }
+        numRepeats *= 2;
+    }
+
+    double bestSeconds = 1e30;
+    for (uint batch = 0; batch < kNumBatches; ++batch) {
+        const Clock::time_point start = Clock::now();
+        for (uint i = 0; i < numRepeats; ++i) {
+            variant.function(data);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        bestSeconds = std::min(bestSeconds, seconds);
+    }
+
+    return bestSeconds * 1e9 / (static_cast<double>(numRepeats) * data.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+int main (
+    int argc,
+    char ** argv
+) {
+    uint numParticles = 65536;
+    std::string csvPath;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--particles" && i + 1 < argc) {
+            numParticles = static_cast<uint>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: MathMicrobenchmarks [--particles N] [--csv FILE]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Every variant processes whole vectors, up to 8 wide.
+    numParticles = std::max(8u, (numParticles + 7) & ~7u);
+
+    KernelData reference;
+    initKernelData(reference, numParticles);
+    KernelData data = reference;
+
+    const std::vector<KernelVariant> variants = availableVariants();
+    std::vector<VariantResult> results;
+
+    printf("%u particles per call\n\n", numParticles);
+    printf("%-36s %-12s %12s %12s\n", "kernel", "variant", "ns/particle", "max error");
+
+    const char * referenceKernel = nullptr;
+    for (const KernelVariant & variant : variants) {
+        // Outputs of the first (glm) variant of each kernel are the reference.
+        if (!referenceKernel || std::string(referenceKernel) != variant.kernel) {
+            referenceKernel = variant.kernel;
+            resetOutputs(reference);
+            variant.function(reference);
+        }
+
+        resetOutputs(data);
+        variant.function(data);
+        const float maxError = maxDifference(reference, data);
+
+        const double nsPerItem = timeVariant(variant, data);
+        results.push_back({variant.kernel, variant.variant, nsPerItem, maxError});
+
+        printf("%-36s %-12s %12.3f %12.2e\n", variant.kernel, variant.variant,
+               nsPerItem, maxError);
+        fflush(stdout);
+    }
+
+    if (!csvPath.empty()) {
+        FILE * file = fopen(csvPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Unable to write '%s'.\n", csvPath.c_str());
+            return EXIT_FAILURE;
+        }
+        fprintf(file, "kernel,variant,ns_per_particle,max_error\n");
+        for (const VariantResult & result : results) {
+            fprintf(file, "%s,%s,%.4f,%.3e\n", result.kernel, result.variant,
+                    result.nsPerItem, result.maxError);
+        }
+        fclose(file);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+//
+//  MathMicrobenchmarks.hpp
+//
+// Kernel variants timed by MathMicrobenchmarks, shared with the translation unit built
+// with AVX enabled.
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "NumericTypes.h"
+#include "TornadoMathSIMD.hpp"
+
+
+// Number of matrix pairs written by the control point kernels before wrapping.
+static const uint kNumMatrixSlots = 64;
+
+
+// Inputs and outputs for every kernel, as structure of arrays.
+struct KernelData {
+    uint count;
+
+    glm::vec3 p0, p1, p2, p3;
+    glm::mat4 basisMatrix;
+    glm::mat4 derivMatrix;
+
+    std::vector<float> t;
+    std::vector<float> axisX, axisY, axisZ;
+    std::vector<float> angle;
+
+    std::vector<float> x, y, z;
+
+    // kNumMatrixSlots basis and derivative matrix pairs, 32 floats each.
+    std::vector<float> matrices;
+};
+
+
+typedef void (*KernelFunction)(KernelData & data);
+
+
+struct KernelVariant {
+    const char * kernel;
+    const char * variant;
+    KernelFunction function;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Control points for call i, offset by t[i] so each call has different inputs.
+inline void controlPointsForCall (
+    const KernelData & data,
+    uint i,
+    glm::vec3 & p0,
+    glm::vec3 & p1,
+    glm::vec3 & p2,
+    glm::vec3 & p3
+) {
+    const glm::vec3 offset(data.t[i]);
+    p0 = data.p0 + offset;
+    p1 = data.p1;
+    p2 = data.p2;
+    p3 = data.p3 - offset;
+}
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+void runBezierPointsMatrix(KernelData & d)
+{
+    bezierPointsMatrix<V>(d.basisMatrix, d.t.data(), d.x.data(), d.y.data(), d.z.data(),
+                          d.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+void runBezierPointsHorner(KernelData & d)
+{
+    bezierPointsHorner<V>(d.basisMatrix, d.t.data(), d.x.data(), d.y.data(), d.z.data(),
+                          d.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+void runBezierPointsDeCasteljau(KernelData & d)
+{
+    bezierPointsDeCasteljau<V>(d.p0, d.p1, d.p2, d.p3, d.t.data(), d.x.data(),
+                               d.y.data(), d.z.data(), d.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Rotates x, y, z in place, so outputs depend on the positions left by earlier runs.
+template <typename V>
+void runRotatePositions(KernelData & d)
+{
+    rotatePositions<V>(d.x.data(), d.y.data(), d.z.data(), d.axisX.data(),
+                       d.axisY.data(), d.axisZ.data(), d.angle.data(), d.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+void runNormalsToCurve(KernelData & d)
+{
+    normalsToCurve<V>(d.derivMatrix, d.t.data(), d.x.data(), d.y.data(), d.z.data(),
+                      d.count);
+}
+
+
+//---------------------------------------------------------------------------------------
+template <typename V>
+void runBezierMatricesFromControlPoints(KernelData & d)
+{
+    glm::vec3 p0, p1, p2, p3;
+    for (uint i = 0; i < d.count; ++i) {
+        controlPointsForCall(d, i, p0, p1, p2, p3);
+        float * slot = &d.matrices[(i % kNumMatrixSlots) * 32];
+        bezierMatricesFromControlPointsExpanded<V>(p0, p1, p2, p3, slot, slot + 16);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Appends the structure of arrays kernels instantiated for V.
+template <typename V>
+void appendSimdVariants (
+    const char * variant,
+    std::vector<KernelVariant> & variants
+) {
+    variants.push_back({"bezier_matrix", variant, &runBezierPointsMatrix<V>});
+    variants.push_back({"bezier_horner", variant, &runBezierPointsHorner<V>});
+    variants.push_back({"bezier_de_casteljau", variant, &runBezierPointsDeCasteljau<V>});
+    variants.push_back({"rotate_position", variant, &runRotatePositions<V>});
+    variants.push_back({"normal_to_curve", variant, &runNormalsToCurve<V>});
+}
+
+
+// Appends variants built with AVX and FMA enabled, defined in MathMicrobenchmarksAVX.cpp.
+// Only call when the CPU supports both.
+void appendAVXVariants(std::vector<KernelVariant> & variants);
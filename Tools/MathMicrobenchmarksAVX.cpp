@@ -0,0 +1,21 @@
+//
+//  MathMicrobenchmarksAVX.cpp
+//
+// Built with AVX2 and FMA enabled, and only called after checking the CPU supports
+// them. Nothing but the SimdFloatAVX instantiations should be used from this file,
+// since inline functions compiled here may contain AVX instructions.
+//
+
+#include "MathMicrobenchmarks.hpp"
+
+#if !defined(__AVX__) || !defined(__FMA__)
+    #error "Compile with AVX and FMA enabled, e.g. -mavx2 -mfma."
+#endif
+
+
+//---------------------------------------------------------------------------------------
+void appendAVXVariants (
+    std::vector<KernelVariant> & variants
+) {
+    appendSimdVariants<SimdFloatAVX>("avx2_fma", variants);
+}
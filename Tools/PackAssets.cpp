@@ -0,0 +1,221 @@
+//
+//  PackAssets.cpp
+//
+// Packs the files of a directory into one AssetPack, for the renderer to memory map
+// instead of reading each asset. Subdirectories and hidden files are skipped.
+//
+// Usage: PackAssets [--cpp] OUTPUT DIR
+//   --cpp    Write OUTPUT as C++ source defining the pack as a byte array, for builds
+//            with CUBENADO_EMBED_ASSETS.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "AssetPack.hpp"
+
+
+struct PackedFile {
+    std::string name;
+    std::vector<char> contents;
+};
+
+
+//---------------------------------------------------------------------------------------
+static bool readFile (
+    const std::string & path,
+    std::vector<char> & contents
+) {
+    FILE * file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long numBytes = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    contents.resize(numBytes > 0 ? static_cast<size_t>(numBytes) : 0);
+    const bool read = contents.empty() ||
+                      fread(contents.data(), 1, contents.size(), file) == contents.size();
+    fclose(file);
+
+    return read;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool readDirectory (
+    const std::string & directoryPath,
+    std::vector<PackedFile> & files
+) {
+    DIR * directory = opendir(directoryPath.c_str());
+    if (!directory) {
+        fprintf(stderr, "Cannot open directory '%s'.\n", directoryPath.c_str());
+        return false;
+    }
+
+    bool succeeded = true;
+    while (dirent * entry = readdir(directory)) {
+        const std::string name(entry->d_name);
+        const std::string path = directoryPath + "/" + name;
+
+        struct stat fileStatus;
+        if (name[0] == '.' || stat(path.c_str(), &fileStatus) != 0 ||
+            !S_ISREG(fileStatus.st_mode))
+        {
+            continue;
+        }
+
+        if (name.size() > AssetPackEntry::MaxNameLength) {
+            fprintf(stderr, "File name '%s' is longer than %zu characters.\n",
+                    name.c_str(), AssetPackEntry::MaxNameLength);
+            succeeded = false;
+            continue;
+        }
+
+        PackedFile file;
+        file.name = name;
+        if (!readFile(path, file.contents)) {
+            fprintf(stderr, "Cannot read '%s'.\n", path.c_str());
+            succeeded = false;
+            continue;
+        }
+
+        files.push_back(file);
+    }
+    closedir(directory);
+
+    // Sorted as strcmp() orders names, for binary search at runtime.
+    std::sort(files.begin(), files.end(), [](const PackedFile & a, const PackedFile & b) {
+        return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+    });
+
+    return succeeded;
+}
+
+
+//---------------------------------------------------------------------------------------
+static std::vector<char> buildPack (
+    const std::vector<PackedFile> & files
+) {
+    size_t numBytes = sizeof(AssetPackHeader) + files.size() * sizeof(AssetPackEntry);
+    for (const PackedFile & file : files) {
+        numBytes += file.contents.size() + 1;
+    }
+
+    std::vector<char> pack(numBytes, 0);
+
+    AssetPackHeader header;
+    memcpy(header.magic, AssetPackMagic, sizeof(AssetPackMagic));
+    header.numEntries = static_cast<uint32>(files.size());
+    header.numBytes = static_cast<uint32>(numBytes);
+    memcpy(pack.data(), &header, sizeof(header));
+
+    size_t offset = sizeof(AssetPackHeader) + files.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < files.size(); ++i) {
+        AssetPackEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        strncpy(entry.name, files[i].name.c_str(), AssetPackEntry::MaxNameLength);
+        entry.offset = static_cast<uint32>(offset);
+        entry.numBytes = static_cast<uint32>(files[i].contents.size());
+
+        memcpy(pack.data() + sizeof(AssetPackHeader) + i * sizeof(AssetPackEntry),
+               &entry, sizeof(entry));
+
+        // The zero terminator following each asset is already in place.
+        std::copy(files[i].contents.begin(), files[i].contents.end(),
+                  pack.begin() + offset);
+        offset += files[i].contents.size() + 1;
+    }
+
+    return pack;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writePack (
+    const std::string & path,
+    const std::vector<char> & pack
+) {
+    FILE * file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    const bool written = fwrite(pack.data(), 1, pack.size(), file) == pack.size();
+
+    return fclose(file) == 0 && written;
+}
+
+
+//---------------------------------------------------------------------------------------
+static bool writeCppSource (
+    const std::string & path,
+    const std::vector<char> & pack
+) {
+    FILE * file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "// Generated by PackAssets, do not edit.\n\n");
+    fprintf(file, "#include <cstddef>\n\n");
+    fprintf(file, "extern const unsigned char g_embeddedAssetPack[];\n");
+    fprintf(file, "extern const size_t g_embeddedAssetPackSize;\n\n");
+
+    // Aligned for reading the header and index in place.
+    fprintf(file, "alignas(16) const unsigned char g_embeddedAssetPack[] = {");
+    for (size_t i = 0; i < pack.size(); ++i) {
+        fprintf(file, "%s%u,", (i % 20 == 0) ? "\n    " : "",
+                static_cast<unsigned>(static_cast<unsigned char>(pack[i])));
+    }
+    fprintf(file, "\n};\n\n");
+    fprintf(file, "const size_t g_embeddedAssetPackSize = %zu;\n", pack.size());
+
+    return fclose(file) == 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+int main (
+    int argc,
+    char ** argv
+) {
+    int argument = 1;
+    bool writeCpp = false;
+    if (argument < argc && strcmp(argv[argument], "--cpp") == 0) {
+        writeCpp = true;
+        ++argument;
+    }
+
+    if (argc - argument != 2) {
+        fprintf(stderr, "Usage: PackAssets [--cpp] OUTPUT DIR\n");
+        return EXIT_FAILURE;
+    }
+    const std::string outputPath = argv[argument];
+    const std::string directoryPath = argv[argument + 1];
+
+    std::vector<PackedFile> files;
+    if (!readDirectory(directoryPath, files)) {
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<char> pack = buildPack(files);
+
+    const bool written = writeCpp ? writeCppSource(outputPath, pack)
+                                  : writePack(outputPath, pack);
+    if (!written) {
+        fprintf(stderr, "Cannot write '%s'.\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}